@@ -5,20 +5,61 @@
 
 #include "klee/Internal/Analysis/Cloner.h"
 
-#include <vector>
+#include <map>
+#include <stdint.h>
 
 namespace klee {
 
 class ExecutionState;
 
+/* a node in the global trie of the (translated) call traces: a call trace is
+   interned as the node of its last instruction, so equal call traces are
+   represented by the same node */
+class CallTraceNode {
+public:
+
+    /* the node of the empty call trace */
+    static CallTraceNode *getRoot();
+
+    /* the node of this call trace extended by the translation of inst */
+    CallTraceNode *getChild(Cloner *cloner, llvm::Instruction *inst);
+
+    CallTraceNode *getParent() const {
+        return parent;
+    }
+
+    llvm::Instruction *getInst() const {
+        return inst;
+    }
+
+    /* unique among the interned nodes */
+    uint64_t getId() const {
+        return id;
+    }
+
+private:
+
+    CallTraceNode(CallTraceNode *parent, llvm::Instruction *inst);
+
+    ~CallTraceNode();
+
+    static llvm::Instruction *getTranslatedInst(Cloner *cloner, llvm::Instruction *inst);
+
+    CallTraceNode *parent;
+    /* the translated instruction (null for the root) */
+    llvm::Instruction *inst;
+    uint64_t id;
+    std::map<llvm::Instruction *, CallTraceNode *> children;
+};
+
 class ASContext {
 public:
 
-    ASContext() : refCount(0) {
+    ASContext() : refCount(0), node(0) {
 
     }
 
-    ASContext(Cloner *cloner, std::vector<llvm::Instruction *> &callTrace, llvm::Instruction *inst);
+    ASContext(Cloner *cloner, CallTraceNode *callTrace, llvm::Instruction *inst);
     
     ASContext(ASContext &other);
 
@@ -26,15 +67,20 @@ public:
 
     bool operator!=(ASContext &other);
 
+    /* the id of the interned call trace (including the allocation site),
+       equal contexts have the same id */
+    uint64_t getId() const {
+        return node ? node->getId() : 0;
+    }
+
     void dump();
 
     unsigned int refCount;
 
 private:
 
-    llvm::Instruction *getTranslatedInst(Cloner *cloner, llvm::Instruction *inst);
-
-    std::vector<llvm::Instruction *> trace;
+    /* the interned call trace, extended by the allocation site */
+    CallTraceNode *node;
 };
 
 }
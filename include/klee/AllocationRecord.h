@@ -4,6 +4,7 @@
 #include "klee/ASContext.h"
 
 #include <list>
+#include <unordered_map>
 
 namespace klee {
 
@@ -34,7 +35,8 @@ private:
     /*  TODO: change ref<ASContext> to ASContext? */
     typedef std::list<MemoryObject *> MemoryObjectList;
     typedef std::pair<ref<ASContext>, MemoryObjectList> Entry;
-    typedef std::vector<Entry> Record;
+    /* indexed by the id of the context */
+    typedef std::unordered_map<uint64_t, Entry> Record;
 
     void incRefCount();
 
@@ -27,6 +27,8 @@ extern llvm::cl::opt<double> MaxCoreSolverTime;
 
 extern llvm::cl::opt<bool> UseForkedCoreSolver;
 
+extern llvm::cl::opt<unsigned> SolverConstructCacheSize;
+
 extern llvm::cl::opt<bool> CoreSolverOptimizeDivides;
 
 ///The different query logging solvers that can switched on/off
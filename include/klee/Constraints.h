@@ -11,6 +11,11 @@
 #define KLEE_CONSTRAINTS_H
 
 #include "klee/Expr.h"
+#include "klee/Internal/ADT/CopyOnWrite.h"
+#include "klee/util/ExprHashMap.h"
+
+#include <map>
+#include <vector>
 
 // FIXME: Currently we use ConstraintManager for two things: to pass
 // sets of constraints around, and to optimize constraints. We should
@@ -19,6 +24,76 @@
 namespace klee {
 
 class ExprVisitor;
+
+/// Partition of constraints into independent clusters, maintained with a
+/// union-find as constraints are added. Two constraints are in the same
+/// cluster if they (transitively) read the same byte of an array, or the
+/// same array at a symbolic index.
+class IndependenceIndex {
+public:
+  /// A byte of an array, or the whole array (index WholeArray).
+  typedef std::pair<const Array *, unsigned> Element;
+  static const unsigned WholeArray = ~0u;
+
+  /// Compute the (sorted) elements read by an expression, the reads of
+  /// constant arrays are ignored as they do not alias.
+  static void getElements(ref<Expr> e, std::vector<Element> &result);
+
+  /// The number of indexed constraints.
+  unsigned size() const { return parent.size(); }
+
+  const std::vector<Element> &getElements(unsigned id) const {
+    return elements[id];
+  }
+
+  /// Add the next constraint, which reads the given elements.
+  void add(const std::vector<Element> &elements);
+
+  /// Compute the (sorted) ids of the constraints in the clusters which
+  /// read any of the given elements.
+  void getClusters(const std::vector<Element> &elements,
+                   std::vector<unsigned> &result) const;
+
+  /// An estimate of the memory used by the index (in bytes).
+  size_t getMemoryUsage() const;
+
+private:
+  std::vector<unsigned> parent;
+  /// The constraints of each cluster (only set for the roots).
+  std::vector< std::vector<unsigned> > members;
+  std::vector< std::vector<Element> > elements;
+  /// A constraint which reads the byte, the bytes of an array which is read
+  /// at a symbolic index are dropped (see wholeReaders).
+  std::map<Element, unsigned> byteReaders;
+  /// A constraint which reads the array at a symbolic index.
+  std::map<const Array *, unsigned> wholeReaders;
+
+  unsigned find(unsigned id) const;
+  void merge(unsigned a, unsigned b);
+};
+
+/// The substitutions implied by constraints, which are used to simplify
+/// expressions: an equality with a constant substitutes the constant for
+/// its other side, any other constraint is substituted by true. The first
+/// substitution of an expression is kept.
+class EqualityIndex {
+public:
+  typedef ExprHashMap< ref<Expr> > substitutions_ty;
+
+  EqualityIndex() : numConstraints(0) {}
+
+  /// The number of indexed constraints.
+  unsigned size() const { return numConstraints; }
+
+  const substitutions_ty &getSubstitutions() const { return substitutions; }
+
+  /// Add the next constraint, returns true iff the substitutions changed.
+  bool add(ref<Expr> constraint);
+
+private:
+  substitutions_ty substitutions;
+  unsigned numConstraints;
+};
   
 class ConstraintManager {
 public:
@@ -26,14 +101,19 @@ public:
   typedef constraints_ty::iterator iterator;
   typedef constraints_ty::const_iterator const_iterator;
 
-  ConstraintManager() {}
+  ConstraintManager() : numNodes(0) {}
 
-  // create from constraints with no optimization
+  // create from constraints with no optimization (they are not counted by
+  // getNumNodes(), as such managers are usually short-lived query copies)
   explicit
   ConstraintManager(const std::vector< ref<Expr> > &_constraints) :
-    constraints(_constraints) {}
+    constraints(_constraints), numNodes(0) {}
 
-  ConstraintManager(const ConstraintManager &cs) : constraints(cs.constraints) {}
+  // the simplified expressions are not copied, the copy is likely to add a
+  // constraint soon
+  ConstraintManager(const ConstraintManager &cs)
+    : constraints(cs.constraints), index(cs.index),
+      equalities(cs.equalities), numNodes(cs.numNodes) {}
 
   typedef std::vector< ref<Expr> >::const_iterator constraint_iterator;
 
@@ -43,35 +123,71 @@ public:
 
   ref<Expr> simplifyExpr(ref<Expr> e) const;
 
+  /// Collect the constraints (in order) which \a e may depend on, i.e. the
+  /// constraints of the independent clusters which \a e reads from.
+  void getIndependentConstraints(ref<Expr> e,
+                                 std::vector< ref<Expr> > &result) const;
+
   void addConstraint(ref<Expr> e);
   
   bool empty() const {
-    return constraints.empty();
+    return constraints->empty();
   }
   ref<Expr> back() const {
-    return constraints.back();
+    return constraints->back();
   }
   constraint_iterator begin() const {
-    return constraints.begin();
+    return constraints->begin();
   }
   constraint_iterator end() const {
-    return constraints.end();
+    return constraints->end();
   }
   size_t size() const {
-    return constraints.size();
+    return constraints->size();
+  }
+
+  /// The number of expression nodes of the added constraints (the nodes
+  /// which are shared by several constraints are counted once per
+  /// constraint), used to estimate the memory used by the constraints.
+  uint64_t getNumNodes() const {
+    return numNodes;
+  }
+
+  /// An estimate of the memory used by the independence index, which is
+  /// shared with the copies of the manager until one of them adds a
+  /// constraint (so after a fork, it is usually held once per state).
+  size_t getIndexMemoryUsage() const {
+    return index->getMemoryUsage();
   }
 
   bool operator==(const ConstraintManager &other) const {
-    return constraints == other.constraints;
+    return constraints.get() == other.constraints.get();
   }
   
 private:
-  std::vector< ref<Expr> > constraints;
-
-  // returns true iff the constraints were modified
-  bool rewriteConstraints(ExprVisitor &visitor);
+  /* shared between forked states until one of them adds a constraint */
+  CopyOnWrite<constraints_ty> constraints;
+  /* the index covers a prefix of the constraints: it is extended when a
+     constraint is added if it covers all of them, otherwise it is caught up
+     on demand (e.g. when the constraints were not added one by one) */
+  mutable CopyOnWrite<IndependenceIndex> index;
+  /* same as the independence index */
+  mutable CopyOnWrite<EqualityIndex> equalities;
+  /* the results of simplifyExpr(), valid until the substitutions change */
+  mutable EqualityIndex::substitutions_ty simplified;
+  uint64_t numNodes;
+
+  const IndependenceIndex &getIndex() const;
+  const EqualityIndex &getEqualities() const;
+
+  // rewrite the constraints which may contain src, returns true iff the
+  // constraints were modified
+  bool rewriteConstraints(ExprVisitor &visitor, ref<Expr> src);
 
   void addConstraintInternal(ref<Expr> e);
+
+  void pushConstraint(ref<Expr> e,
+                      const std::vector<IndependenceIndex::Element> *elements = 0);
 };
 
 }
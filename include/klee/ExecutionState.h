@@ -16,6 +16,9 @@
 #include "klee/Expr.h"
 #include "klee/AllocationRecord.h"
 #include "klee/Internal/ADT/TreeStream.h"
+#include "klee/Internal/ADT/CopyOnWrite.h"
+#include "klee/Internal/ADT/FlatSet.h"
+#include "klee/Internal/Module/Cell.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 
 // FIXME: We do not want to be exposing these? :(
@@ -30,7 +33,6 @@
 namespace klee {
 class Array;
 class CallPathNode;
-struct Cell;
 struct KFunction;
 struct KInstruction;
 class MemoryObject;
@@ -45,7 +47,9 @@ struct StackFrame {
   CallPathNode *callPathNode;
 
   std::vector<const MemoryObject *> allocas;
-  Cell *locals;
+  /* the registers are shared between copies of the frame (forked states,
+     snapshots) until one of the copies writes to them */
+  CopyOnWrite<std::vector<Cell> > locals;
 
   /// Minimum distance to an uncovered instruction once the function
   /// returns. This is not a good place for this but is used to
@@ -61,35 +65,67 @@ struct StackFrame {
   // of intrinsic lowering.
   MemoryObject *varargs;
 
+  /* the interned call trace up to (and including) the call site of this
+     frame, computed lazily (null if not computed yet) */
+  CallTraceNode *callTraceNode;
+
   StackFrame(KInstIterator caller, KFunction *kf);
   StackFrame(const StackFrame &s);
   ~StackFrame();
+
+  const Cell &getLocal(unsigned index) const {
+    return locals.get()[index];
+  }
+
+  Cell &getWritableLocal(unsigned index) {
+    return locals.mutate()[index];
+  }
 };
 
 #define NORMAL_STATE (1 << 0)
 #define RECOVERY_STATE (1 << 1)
 
 struct Snapshot {
+  /* the recovered values (null if the slice did not modify the address) */
+  typedef std::map<std::pair<uint32_t, uint64_t>, ref<Expr> > RecoveredValues;
+
   unsigned int refCount;
   ref<ExecutionState> state;
   llvm::Function *f;
+  /* the dead snapshots of the snapshot state were already dropped */
+  bool compacted;
+  /* the memory owned by the state when the snapshot was taken: it is shared
+     with the snapshot from then on, and retained by the snapshot once the
+     state writes to it again */
+  size_t retainedUsage;
+  /* shared by all the states which hold the snapshot, indexed by
+     (slice id, address), only the values which do not depend on the path
+     of the recovery or on its allocations are recorded */
+  RecoveredValues recoveredValues;
 
   /* TODO: is it required? */
   Snapshot() :
     state(0),
-    f(0)
+    f(0),
+    compacted(false),
+    retainedUsage(0)
   {
 
   };
 
-  Snapshot(ref<ExecutionState> state, llvm::Function *f) :
+  Snapshot(ref<ExecutionState> state, llvm::Function *f, size_t retainedUsage) :
     refCount(0),
     state(state),
-    f(f)
+    f(f),
+    compacted(false),
+    retainedUsage(retainedUsage)
   {
 
   };
 
+  /* an estimate of the memory held by the snapshot (in bytes) */
+  size_t getMemoryUsage() const;
+
 };
 
 struct RecoveryInfo {
@@ -102,6 +138,15 @@ struct RecoveryInfo {
     /* TODO: a bit strange that it is here, will be fixed later */
     llvm::Function *f;
     uint32_t sliceId;
+    /* the slices recovered by this info (more than one if batched) */
+    std::vector<uint32_t> sliceIds;
+    /* all the slices of the function are executed, and all their writes
+       are recorded (not only the ones to the load address) */
+    bool speculative;
+    /* the load address is symbolic, so the writes to the whole object
+       [loadAddr, loadAddr + loadSize) are recovered (and all the writes are
+       recorded) */
+    bool objectWide;
     /* TODO: a bit strange that it is here, will be fixed later */
     ref<Snapshot> snapshot;
     unsigned int snapshotIndex;
@@ -113,6 +158,8 @@ struct RecoveryInfo {
         loadSize(0),
         f(0),
         sliceId(0),
+        speculative(false),
+        objectWide(false),
         snapshot(0),
         snapshotIndex(0)
     {
@@ -137,6 +184,30 @@ enum {
     PRIORITY_HIGH,
 };
 
+/* an estimate of the memory held by a state (in bytes) */
+struct StateMemoryUsage {
+  /* the objects owned by the address space (with their updates) */
+  size_t objects;
+  /* the constraint nodes and the independence index of the constraints */
+  size_t constraints;
+  /* the memory retained by the snapshots (and their recovered values) */
+  size_t snapshots;
+  size_t recoveryCache;
+
+  StateMemoryUsage() :
+    objects(0),
+    constraints(0),
+    snapshots(0),
+    recoveryCache(0)
+  {
+
+  }
+
+  size_t total() const {
+    return objects + constraints + snapshots + recoveryCache;
+  }
+};
+
 /// @brief ExecutionState representing a path under exploration
 class ExecutionState {
 public:
@@ -154,30 +225,44 @@ private:
 
   /* normal state properties */
 
+  /* the written addresses and the recovery cache grow along the whole
+     path, so they are tree maps (a flat map inserts in linear time) */
   typedef std::map<uint64_t, WrittenAddressInfo> WrittenAddresses;
-  typedef std::map<uint64_t, ref<Expr> > ValuesCache;
-  typedef std::map< std::pair<uint32_t, uint32_t>, ValuesCache> RecoveryCache;
+  /* indexed by ((snapshot index, slice id), address) */
+  typedef std::pair<std::pair<uint32_t, uint32_t>, uint64_t> RecoveryCacheKey;
+  typedef std::map<RecoveryCacheKey, ref<Expr> > RecoveryCache;
+  /* the recovered loads (cleared after each blocking load) and the recovered
+     slices stay small, so they are flat (sorted vectors) */
+  /* indexed by (snapshot index, slice id) */
+  typedef FlatSet<std::pair<uint32_t, uint32_t> > RecoveredSlices;
+
+  /* the chopper metadata below is shared (copy-on-write) between a state,
+     its snapshots and its recovery states, so taking a snapshot or creating
+     a recovery state does not copy it */
 
   /* a normal state has a suspend status */
   bool suspendStatus;
   /* history of taken snapshots, which are uses to create recovery states */
-  std::vector< ref<Snapshot> > snapshots;
+  CopyOnWrite< std::vector< ref<Snapshot> > > snapshots;
   /* a normal state has a unique recovery state */
   ExecutionState *recoveryState;
   /* TODO: rename/re-implement */
   bool blockingLoadStatus;
   /* resloved load addresses */
-  std::set<uint64_t> recoveredLoads;
+  CopyOnWrite< FlatSet<uint64_t> > recoveredLoads;
   /* we have to remember which allocations were executed */
-  AllocationRecord allocationRecord;
+  CopyOnWrite<AllocationRecord> allocationRecord;
   /* used for guiding multiple recovery states */
-  std::set< ref<Expr> > guidingConstraints;
+  CopyOnWrite< std::set< ref<Expr> > > guidingConstraints;
   /* we need to know if an address was written  */
-  WrittenAddresses writtenAddresses;
+  CopyOnWrite<WrittenAddresses> writtenAddresses;
   /* we use this to determine which recovery states must be run */
   std::list< ref<RecoveryInfo> > pendingRecoveryInfos;
   /* TODO: add docs */
-  RecoveryCache recoveryCache;
+  CopyOnWrite<RecoveryCache> recoveryCache;
+  /* the slices which were speculatively executed from a snapshot, an address
+     which is not in the recovery cache was not modified by them */
+  CopyOnWrite<RecoveredSlices> recoveredSlices;
 
   /* recovery state properties */
 
@@ -190,11 +275,16 @@ private:
   /* TODO: should be ref<RecoveryInfo> */
   ref<RecoveryInfo> recoveryInfo;
   /* we use this record while executing a recovery state  */
-  AllocationRecord guidingAllocationRecord;
+  CopyOnWrite<AllocationRecord> guidingAllocationRecord;
   /* recursion level */
   unsigned int level;
   /* search priority */
   int priority;
+  /* the recovery made decisions which depend on the path constraints */
+  bool pathDependent;
+  /* the recovery allocated memory (which is bound only in its dependent
+     states) */
+  bool allocated;
 
 public:
   // Execution - Control Flow specific
@@ -233,6 +323,9 @@ public:
   /// @brief Exploration depth, i.e., number of times KLEE branched for this state
   unsigned depth;
 
+  /// @brief The number of instructions executed on the path of this state
+  uint64_t steppedInstructions;
+
   /// @brief History of complete path: represents branches taken to
   /// reach/create this state (both concrete and symbolic)
   TreeOStream pathOS;
@@ -292,6 +385,10 @@ public:
   void addConstraint(ref<Expr> e) {
     constraints.addConstraint(e);
 
+    if (isRecoveryState()) {
+      pathDependent = true;
+    }
+
     if (isNormalState() && !isRecoveryState()) {
       if (!getSnapshots().empty()) {
         addGuidingConstraint(e);
@@ -302,6 +399,10 @@ public:
   bool merge(const ExecutionState &b);
   void dumpStack(llvm::raw_ostream &out) const;
 
+  /* the snapshots and the recovery cache are shared with the other states
+     which hold them, and are charged to each of them */
+  StateMemoryUsage getMemoryUsage() const;
+
   void setType(int type) {
     this->type = type;
   }
@@ -332,20 +433,32 @@ public:
     suspendStatus = false;
   }
 
-  std::vector< ref<Snapshot> > &getSnapshots() {
+  const std::vector< ref<Snapshot> > &getSnapshots() {
+    assert(isNormalState());
+    return snapshots.get();
+  }
+
+  void setSnapshots(const std::vector< ref<Snapshot> > &snapshots) {
     assert(isNormalState());
-    return snapshots;
+    this->snapshots = snapshots;
   }
 
   void addSnapshot(ref<Snapshot> snapshot) {
     assert(isNormalState());
-    snapshots.push_back(snapshot);
+    snapshots.mutate().push_back(snapshot);
+  }
+
+  /* the slot is kept, so the indices of the other snapshots are not changed */
+  void dropSnapshot(unsigned int index) {
+    assert(isNormalState());
+    assert(index < snapshots->size());
+    snapshots.mutate()[index] = ref<Snapshot>();
   }
 
   unsigned int getCurrentSnapshotIndex() {
     assert(isNormalState());
-    assert(!snapshots.empty());
-    return snapshots.size() - 1;
+    assert(!snapshots->empty());
+    return snapshots->size() - 1;
   }
 
   ExecutionState *getRecoveryState() {
@@ -379,24 +492,26 @@ public:
     blockingLoadStatus = true;
   }
 
-  std::set<uint64_t> &getRecoveredLoads() {
+  const FlatSet<uint64_t> &getRecoveredLoads() {
     assert(isNormalState());
-    return recoveredLoads;
+    return recoveredLoads.get();
   }
 
   void addRecoveredAddress(uint64_t address) {
     assert(isNormalState());
-    recoveredLoads.insert(address);
+    recoveredLoads.mutate().insert(address);
   }
 
   bool isAddressRecovered(uint64_t address) {
     assert(isNormalState());
-    return recoveredLoads.find(address) != recoveredLoads.end();
+    return recoveredLoads->find(address) != recoveredLoads->end();
   }
 
   void clearRecoveredAddresses() {
     assert(isNormalState());
-    recoveredLoads.clear();
+    if (!recoveredLoads->empty()) {
+      recoveredLoads = FlatSet<uint64_t>();
+    }
   }
 
   llvm::Instruction *getExitInst() {
@@ -441,11 +556,13 @@ public:
     this->recoveryInfo = recoveryInfo;
   }
 
-  void getCallTrace(std::vector<llvm::Instruction *> &callTrace);
+  /* the interned call trace of the current frame (see CallTraceNode), the
+     nodes are cached in the stack frames so this is amortized O(1) */
+  CallTraceNode *getCallTraceNode(Cloner *cloner);
 
   AllocationRecord &getAllocationRecord() {
     assert(isNormalState());
-    return allocationRecord;
+    return allocationRecord.mutate();
   }
 
   void setAllocationRecord(AllocationRecord &record) {
@@ -453,9 +570,15 @@ public:
     allocationRecord = record;
   }
 
+  /* shares the allocation record of the given state (no copy) */
+  void shareAllocationRecord(ExecutionState &state) {
+    assert(isNormalState() && state.isNormalState());
+    allocationRecord = state.allocationRecord;
+  }
+
   AllocationRecord &getGuidingAllocationRecord() {
     assert(isRecoveryState());
-    return guidingAllocationRecord;
+    return guidingAllocationRecord.mutate();
   }
 
   void setGuidingAllocationRecord(AllocationRecord &record) {
@@ -463,9 +586,15 @@ public:
     guidingAllocationRecord = record;
   }
 
-  std::set <ref<Expr> > &getGuidingConstraints() {
+  /* the guiding allocation record is materialized on first use */
+  void shareGuidingAllocationRecord(ExecutionState &state) {
+    assert(isRecoveryState() && state.isNormalState());
+    guidingAllocationRecord = state.allocationRecord;
+  }
+
+  const std::set <ref<Expr> > &getGuidingConstraints() {
     assert(isNormalState());
-    return guidingConstraints;
+    return guidingConstraints.get();
   }
 
   void setGuidingConstraints(std::set< ref<Expr> > &constraints) {
@@ -475,17 +604,19 @@ public:
 
   void addGuidingConstraint(ref<Expr> condition) {
     assert(isNormalState());
-    guidingConstraints.insert(condition);
+    guidingConstraints.mutate().insert(condition);
   }
 
   void clearGuidingConstraints() {
     assert(isNormalState());
-    guidingConstraints.clear();
+    if (!guidingConstraints->empty()) {
+      guidingConstraints = std::set< ref<Expr> >();
+    }
   }
 
   void addWrittenAddress(uint64_t address, size_t size, unsigned int snapshotIndex) {
     assert(isNormalState());
-    WrittenAddressInfo &info = writtenAddresses[address];
+    WrittenAddressInfo &info = writtenAddresses.mutate()[address];
     if (size > info.maxSize) {
       info.maxSize = size;
     }
@@ -495,8 +626,8 @@ public:
   bool getWrittenAddressInfo(uint64_t address, size_t loadSize,
                              WrittenAddressInfo &info) {
     assert(isNormalState());
-    WrittenAddresses::iterator i = writtenAddresses.find(address);
-    if (i == writtenAddresses.end()) {
+    WrittenAddresses::const_iterator i = writtenAddresses->find(address);
+    if (i == writtenAddresses->end()) {
       return false;
     }
 
@@ -537,9 +668,9 @@ public:
     return !pendingRecoveryInfos.empty();
   }
 
-  RecoveryCache &getRecoveryCache() {
+  const RecoveryCache &getRecoveryCache() {
     assert(isNormalState());
-    return recoveryCache;
+    return recoveryCache.get();
   }
 
   void setRecoveryCache(RecoveryCache &cache) {
@@ -547,15 +678,21 @@ public:
     recoveryCache = cache;
   }
 
+  /* shares the recovery cache of the given state (no copy) */
+  void shareRecoveryCache(ExecutionState &state) {
+    assert(isNormalState() && state.isNormalState());
+    recoveryCache = state.recoveryCache;
+    recoveredSlices = state.recoveredSlices;
+  }
+
   void updateRecoveredValue(
     unsigned int index,
     unsigned int sliceId,
     uint64_t address,
     ref<Expr> expr
   ) {
-    auto key = std::make_pair(index, sliceId);
-    ValuesCache &valuesCache = recoveryCache[key];
-    valuesCache[address] = expr;
+    RecoveryCacheKey key(std::make_pair(index, sliceId), address);
+    recoveryCache.mutate()[key] = expr;
   };
 
   bool getRecoveredValue(
@@ -564,22 +701,41 @@ public:
     uint64_t address,
     ref<Expr> &expr
   ) {
-    auto key = std::make_pair(index, sliceId);
-    RecoveryCache::iterator i = recoveryCache.find(key);
-    if (i == recoveryCache.end()) {
-      return false;
-    }
-
-    ValuesCache &valuesCache = i->second;
-    ValuesCache::iterator j = valuesCache.find(address);
-    if (j == valuesCache.end()) {
+    RecoveryCacheKey key(std::make_pair(index, sliceId), address);
+    RecoveryCache::const_iterator i = recoveryCache->find(key);
+    if (i == recoveryCache->end()) {
       return false;
     }
 
-    expr = j->second;
+    expr = i->second;
     return true;
   };
 
+  /* the recorded values which were written to [address, address + size) */
+  void getRecoveredValues(
+    unsigned int index,
+    unsigned int sliceId,
+    uint64_t address,
+    size_t size,
+    std::vector<std::pair<uint64_t, ref<Expr> > > &result
+  ) {
+    RecoveryCacheKey key(std::make_pair(index, sliceId), address);
+    for (RecoveryCache::const_iterator i = recoveryCache->lower_bound(key); i != recoveryCache->end(); i++) {
+      if (i->first.first != key.first || i->first.second >= address + size) {
+        break;
+      }
+      result.push_back(std::make_pair(i->first.second, i->second));
+    }
+  }
+
+  void addRecoveredSlice(unsigned int index, unsigned int sliceId) {
+    recoveredSlices.mutate().insert(std::make_pair(index, sliceId));
+  }
+
+  bool isRecoveredSlice(unsigned int index, unsigned int sliceId) {
+    return recoveredSlices->find(std::make_pair(index, sliceId)) != recoveredSlices->end();
+  }
+
   unsigned int getLevel() {
     assert(isRecoveryState());
     return level;
@@ -599,6 +755,26 @@ public:
     this->priority = priority;
   }
 
+  bool isPathDependent() {
+    assert(isRecoveryState());
+    return pathDependent;
+  }
+
+  void setPathDependent(bool pathDependent) {
+    assert(isRecoveryState());
+    this->pathDependent = pathDependent;
+  }
+
+  bool hasAllocated() {
+    assert(isRecoveryState());
+    return allocated;
+  }
+
+  void setAllocated(bool allocated) {
+    assert(isRecoveryState());
+    this->allocated = allocated;
+  }
+
 };
 
 }
@@ -471,6 +471,9 @@ public:
 
   unsigned getSize() const { return size; }
 
+  /// The number of update lists and update nodes which hold this node.
+  unsigned getRefCount() const { return refCount; }
+
   int compare(const UpdateNode &b) const;  
   unsigned hash() const { return hashValue; }
 
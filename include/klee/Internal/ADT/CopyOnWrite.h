@@ -0,0 +1,77 @@
+//===-- CopyOnWrite.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef __UTIL_COPYONWRITE_H__
+#define __UTIL_COPYONWRITE_H__
+
+#include <assert.h>
+
+namespace klee {
+  /// A value which is shared between copies of the owner (O(1) copy) and is
+  /// cloned only when a shared instance is modified. Readers must use get(),
+  /// writers must use mutate() (which invalidates previously obtained
+  /// references into a shared value of this instance).
+  template<class T>
+  class CopyOnWrite {
+    struct Node {
+      unsigned refCount;
+      T value;
+
+      Node() : refCount(1) {}
+      Node(const T &value) : refCount(1), value(value) {}
+    };
+
+    Node *node;
+
+    void release() {
+      assert(node->refCount > 0);
+      if (--node->refCount == 0)
+        delete node;
+    }
+
+  public:
+    CopyOnWrite() : node(new Node()) {}
+    CopyOnWrite(const T &value) : node(new Node(value)) {}
+    CopyOnWrite(const CopyOnWrite &b) : node(b.node) { ++node->refCount; }
+    ~CopyOnWrite() { release(); }
+
+    CopyOnWrite &operator=(const CopyOnWrite &b) {
+      ++b.node->refCount;
+      release();
+      node = b.node;
+      return *this;
+    }
+
+    CopyOnWrite &operator=(const T &value) {
+      if (node->refCount == 1) {
+        node->value = value;
+      } else {
+        release();
+        node = new Node(value);
+      }
+      return *this;
+    }
+
+    const T &get() const { return node->value; }
+    const T *operator->() const { return &node->value; }
+
+    T &mutate() {
+      if (node->refCount > 1) {
+        Node *copy = new Node(node->value);
+        release();
+        node = copy;
+      }
+      return node->value;
+    }
+
+    bool isShared() const { return node->refCount > 1; }
+  };
+}
+
+#endif
@@ -0,0 +1,56 @@
+//===-- FlatSet.h -----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef __UTIL_FLATSET_H__
+#define __UTIL_FLATSET_H__
+
+#include <algorithm>
+#include <vector>
+
+namespace klee {
+  /// An ordered set stored in a sorted vector: lookups are O(log n) binary
+  /// searches over contiguous memory, and copying the set is a single
+  /// allocation (instead of one allocation per node). Insertions of new
+  /// values are O(n), so it suits sets which are mostly queried and copied.
+  template<class T>
+  class FlatSet {
+  public:
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+  private:
+    std::vector<T> elements;
+
+  public:
+    const_iterator begin() const { return elements.begin(); }
+    const_iterator end() const { return elements.end(); }
+    size_t size() const { return elements.size(); }
+    bool empty() const { return elements.empty(); }
+    void clear() { elements.clear(); }
+
+    const_iterator find(const T &value) const {
+      const_iterator i = std::lower_bound(elements.begin(), elements.end(),
+                                          value);
+      if (i != elements.end() && !(value < *i))
+        return i;
+      return elements.end();
+    }
+
+    /// Returns false if the value is already present.
+    bool insert(const T &value) {
+      typename std::vector<T>::iterator i =
+        std::lower_bound(elements.begin(), elements.end(), value);
+      if (i != elements.end() && !(value < *i))
+        return false;
+      elements.insert(i, value);
+      return true;
+    }
+  };
+}
+
+#endif
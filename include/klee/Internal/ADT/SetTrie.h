@@ -0,0 +1,316 @@
+//===-- SetTrie.h -----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef __UTIL_SETTRIE_H__
+#define __UTIL_SETTRIE_H__
+
+#include <algorithm>
+#include <cassert>
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace klee {
+  /// A map from sets of small integers (sorted vectors of distinct ids) to
+  /// values, supporting the subset and superset queries of MapOfSets. Each
+  /// node of the trie holds a 64-bit Bloom signature of the ids below it, so
+  /// the superset search skips the subtrees which cannot contain all the
+  /// remaining ids of the key. The entries are kept in least recently used
+  /// order, so the map can be bounded by evicting its oldest entries.
+  template<class V>
+  class SetTrie {
+  public:
+    typedef std::vector<unsigned> key_type;
+
+  private:
+    struct Node {
+      unsigned id;
+      Node *parent;
+      std::map<unsigned, Node *> children;
+      /// the signature of the ids of this node and of its descendants
+      uint64_t signature;
+      bool hasValue;
+      V value;
+      typename std::list<Node *>::iterator age;
+
+      Node(unsigned _id, Node *_parent)
+        : id(_id), parent(_parent), signature(0), hasValue(false),
+          value() {}
+    };
+
+    typedef typename std::map<unsigned, Node *>::iterator child_iterator;
+
+    Node root;
+    /// the nodes holding a value, most recently used first
+    std::list<Node *> ages;
+
+    static uint64_t getSignature(unsigned id) {
+      return (uint64_t) 1 << ((id * 0x9E3779B9u) >> 26);
+    }
+
+    static uint64_t getSignature(key_type::const_iterator begin,
+                                 key_type::const_iterator end) {
+      uint64_t signature = 0;
+      for (; begin != end; ++begin)
+        signature |= getSignature(*begin);
+      return signature;
+    }
+
+    void touch(Node *n) {
+      ages.splice(ages.begin(), ages, n->age);
+    }
+
+    void getKey(const Node *n, key_type &key) const {
+      key.clear();
+      for (; n != &root; n = n->parent)
+        key.push_back(n->id);
+      std::reverse(key.begin(), key.end());
+    }
+
+    void destroy(Node *n) {
+      for (child_iterator it = n->children.begin(), ie = n->children.end();
+           it != ie; ++it) {
+        destroy(it->second);
+        delete it->second;
+      }
+      n->children.clear();
+    }
+
+    template<class Predicate>
+    Node *findSubset(Node *n, key_type &path,
+                     key_type::const_iterator begin,
+                     key_type::const_iterator end,
+                     Predicate &p);
+
+    template<class Predicate>
+    Node *findSuperset(Node *n, key_type &path,
+                       key_type::const_iterator begin,
+                       key_type::const_iterator end,
+                       Predicate &p);
+
+  public:
+    SetTrie() : root(0, 0) {}
+    ~SetTrie() { clear(); }
+
+    size_t size() const { return ages.size(); }
+
+    void clear() {
+      destroy(&root);
+      root.signature = 0;
+      root.hasValue = false;
+      ages.clear();
+    }
+
+    /// Returns the value of the given key, or null if the key is not present.
+    V *lookup(const key_type &key);
+
+    /// Inserts or replaces the value of the given key. Returns true if the key
+    /// was not present.
+    bool insert(const key_type &key, const V &value);
+
+    /// Returns the value of a subset of the given key on which the predicate
+    /// holds, or null. The predicate is called with the subset and its value.
+    template<class Predicate>
+    V *findSubset(const key_type &key, Predicate &p) {
+      key_type path;
+      Node *n = findSubset(&root, path, key.begin(), key.end(), p);
+      if (!n)
+        return 0;
+      touch(n);
+      return &n->value;
+    }
+
+    /// Returns the value of a superset of the given key on which the
+    /// predicate holds, or null.
+    template<class Predicate>
+    V *findSuperset(const key_type &key, Predicate &p) {
+      key_type path;
+      Node *n = findSuperset(&root, path, key.begin(), key.end(), p);
+      if (!n)
+        return 0;
+      touch(n);
+      return &n->value;
+    }
+
+    /// Removes the least recently used entry and returns its key and value.
+    bool evict(key_type &key, V &value);
+
+    /// Returns the entries from the least to the most recently used.
+    void getEntries(std::vector< std::pair<key_type, V> > &result) const;
+  };
+
+  /***/
+
+  template<class V>
+  V *SetTrie<V>::lookup(const key_type &key) {
+    Node *n = &root;
+    for (key_type::const_iterator it = key.begin(), ie = key.end();
+         it != ie; ++it) {
+      child_iterator child = n->children.find(*it);
+      if (child == n->children.end())
+        return 0;
+      n = child->second;
+    }
+
+    if (!n->hasValue)
+      return 0;
+    touch(n);
+    return &n->value;
+  }
+
+  template<class V>
+  bool SetTrie<V>::insert(const key_type &key, const V &value) {
+    Node *n = &root;
+    for (key_type::const_iterator it = key.begin(), ie = key.end();
+         it != ie; ++it) {
+      assert((it == key.begin() || *(it - 1) < *it) && "unsorted key");
+      Node *&child = n->children[*it];
+      if (!child)
+        child = new Node(*it, n);
+      n = child;
+    }
+
+    n->value = value;
+    if (n->hasValue) {
+      touch(n);
+      return false;
+    }
+
+    n->hasValue = true;
+    n->age = ages.insert(ages.begin(), n);
+
+    // the ids of the key are now below each node of its path
+    uint64_t signature = 0;
+    for (Node *m = n; m; m = m->parent) {
+      if (m != &root)
+        signature |= getSignature(m->id);
+      m->signature |= signature;
+    }
+    return true;
+  }
+
+  template<class V>
+  bool SetTrie<V>::evict(key_type &key, V &value) {
+    if (ages.empty())
+      return false;
+
+    Node *n = ages.back();
+    ages.pop_back();
+    getKey(n, key);
+    value = n->value;
+    n->hasValue = false;
+    n->value = V();
+
+    // drop the nodes which no longer lead to a value
+    while (n != &root && !n->hasValue && n->children.empty()) {
+      Node *parent = n->parent;
+      parent->children.erase(n->id);
+      delete n;
+      n = parent;
+    }
+
+    // the signatures cannot be updated by removing bits, so they are
+    // recomputed from the children
+    for (; n; n = n->parent) {
+      n->signature = n == &root ? 0 : getSignature(n->id);
+      for (child_iterator it = n->children.begin(), ie = n->children.end();
+           it != ie; ++it)
+        n->signature |= it->second->signature;
+    }
+    return true;
+  }
+
+  template<class V>
+  void SetTrie<V>::getEntries(std::vector< std::pair<key_type, V> > &result)
+    const {
+    result.clear();
+    result.reserve(ages.size());
+    for (typename std::list<Node *>::const_reverse_iterator
+           it = ages.rbegin(), ie = ages.rend(); it != ie; ++it) {
+      result.push_back(std::make_pair(key_type(), (*it)->value));
+      getKey(*it, result.back().first);
+    }
+  }
+
+  template<class V>
+  template<class Predicate>
+  typename SetTrie<V>::Node *
+  SetTrie<V>::findSubset(Node *n, key_type &path,
+                         key_type::const_iterator begin,
+                         key_type::const_iterator end,
+                         Predicate &p) {
+    if (n->hasValue && p(path, n->value))
+      return n;
+    if (begin == end)
+      return 0;
+
+    // only the children whose id is one of the remaining ids of the key
+    child_iterator kit = n->children.lower_bound(*begin);
+    child_iterator kend = n->children.end();
+    key_type::const_iterator it = begin;
+    while (it != end && kit != kend) {
+      if (*it < kit->first) {
+        ++it;
+      } else if (kit->first < *it) {
+        ++kit;
+      } else {
+        ++it;
+        path.push_back(kit->first);
+        Node *res = findSubset(kit->second, path, it, end, p);
+        path.pop_back();
+        if (res)
+          return res;
+        ++kit;
+      }
+    }
+    return 0;
+  }
+
+  template<class V>
+  template<class Predicate>
+  typename SetTrie<V>::Node *
+  SetTrie<V>::findSuperset(Node *n, key_type &path,
+                           key_type::const_iterator begin,
+                           key_type::const_iterator end,
+                           Predicate &p) {
+    if (begin == end) {
+      if (n->hasValue && p(path, n->value))
+        return n;
+      for (child_iterator it = n->children.begin(), ie = n->children.end();
+           it != ie; ++it) {
+        path.push_back(it->first);
+        Node *res = findSuperset(it->second, path, begin, end, p);
+        path.pop_back();
+        if (res)
+          return res;
+      }
+      return 0;
+    }
+
+    // the children after the next id of the key cannot lead to it
+    uint64_t signature = getSignature(begin, end);
+    for (child_iterator it = n->children.begin(), ie = n->children.end();
+         it != ie && it->first <= *begin; ++it) {
+      if ((it->second->signature & signature) != signature)
+        continue;
+      path.push_back(it->first);
+      Node *res = findSuperset(it->second, path,
+                               it->first == *begin ? begin + 1 : begin,
+                               end, p);
+      path.pop_back();
+      if (res)
+        return res;
+    }
+    return 0;
+  }
+}
+
+#endif
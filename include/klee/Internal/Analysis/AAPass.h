@@ -47,6 +47,9 @@ public:
 
   BVDataPTAImpl *getPTA() { return _pta; }
 
+  /* use precomputed results instead of running the analysis */
+  void setPTA(BVDataPTAImpl *pta) { _pta = pta; }
+
 private:
   void runPointerAnalysis(llvm::Module &module, u32_t kind);
 
@@ -0,0 +1,84 @@
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <istream>
+#include <ostream>
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/ADT/DenseMap.h>
+
+#include "AAPass.h"
+#include "ReachabilityAnalysis.h"
+#include "ModRefAnalysis.h"
+
+/* On-disk cache of the static analysis results (points-to sets, reachability
+ * and mod-ref information). The cache file is keyed by a hash of the analyzed
+ * module and of the skipping configuration, so a hit is only possible when
+ * the analyses would compute exactly the same results. */
+class AnalysisCache {
+public:
+  AnalysisCache(llvm::Module *module, std::string dir, std::string entry,
+                std::vector<std::string> targets, bool usePA);
+
+  ~AnalysisCache() {}
+
+  /* must be called after inlining, right before the pointer analysis */
+  void computeKey();
+
+  std::string getPath() { return path; }
+
+  /* returns false if there is no (valid) entry for this module */
+  bool load(AAPass *aa, ReachabilityAnalysis *ra, ModRefAnalysis *mra);
+
+  void save(AAPass *aa, ReachabilityAnalysis *ra, ModRefAnalysis *mra);
+
+private:
+  typedef std::pair<unsigned, unsigned> Location;
+
+  void buildValueTables();
+
+  void addConstant(llvm::Constant *c);
+
+  bool encodeValue(const llvm::Value *value, std::string &result);
+
+  bool decodeValue(const std::string &token, llvm::Value *&result);
+
+  template <typename T> bool decode(std::istream &is, T *&result);
+
+  bool savePointerAnalysis(AAPass *aa, std::ostream &os);
+
+  bool loadPointerAnalysis(std::istream &is, std::map<NodeID, PointsTo> &pts,
+                           unsigned &total);
+
+  bool saveReachability(ReachabilityAnalysis *ra, std::ostream &os);
+
+  bool loadReachability(std::istream &is, ReachabilityAnalysis *ra);
+
+  bool saveModRef(ModRefAnalysis *mra, std::ostream &os);
+
+  bool loadModRef(std::istream &is, ModRefAnalysis *mra);
+
+  llvm::Module *module;
+  std::string dir;
+  std::string entry;
+  std::vector<std::string> targets;
+  bool usePA;
+  std::string key;
+  std::string path;
+
+  /* value numbering (valid as long as the module is not modified) */
+  std::vector<llvm::Function *> functions;
+  std::vector<llvm::GlobalVariable *> globals;
+  std::vector<llvm::Constant *> constants;
+  std::vector<std::vector<llvm::Instruction *> > instructions;
+  llvm::DenseMap<const llvm::Value *, unsigned> indices;
+  llvm::DenseMap<const llvm::Instruction *, Location> locations;
+};
+
+#endif /* ANALYSISCACHE_H */
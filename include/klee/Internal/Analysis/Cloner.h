@@ -5,6 +5,7 @@
 #include <iostream>
 #include <set>
 #include <map>
+#include <mutex>
 
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Function.h>
@@ -54,6 +55,8 @@ private:
   ReachabilityAnalysis *ra;
   FunctionMap functionMap;
   CloneInfoMap cloneInfoMap;
+  /* the maps are updated by the background slicing worker */
+  std::mutex mapsLock;
   llvm::raw_ostream &debugs;
 };
 
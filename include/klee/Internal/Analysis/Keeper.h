@@ -5,6 +5,7 @@
 #include <string>
 #include "llvm/IR/Module.h"
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/Support/raw_ostream.h"
 #include "klee/Interpreter.h"
 #include "klee/TimerStatIncrementer.h" // chopstats
 #include "klee/ExecutionState.h" // recovery info
@@ -44,13 +45,23 @@ public:
   bool isFunctionToSkip(llvm::Function* f) ;
   // @brief return true if whitelist was updated
   bool updateWhiteList(llvm::Function* f);
-  void skippingRiskyFunction(llvm::Function* f);
+  // @brief what to do when skipping f (the memory retained by its snapshot is accounted)
+  void skippingRiskyFunction(llvm::Function* f, uint64_t snapshotUsage);
   // whether the executor should trigger a restart
   bool shouldRestartUponRecovery(llvm::Function* f, int cumulativeRecoveryTimeThresold);
   // @brief what to do when recovering a function
   void recoveringFunction(klee::ref<klee::RecoveryInfo> ri);
-  // @brief what to do when done recovering a function
-  void recoveredFunction(klee::ref<klee::RecoveryInfo> ri);
+  // @brief what to do when done recovering a function (instructions and forks executed by the recovery)
+  void recoveredFunction(klee::ref<klee::RecoveryInfo> ri, uint64_t instructions, unsigned forks);
+  // @brief skipped functions which are estimated to be cheaper to execute than to recover (online cost model),
+  // given the time (in microseconds) and the instructions executed so far
+  void selectFunctionsToKeep(std::vector<llvm::Function*>& result, int minRecoveries, double elapsedTime, uint64_t instructions);
+  // @brief keep f from now on (in-process restart), returns false if f was already kept
+  bool keepFunction(llvm::Function* f);
+  // @brief whether f was kept dynamically (heuristics or in-process restart)
+  bool isDynamicallyKept(llvm::Function* f) const;
+  // @brief per-function breakdown of the skips and recoveries (chopper.stats)
+  void writeStats(llvm::raw_ostream& os) const;
     
 private:
   void generateAncestors(std::set<const llvm::Function*>& ancestors);
@@ -85,11 +96,17 @@ private:
     uint64_t totalRecoveryTime;
     klee::WallTimer* recoveryTimer;
     int recoveryStackCount; // JOR: TODO: we should get rid of this hack
+    uint64_t recoveryInstructions; // executed by the recovery states
+    uint64_t recoveryForks; // branches taken by the recovery states
+    uint64_t snapshotUsage; // memory retained by the snapshots (estimate, bytes)
 
-    ChopperStats() : numSkips(0), numRecoveries(0), totalRecoveryTime(0), recoveryTimer(0x0), recoveryStackCount(0) { }
+    ChopperStats() : numSkips(0), numRecoveries(0), totalRecoveryTime(0), recoveryTimer(0x0), recoveryStackCount(0), recoveryInstructions(0), recoveryForks(0), snapshotUsage(0) { }
     bool adviseWhitelisting() const;
   };
   std::map<llvm::Function*, ChopperStats> chopstats;
+  // @brief static number of instructions of each function (for the cost model)
+  std::map<llvm::Function*, unsigned> functionSizes;
+  unsigned getFunctionSize(llvm::Function* f);
 
   // @brief fetches chopstats of f, creates one if there are none
   ChopperStats& getOrInsertChopstats(llvm::Function* f) {
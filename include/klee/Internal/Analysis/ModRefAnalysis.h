@@ -16,6 +16,8 @@
 #include "AAPass.h"
 
 class ModRefAnalysis {
+  friend class AnalysisCache;
+
 public:
   typedef std::set<llvm::Instruction *> InstructionSet;
 
@@ -98,6 +100,18 @@ public:
   void getApproximateModInfos(llvm::Instruction *inst, AllocSite hint,
                               std::set<ModInfo> &result);
 
+  /* incremental update of the results when a target function is removed
+     (kept), the affected loads and stores (whose mayBlock and mayOverride
+     results may change) are added to affected */
+  void removeTarget(llvm::Function *f, InstructionSet &affected);
+
+  /* returns a slice id which is not used by any side effect */
+  uint32_t allocateSliceId();
+
+  /* functions with loads which may depend on the side effects of f */
+  void getDependentFunctions(llvm::Function *f,
+                             std::set<llvm::Function *> &result);
+
   void dumpModSetMap();
 
   void dumpDependentLoads();
@@ -135,8 +149,14 @@ private:
 
   void computeModRefInfo();
 
+  void computeModRefInfo(llvm::Function *f);
+
   void computeModInfoToStoreMap();
 
+  void computeModInfoToStoreMap(llvm::Function *f);
+
+  void recomputeOverridingStores(InstructionSet &affected);
+
   AllocSite getAllocSite(NodeID);
 
   bool hasReturnValue(llvm::Function *f);
@@ -176,6 +196,8 @@ private:
 
   InstructionSet overridingStores;
 
+  uint32_t nextSliceId;
+
   ReachabilityCache cache;
 
   llvm::raw_ostream &debugs;
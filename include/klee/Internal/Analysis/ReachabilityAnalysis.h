@@ -14,6 +14,8 @@
 #include "AAPass.h"
 
 class ReachabilityAnalysis {
+  friend class AnalysisCache;
+
 public:
   typedef std::set<llvm::Function *> FunctionSet;
   typedef std::set<llvm::Instruction *> InstructionSet;
@@ -3,11 +3,18 @@
 
 #include <stdbool.h>
 #include <iostream>
+#include <deque>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Function.h>
 
 #include "llvm/analysis/PointsTo/PointsTo.h"
+#include "llvm/analysis/ReachingDefinitions/ReachingDefinitions.h"
 
 #include "AAPass.h"
 #include "ReachabilityAnalysis.h"
@@ -17,11 +24,25 @@
 
 class SliceGenerator {
 public:
+  /* scheduling priorities of the background worker (highest first) */
+  typedef enum {
+    /* a recovery state is waiting for the slice */
+    SLICE_NEEDED,
+    /* the function was skipped, so a recovery is likely */
+    SLICE_SKIPPED,
+    /* ahead-of-time generation */
+    SLICE_AHEAD,
+    SLICE_PRIORITIES,
+  } SlicePriority;
+
   SliceGenerator(llvm::Module *module, ReachabilityAnalysis *ra, AAPass *aa,
                  ModRefAnalysis *mra, Cloner *cloner, llvm::raw_ostream &debugs,
-                 bool lazyMode = false)
+                 bool lazyMode = false, bool backgroundMode = false,
+                 bool reuseReachingDefinitions = true)
       : module(module), ra(ra), aa(aa), mra(mra), cloner(cloner),
-        debugs(debugs), lazyMode(lazyMode), annotator(0), llvmpta(0) {}
+        debugs(debugs), lazyMode(lazyMode), backgroundMode(backgroundMode),
+        reuseReachingDefinitions(reuseReachingDefinitions), annotator(0),
+        llvmpta(0), worker(0), stopping(false) {}
 
   ~SliceGenerator();
 
@@ -32,9 +53,57 @@ public:
 
   void dumpSlice(llvm::Function *f, uint32_t sliceId, bool recursively = false);
 
+  /* returns the id of a slice which is the union of the given modifier
+     slices (the slice is generated on demand, like any other slice) */
+  uint32_t getUnionSliceId(const std::set<uint32_t> &sliceIds);
+
+  bool isBackground() const { return backgroundMode; }
+
+  /* must be called once the module is prepared (KFunctions are built) */
+  void startWorker();
+
+  void stopWorker();
+
+  /* schedule the slices of all the side effects of a skipped function */
+  void scheduleSlices(llvm::Function *f, SlicePriority priority);
+
+  /* blocks until the slice is generated by the background worker */
+  void waitForSlice(llvm::Function *f, uint32_t sliceId,
+                    ModRefAnalysis::SideEffectType type);
+
+  /* the worker builds the dependence graph without this lock, and holds it
+     only while it creates and slices the clone (which updates the use lists
+     of the shared constants and globals). Any other access to the module
+     (other than reading the instructions of installed functions) must hold
+     this lock while the worker is running: this includes the analyses which
+     walk the module at run time (reachability, mod-ref updates) and the
+     lookups in its symbol table */
+  std::mutex &getModuleLock() { return moduleLock; }
+
 private:
+  typedef std::pair<llvm::Function *, uint32_t> SliceKey;
+
+  struct SliceRequest {
+    llvm::Function *f;
+    uint32_t sliceId;
+    ModRefAnalysis::SideEffectType type;
+  };
+
   void markAsSliced(llvm::Function *sliceEntry, uint32_t sliceId);
 
+  dg::analysis::rd::LLVMReachingDefinitions *
+  getReachingDefinitions(llvm::Function *f);
+
+  void releaseReachingDefinitions(llvm::Function *f);
+
+  bool isUnionSlice(uint32_t sliceId);
+
+  bool getUnionComponents(uint32_t sliceId, std::set<uint32_t> &result);
+
+  void schedule(SliceRequest &request, SlicePriority priority);
+
+  void runWorker();
+
   llvm::Module *module;
   ReachabilityAnalysis *ra;
   AAPass *aa;
@@ -42,8 +111,31 @@ private:
   Cloner *cloner;
   llvm::raw_ostream &debugs;
   bool lazyMode;
+  bool backgroundMode;
+  bool reuseReachingDefinitions;
   Annotator *annotator;
   dg::LLVMPointerAnalysis *llvmpta;
+
+  /* the reaching definitions of the functions which still have slices to
+     generate, and the number of these slices */
+  std::map<llvm::Function *, dg::analysis::rd::LLVMReachingDefinitions *> rds;
+  std::map<llvm::Function *, unsigned> pendingSlices;
+
+  /* union slices */
+  std::map<std::set<uint32_t>, uint32_t> unionIds;
+  std::map<uint32_t, std::set<uint32_t> > unionComponents;
+  std::mutex unionLock;
+
+  /* background slicing */
+  std::thread *worker;
+  bool stopping;
+  std::deque<SliceRequest> queues[SLICE_PRIORITIES];
+  std::set<llvm::Function *> scheduledFunctions;
+  std::set<SliceKey> generatedSlices;
+  std::mutex queueLock;
+  std::condition_variable queueCond;
+  std::condition_variable generatedCond;
+  std::mutex moduleLock;
 };
 
 #endif
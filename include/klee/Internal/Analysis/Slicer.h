@@ -26,17 +26,31 @@ protected:
   std::string entryFunction;
   std::vector<std::string> criterions;
   LLVMPointerAnalysis *PTA;
-  std::unique_ptr<LLVMReachingDefinitions> RD;
+  /* the reaching definitions, computed by the slicer unless they are
+     shared with the other slicers of the entry function */
+  std::unique_ptr<LLVMReachingDefinitions> ownRD;
+  LLVMReachingDefinitions *RD;
   LLVMDependenceGraph dg;
   LLVMSlicer slicer;
 
 public:
   Slicer(llvm::Module *mod, uint32_t o, std::string entryFunction,
          std::vector<std::string> criterions, LLVMPointerAnalysis *llvmpta,
-         Cloner *cloner);
+         Cloner *cloner, LLVMReachingDefinitions *rd = nullptr);
   ~Slicer();
 
+  /* the reaching definitions are computed over the original functions
+     (slicing only changes the dependence graph and the clones), so they
+     can be computed once and passed to each slicer of the function */
+  static LLVMReachingDefinitions *
+  createReachingDefinitions(llvm::Module *mod, LLVMPointerAnalysis *llvmpta,
+                            std::string entryFunction);
+
   int run();
+  /* builds and marks the dependence graph (reads the original functions) */
+  bool analyze();
+  /* slices the clones according to the marked graph */
+  int project();
   bool buildDG();
   bool mark();
   void computeEdges();
@@ -151,6 +151,10 @@ namespace klee {
 
     void addFunction(KFunction *kf, bool isSkippingFunctions, Cloner *cloner, ModRefAnalysis *mra);
 
+    /// Update the mod-ref flags of the (original and cloned) instructions
+    /// after an incremental update of the mod-ref analysis.
+    void updateModRefFlags(ModRefAnalysis *mra, const std::set<llvm::Instruction *> &affected);
+
   };
 } // End klee namespace
 
@@ -46,6 +46,10 @@ public:
 
   virtual void incSnapshotsCount() = 0;
 
+  /// Called in a forked worker process (see -threads), the output of the
+  /// worker should not be mixed with the output of the other workers.
+  virtual void setWorkerId(unsigned id) = 0;
+
   virtual void processTestCase(const ExecutionState &state,
                                const char *err, 
                                const char *suffix) = 0;
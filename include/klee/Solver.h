@@ -16,6 +16,7 @@
 #include <vector>
 
 namespace klee {
+  class ArrayCache;
   class ConstraintManager;
   class Expr;
   class SolverImpl;
@@ -280,7 +281,9 @@ namespace klee {
   /// quickly find satisfying assignments.
   ///
   /// \param s - The underlying solver to use.
-  Solver *createCexCachingSolver(Solver *s);
+  /// \param arrayCache - The array cache of the queries. The cache is only
+  /// persisted across runs (see -cex-cache-file) if it is given.
+  Solver *createCexCachingSolver(Solver *s, ArrayCache *arrayCache = 0);
 
   /// createFastCexSolver - Create a "fast counterexample solver", which tries
   /// to quickly compute a satisfying assignment for a constraint set using
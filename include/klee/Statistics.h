@@ -67,6 +67,10 @@ namespace klee {
                                uint64_t addend) const;
     uint64_t getIndexedValue(const Statistic &s, unsigned index) const;
     void setIndexedValue(const Statistic &s, unsigned index, uint64_t value);
+    /* updates only the total (e.g., with the values of a worker process) */
+    void incrementGlobalValue(const Statistic &s, uint64_t addend) {
+      globalStats[s.id] += addend;
+    }
     int getStatisticID(const std::string &name) const;
     Statistic *getStatisticByName(const std::string &name) const;
   };
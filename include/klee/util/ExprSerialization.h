@@ -0,0 +1,114 @@
+//===-- ExprSerialization.h -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRSERIALIZATION_H
+#define KLEE_EXPRSERIALIZATION_H
+
+#include "klee/Expr.h"
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace klee {
+  class ArrayCache;
+
+  /// Writes expressions to a binary stream. The expressions, update nodes and
+  /// arrays which were already written by this writer are written as
+  /// back references, so shared subexpressions are read back as shared
+  /// subexpressions by an ExprReader of the same stream. A subclass can also
+  /// write expressions and update nodes as references into a table which is
+  /// shared with its reader (see isShared).
+  class ExprWriter {
+    std::ostream &os;
+    /// the written expressions are held, so their addresses are not reused
+    std::vector< ref<Expr> > written;
+    std::map<const Expr *, unsigned> exprIds;
+    std::map<const UpdateNode *, unsigned> nodeIds;
+    std::map<const Array *, unsigned> arrayIds;
+
+    void writeNode(const UpdateNode *un);
+
+  protected:
+    /// Writes an array which was not written yet, by default its name, size,
+    /// domain, range and constant values.
+    virtual void writeArrayDecl(const Array *array);
+
+    /// Whether an expression (update node) which was not written yet is
+    /// written by writeShared instead of by its contents, by default none is.
+    virtual bool isShared(const Expr *e) { return false; }
+    virtual bool isShared(const UpdateNode *un) { return false; }
+
+    virtual void writeShared(const ref<Expr> &e) {}
+    virtual void writeShared(const UpdateNode *un) {}
+
+  public:
+    explicit ExprWriter(std::ostream &_os) : os(_os) {}
+    virtual ~ExprWriter() {}
+
+    void writeInt(uint64_t value);
+    void writeString(const std::string &s);
+    void writeBytes(const void *data, size_t size);
+
+    void write(const ref<Expr> &e);
+    void write(const UpdateList &updates);
+    void write(const Array *array);
+
+    bool good() const { return os.good(); }
+  };
+
+  /// Reads the expressions written by an ExprWriter, in the same order. The
+  /// expressions are rebuilt without simplification. Reading stops at the
+  /// first malformed record, after which good() returns false and null
+  /// expressions are returned.
+  class ExprReader {
+    std::istream &is;
+    std::vector< ref<Expr> > exprs;
+    std::vector<const UpdateNode *> nodes;
+    std::vector<UpdateList> heads;
+    std::vector<const Array *> arrays;
+    bool failed;
+
+    const UpdateNode *readNode();
+
+  protected:
+    ArrayCache *arrayCache;
+
+    /// Reads an array written by ExprWriter::writeArrayDecl, the arrays are
+    /// created by the array cache (symbolic arrays are therefore shared with
+    /// the arrays of the same name and size).
+    virtual const Array *readArrayDecl();
+
+    /// Read the records written by ExprWriter::writeShared. The returned
+    /// update nodes must be held by the subclass until the reader is done.
+    virtual ref<Expr> readSharedExpr() { return 0; }
+    virtual const UpdateNode *readSharedNode() { return 0; }
+
+    void fail() { failed = true; }
+
+  public:
+    ExprReader(std::istream &_is, ArrayCache *_arrayCache)
+      : is(_is), failed(false), arrayCache(_arrayCache) {}
+    virtual ~ExprReader() {}
+
+    uint64_t readInt();
+    std::string readString();
+    void readBytes(void *data, size_t size);
+
+    ref<Expr> read();
+    UpdateList readUpdates();
+    const Array *readArray();
+
+    bool good() const { return !failed && is.good(); }
+  };
+}
+
+#endif
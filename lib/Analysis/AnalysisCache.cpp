@@ -0,0 +1,786 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <map>
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/Support/InstIterator.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "MemoryModel/PointerAnalysis.h"
+
+#include "klee/Internal/Analysis/AnalysisCache.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+
+using namespace std;
+using namespace llvm;
+
+/* bump when the format (or the semantics of a cached analysis) changes */
+#define ANALYSIS_CACHE_VERSION 2
+
+/* points-to results which are read from the cache instead of being solved,
+   only the PAG is (deterministically) rebuilt from the module */
+class CachedPointerAnalysis : public BVDataPTAImpl {
+public:
+    CachedPointerAnalysis(map<NodeID, PointsTo> &pts) :
+        BVDataPTAImpl(PointerAnalysis::Andersen_WPA)
+    {
+        this->pts.swap(pts);
+    }
+
+    virtual void analyze(llvm::Module &module) {
+        initialize(module);
+        for (map<NodeID, PointsTo>::iterator i = pts.begin(); i != pts.end(); i++) {
+            unionPts(i->first, i->second);
+        }
+        pts.clear();
+    }
+
+private:
+    map<NodeID, PointsTo> pts;
+};
+
+/* FNV-1a, stable across runs and hosts */
+static uint64_t hashBytes(uint64_t hash, const string &bytes) {
+    for (string::const_iterator i = bytes.begin(); i != bytes.end(); i++) {
+        hash ^= (unsigned char)(*i);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static bool expect(istream &is, const char *section) {
+    string token;
+    return (is >> token) && token == section;
+}
+
+static void savePointsTo(ostream &os, PointsTo &pts) {
+    os << pts.count();
+    for (PointsTo::iterator i = pts.begin(); i != pts.end(); ++i) {
+        os << " " << *i;
+    }
+}
+
+static bool loadPointsTo(istream &is, PointsTo &pts) {
+    unsigned size;
+    NodeID id;
+    if (!(is >> size)) {
+        return false;
+    }
+    for (unsigned i = 0; i < size; i++) {
+        if (!(is >> id)) {
+            return false;
+        }
+        pts.set(id);
+    }
+    return true;
+}
+
+AnalysisCache::AnalysisCache(
+    Module *module,
+    string dir,
+    string entry,
+    vector<string> targets,
+    bool usePA
+) :
+    module(module), dir(dir), entry(entry), targets(targets), usePA(usePA)
+{
+
+}
+
+void AnalysisCache::computeKey() {
+    string bitcode;
+    raw_string_ostream bos(bitcode);
+    WriteBitcodeToFile(module, bos);
+    bos.flush();
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = hashBytes(hash, bitcode);
+    hash = hashBytes(hash, entry);
+    for (vector<string>::iterator i = targets.begin(); i != targets.end(); i++) {
+        hash = hashBytes(hash, "," + *i);
+    }
+    hash = hashBytes(hash, usePA ? "+pa" : "-pa");
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)(hash));
+    key = buf;
+    path = dir + "/" + key + ".analysis";
+
+    buildValueTables();
+}
+
+void AnalysisCache::buildValueTables() {
+    for (Module::iterator f = module->begin(); f != module->end(); f++) {
+        unsigned fi = functions.size();
+        functions.push_back(&*f);
+        indices[&*f] = fi;
+
+        instructions.push_back(vector<Instruction *>());
+        vector<Instruction *> &insts = instructions.back();
+        if (f->isDeclaration()) {
+            continue;
+        }
+        for (inst_iterator i = inst_begin(&*f); i != inst_end(&*f); i++) {
+            locations[&*i] = make_pair(fi, (unsigned)(insts.size()));
+            insts.push_back(&*i);
+        }
+    }
+
+    for (Module::global_iterator g = module->global_begin(); g != module->global_end(); g++) {
+        indices[&*g] = globals.size();
+        globals.push_back(&*g);
+    }
+
+    /* the other constants are numbered in the order of their first use */
+    for (Module::global_iterator g = module->global_begin(); g != module->global_end(); g++) {
+        if (g->hasInitializer()) {
+            addConstant(g->getInitializer());
+        }
+    }
+    for (vector<vector<Instruction *> >::iterator f = instructions.begin(); f != instructions.end(); f++) {
+        for (vector<Instruction *>::iterator i = f->begin(); i != f->end(); i++) {
+            for (User::op_iterator op = (*i)->op_begin(); op != (*i)->op_end(); op++) {
+                if (Constant *c = dyn_cast<Constant>(op->get())) {
+                    addConstant(c);
+                }
+            }
+        }
+    }
+}
+
+void AnalysisCache::addConstant(Constant *c) {
+    if (isa<GlobalValue>(c) || indices.count(c)) {
+        return;
+    }
+
+    indices[c] = constants.size();
+    constants.push_back(c);
+    for (User::op_iterator op = c->op_begin(); op != c->op_end(); op++) {
+        addConstant(cast<Constant>(op->get()));
+    }
+}
+
+bool AnalysisCache::encodeValue(const Value *value, string &result) {
+    char buf[64];
+
+    if (!value) {
+        result = "n";
+        return true;
+    }
+
+    if (const Instruction *inst = dyn_cast<Instruction>(value)) {
+        DenseMap<const Instruction *, Location>::iterator i = locations.find(inst);
+        if (i == locations.end()) {
+            return false;
+        }
+        snprintf(buf, sizeof(buf), "i:%u:%u", i->second.first, i->second.second);
+    } else if (const Argument *arg = dyn_cast<Argument>(value)) {
+        DenseMap<const Value *, unsigned>::iterator i = indices.find(arg->getParent());
+        if (i == indices.end()) {
+            return false;
+        }
+        snprintf(buf, sizeof(buf), "a:%u:%u", i->second, arg->getArgNo());
+    } else if (isa<Function>(value) || isa<GlobalVariable>(value)) {
+        DenseMap<const Value *, unsigned>::iterator i = indices.find(value);
+        if (i == indices.end()) {
+            return false;
+        }
+        snprintf(buf, sizeof(buf), "%c:%u", isa<Function>(value) ? 'f' : 'g', i->second);
+    } else if (isa<Constant>(value) && !isa<GlobalValue>(value)) {
+        DenseMap<const Value *, unsigned>::iterator i = indices.find(value);
+        if (i == indices.end()) {
+            klee::klee_warning("analysis cache: constant is not used by the module");
+            return false;
+        }
+        snprintf(buf, sizeof(buf), "c:%u", i->second);
+    } else {
+        string str;
+        raw_string_ostream rso(str);
+        value->print(rso);
+        klee::klee_warning("analysis cache: unable to encode value: %s", rso.str().c_str());
+        return false;
+    }
+
+    result = buf;
+    return true;
+}
+
+bool AnalysisCache::decodeValue(const string &token, Value *&result) {
+    unsigned x, y;
+
+    result = NULL;
+    if (token == "n") {
+        return true;
+    }
+
+    if (sscanf(token.c_str(), "i:%u:%u", &x, &y) == 2) {
+        if (x >= instructions.size() || y >= instructions[x].size()) {
+            return false;
+        }
+        result = instructions[x][y];
+    } else if (sscanf(token.c_str(), "a:%u:%u", &x, &y) == 2) {
+        if (x >= functions.size() || y >= functions[x]->arg_size()) {
+            return false;
+        }
+        Function::arg_iterator arg = functions[x]->arg_begin();
+        std::advance(arg, y);
+        result = &*arg;
+    } else if (sscanf(token.c_str(), "f:%u", &x) == 1) {
+        if (x >= functions.size()) {
+            return false;
+        }
+        result = functions[x];
+    } else if (sscanf(token.c_str(), "g:%u", &x) == 1) {
+        if (x >= globals.size()) {
+            return false;
+        }
+        result = globals[x];
+    } else if (sscanf(token.c_str(), "c:%u", &x) == 1) {
+        if (x >= constants.size()) {
+            return false;
+        }
+        result = constants[x];
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T> bool AnalysisCache::decode(istream &is, T *&result) {
+    string token;
+    Value *value;
+
+    if (!(is >> token) || !decodeValue(token, value)) {
+        return false;
+    }
+
+    result = dyn_cast_or_null<T>(value);
+    return result != NULL;
+}
+
+bool AnalysisCache::load(AAPass *aa, ReachabilityAnalysis *ra, ModRefAnalysis *mra) {
+    ifstream is(path.c_str());
+    if (!is.good()) {
+        return false;
+    }
+
+    string header, cachedKey;
+    unsigned version;
+    if (!(is >> header >> version >> cachedKey) ||
+        header != "chopper-analysis-cache" ||
+        version != ANALYSIS_CACHE_VERSION ||
+        cachedKey != key) {
+        klee::klee_warning("ignoring stale analysis cache: %s", path.c_str());
+        return false;
+    }
+
+    /* the PAG is rebuilt, so the node ids must match the cached ones */
+    map<NodeID, PointsTo> pts;
+    unsigned total;
+    if (!loadPointerAnalysis(is, pts, total)) {
+        klee::klee_warning("ignoring corrupted analysis cache: %s", path.c_str());
+        return false;
+    }
+
+    CachedPointerAnalysis *pta = new CachedPointerAnalysis(pts);
+    pta->analyze(*module);
+    if (pta->getPAG()->getTotalNodeNum() != total) {
+        klee::klee_warning("ignoring stale analysis cache: %s", path.c_str());
+        delete pta;
+        return false;
+    }
+
+    if (!loadReachability(is, ra) || !loadModRef(is, mra) || !expect(is, "end")) {
+        klee::klee_warning("ignoring corrupted analysis cache: %s", path.c_str());
+        delete pta;
+        return false;
+    }
+
+    aa->setPTA(pta);
+    return true;
+}
+
+void AnalysisCache::save(AAPass *aa, ReachabilityAnalysis *ra, ModRefAnalysis *mra) {
+    /* write to a temporary file first, the cache directory may be shared */
+    string tmpPath = path + ".tmp" + to_string(getpid());
+    ofstream os(tmpPath.c_str());
+    if (!os.good()) {
+        klee::klee_warning("unable to write analysis cache: %s", tmpPath.c_str());
+        return;
+    }
+
+    os << "chopper-analysis-cache " << ANALYSIS_CACHE_VERSION << " " << key << "\n";
+    bool success = savePointerAnalysis(aa, os) &&
+                   saveReachability(ra, os) &&
+                   saveModRef(mra, os);
+    os << "end\n";
+    os.close();
+
+    if (!success || os.fail() || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        klee::klee_warning("unable to write analysis cache: %s", path.c_str());
+        remove(tmpPath.c_str());
+    }
+}
+
+bool AnalysisCache::savePointerAnalysis(AAPass *aa, ostream &os) {
+    BVDataPTAImpl *pta = aa->getPTA();
+    PAG *pag = pta->getPAG();
+
+    vector<NodeID> nodes;
+    for (PAG::iterator i = pag->begin(); i != pag->end(); i++) {
+        NodeID id = i->first;
+        if (!pta->getPts(id).empty()) {
+            nodes.push_back(id);
+        }
+    }
+
+    os << "pts " << pag->getTotalNodeNum() << " " << nodes.size() << "\n";
+    for (vector<NodeID>::iterator i = nodes.begin(); i != nodes.end(); i++) {
+        os << *i << " ";
+        savePointsTo(os, pta->getPts(*i));
+        os << "\n";
+    }
+
+    return true;
+}
+
+bool AnalysisCache::loadPointerAnalysis(istream &is, map<NodeID, PointsTo> &pts,
+                                        unsigned &total) {
+    unsigned count;
+    if (!expect(is, "pts") || !(is >> total >> count)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        NodeID id;
+        if (!(is >> id) || !loadPointsTo(is, pts[id])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool AnalysisCache::saveReachability(ReachabilityAnalysis *ra, ostream &os) {
+    string token;
+
+    os << "reachability " << ra->reachabilityMap.size() << "\n";
+    for (ReachabilityAnalysis::ReachabilityMap::iterator i = ra->reachabilityMap.begin();
+         i != ra->reachabilityMap.end(); i++) {
+        if (!encodeValue(i->first, token)) {
+            return false;
+        }
+        os << token << " " << i->second.size();
+        for (ReachabilityAnalysis::FunctionSet::iterator j = i->second.begin();
+             j != i->second.end(); j++) {
+            if (!encodeValue(*j, token)) {
+                return false;
+            }
+            os << " " << token;
+        }
+        os << "\n";
+    }
+
+    return true;
+}
+
+bool AnalysisCache::loadReachability(istream &is, ReachabilityAnalysis *ra) {
+    ReachabilityAnalysis::ReachabilityMap reachabilityMap;
+    unsigned count, size;
+
+    if (!expect(is, "reachability") || !(is >> count)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        Function *f, *g;
+        if (!decode(is, f) || !(is >> size)) {
+            return false;
+        }
+
+        ReachabilityAnalysis::FunctionSet &functions = reachabilityMap[f];
+        for (unsigned j = 0; j < size; j++) {
+            if (!decode(is, g)) {
+                return false;
+            }
+            functions.insert(g);
+        }
+    }
+
+    ra->entryFunction = module->getFunction(entry);
+    ra->reachabilityMap = reachabilityMap;
+    return true;
+}
+
+bool AnalysisCache::saveModRef(ModRefAnalysis *mra, ostream &os) {
+    string token, site;
+
+#define ENCODE(value, out) \
+    if (!encodeValue((value), (out))) { \
+        return false; \
+    }
+
+#define ENCODE_INSTRUCTIONS(insts) \
+    os << (insts).size(); \
+    for (ModRefAnalysis::InstructionSet::iterator j = (insts).begin(); j != (insts).end(); j++) { \
+        ENCODE(*j, token); \
+        os << " " << token; \
+    } \
+    os << "\n";
+
+#define ENCODE_MODINFO(modInfo) \
+    ENCODE((modInfo).first, token); \
+    ENCODE((modInfo).second.first, site); \
+    os << token << " " << site << " " << (modInfo).second.second;
+
+    os << "targets " << mra->targetFunctions.size();
+    for (vector<Function *>::iterator i = mra->targetFunctions.begin(); i != mra->targetFunctions.end(); i++) {
+        ENCODE(*i, token);
+        os << " " << token;
+    }
+    os << "\n";
+
+    os << "mod-sets " << mra->modSetMap.size() << "\n";
+    for (ModRefAnalysis::ModSetMap::iterator i = mra->modSetMap.begin(); i != mra->modSetMap.end(); i++) {
+        ENCODE(i->first, token);
+        os << token << " ";
+        ENCODE_INSTRUCTIONS(i->second);
+    }
+
+    os << "dependent-loads ";
+    ENCODE_INSTRUCTIONS(mra->dependentLoads);
+
+    os << "overriding-stores ";
+    ENCODE_INSTRUCTIONS(mra->overridingStores);
+
+    os << "load-to-modinfo " << mra->loadToModInfoMap.size() << "\n";
+    for (ModRefAnalysis::LoadToModInfoMap::iterator i = mra->loadToModInfoMap.begin();
+         i != mra->loadToModInfoMap.end(); i++) {
+        ENCODE(i->first, token);
+        os << token << " " << i->second.size();
+        for (set<ModRefAnalysis::ModInfo>::iterator j = i->second.begin(); j != i->second.end(); j++) {
+            os << " ";
+            ENCODE_MODINFO(*j);
+        }
+        os << "\n";
+    }
+
+    os << "modinfo-to-store " << mra->modInfoToStoreMap.size() << "\n";
+    for (ModRefAnalysis::ModInfoToStoreMap::iterator i = mra->modInfoToStoreMap.begin();
+         i != mra->modInfoToStoreMap.end(); i++) {
+        ENCODE_MODINFO(i->first);
+        os << " ";
+        ENCODE_INSTRUCTIONS(i->second);
+    }
+
+    os << "modinfo-to-id " << mra->modInfoToIdMap.size() << "\n";
+    for (ModRefAnalysis::ModInfoToIdMap::iterator i = mra->modInfoToIdMap.begin();
+         i != mra->modInfoToIdMap.end(); i++) {
+        ENCODE_MODINFO(i->first);
+        os << " " << i->second << "\n";
+    }
+
+    os << "ret-slice-ids " << mra->retSliceIdMap.size() << "\n";
+    for (ModRefAnalysis::RetSliceIdMap::iterator i = mra->retSliceIdMap.begin();
+         i != mra->retSliceIdMap.end(); i++) {
+        ENCODE(i->first, token);
+        os << token << " " << i->second << "\n";
+    }
+
+    /* the per-object maps, used by the incremental updates */
+    os << "mod-pts " << mra->modPtsMap.size() << "\n";
+    for (ModRefAnalysis::ModPtsMap::iterator i = mra->modPtsMap.begin(); i != mra->modPtsMap.end(); i++) {
+        ENCODE(i->first, token);
+        os << token << " ";
+        savePointsTo(os, i->second);
+        os << "\n";
+    }
+
+    os << "ref-pts " << mra->refPtsMap.size() << "\n";
+    for (ModRefAnalysis::RefPtsMap::iterator i = mra->refPtsMap.begin(); i != mra->refPtsMap.end(); i++) {
+        ENCODE(i->first, token);
+        os << token << " ";
+        savePointsTo(os, i->second);
+        os << "\n";
+    }
+
+    os << "obj-to-store " << mra->objToStoreMap.size() << "\n";
+    for (ModRefAnalysis::ObjToStoreMap::iterator i = mra->objToStoreMap.begin();
+         i != mra->objToStoreMap.end(); i++) {
+        ENCODE(i->first.first, token);
+        os << token << " " << i->first.second << " ";
+        ENCODE_INSTRUCTIONS(i->second);
+    }
+
+    os << "obj-to-load " << mra->objToLoadMap.size() << "\n";
+    for (ModRefAnalysis::ObjToLoadMap::iterator i = mra->objToLoadMap.begin();
+         i != mra->objToLoadMap.end(); i++) {
+        ENCODE(i->first.first, token);
+        os << token << " " << i->first.second << " ";
+        ENCODE_INSTRUCTIONS(i->second);
+    }
+
+    os << "obj-to-overriding-store " << mra->objToOverridingStoreMap.size() << "\n";
+    for (ModRefAnalysis::ObjToOverridingStoreMap::iterator i = mra->objToOverridingStoreMap.begin();
+         i != mra->objToOverridingStoreMap.end(); i++) {
+        os << i->first << " ";
+        ENCODE_INSTRUCTIONS(i->second);
+    }
+
+    os << "side-effects " << mra->sideEffects.size() << "\n";
+    for (ModRefAnalysis::SideEffects::iterator i = mra->sideEffects.begin();
+         i != mra->sideEffects.end(); i++) {
+        os << i->type << " " << i->id << " ";
+        if (i->type == ModRefAnalysis::ReturnValue) {
+            ENCODE(i->info.f, token);
+            os << token;
+        } else {
+            ENCODE_MODINFO(i->info.modInfo);
+        }
+        os << "\n";
+    }
+
+#undef ENCODE_MODINFO
+#undef ENCODE_INSTRUCTIONS
+#undef ENCODE
+
+    return true;
+}
+
+bool AnalysisCache::loadModRef(istream &is, ModRefAnalysis *mra) {
+    vector<Function *> targetFunctions;
+    ModRefAnalysis::ModSetMap modSetMap;
+    ModRefAnalysis::InstructionSet dependentLoads;
+    ModRefAnalysis::InstructionSet overridingStores;
+    ModRefAnalysis::LoadToModInfoMap loadToModInfoMap;
+    ModRefAnalysis::ModInfoToStoreMap modInfoToStoreMap;
+    ModRefAnalysis::ModInfoToIdMap modInfoToIdMap;
+    ModRefAnalysis::RetSliceIdMap retSliceIdMap;
+    ModRefAnalysis::SideEffects sideEffects;
+    ModRefAnalysis::ModPtsMap modPtsMap;
+    ModRefAnalysis::RefPtsMap refPtsMap;
+    ModRefAnalysis::ObjToStoreMap objToStoreMap;
+    ModRefAnalysis::ObjToLoadMap objToLoadMap;
+    ModRefAnalysis::ObjToOverridingStoreMap objToOverridingStoreMap;
+    unsigned count, size;
+    string token;
+
+#define DECODE_INSTRUCTIONS(insts) \
+    if (!(is >> size)) { \
+        return false; \
+    } \
+    for (unsigned j = 0; j < size; j++) { \
+        Instruction *inst; \
+        if (!decode(is, inst)) { \
+            return false; \
+        } \
+        (insts).insert(inst); \
+    }
+
+#define DECODE_MODINFO(modInfo) \
+    { \
+        Value *site; \
+        if (!decode(is, (modInfo).first) || !(is >> token) || \
+            !decodeValue(token, site) || !(is >> (modInfo).second.second)) { \
+            return false; \
+        } \
+        (modInfo).second.first = site; \
+    }
+
+    if (!expect(is, "targets") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        Function *f;
+        if (!decode(is, f)) {
+            return false;
+        }
+        targetFunctions.push_back(f);
+    }
+
+    if (!expect(is, "mod-sets") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        Function *f;
+        if (!decode(is, f)) {
+            return false;
+        }
+        DECODE_INSTRUCTIONS(modSetMap[f]);
+    }
+
+    if (!expect(is, "dependent-loads")) {
+        return false;
+    }
+    DECODE_INSTRUCTIONS(dependentLoads);
+
+    if (!expect(is, "overriding-stores")) {
+        return false;
+    }
+    DECODE_INSTRUCTIONS(overridingStores);
+
+    if (!expect(is, "load-to-modinfo") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        Instruction *load;
+        if (!decode(is, load) || !(is >> size)) {
+            return false;
+        }
+        set<ModRefAnalysis::ModInfo> &modInfos = loadToModInfoMap[load];
+        for (unsigned j = 0; j < size; j++) {
+            ModRefAnalysis::ModInfo modInfo;
+            DECODE_MODINFO(modInfo);
+            modInfos.insert(modInfo);
+        }
+    }
+
+    if (!expect(is, "modinfo-to-store") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        ModRefAnalysis::ModInfo modInfo;
+        DECODE_MODINFO(modInfo);
+        DECODE_INSTRUCTIONS(modInfoToStoreMap[modInfo]);
+    }
+
+    if (!expect(is, "modinfo-to-id") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        ModRefAnalysis::ModInfo modInfo;
+        DECODE_MODINFO(modInfo);
+        if (!(is >> modInfoToIdMap[modInfo])) {
+            return false;
+        }
+    }
+
+    if (!expect(is, "ret-slice-ids") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        Function *f;
+        if (!decode(is, f) || !(is >> retSliceIdMap[f])) {
+            return false;
+        }
+    }
+
+    if (!expect(is, "mod-pts") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        Function *f;
+        if (!decode(is, f) || !loadPointsTo(is, modPtsMap[f])) {
+            return false;
+        }
+    }
+
+    if (!expect(is, "ref-pts") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        Function *f;
+        if (!decode(is, f) || !loadPointsTo(is, refPtsMap[f])) {
+            return false;
+        }
+    }
+
+    if (!expect(is, "obj-to-store") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        Function *f;
+        NodeID id;
+        if (!decode(is, f) || !(is >> id)) {
+            return false;
+        }
+        DECODE_INSTRUCTIONS(objToStoreMap[make_pair(f, id)]);
+    }
+
+    if (!expect(is, "obj-to-load") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        Function *f;
+        NodeID id;
+        if (!decode(is, f) || !(is >> id)) {
+            return false;
+        }
+        DECODE_INSTRUCTIONS(objToLoadMap[make_pair(f, id)]);
+    }
+
+    if (!expect(is, "obj-to-overriding-store") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        NodeID id;
+        if (!(is >> id)) {
+            return false;
+        }
+        DECODE_INSTRUCTIONS(objToOverridingStoreMap[id]);
+    }
+
+    if (!expect(is, "side-effects") || !(is >> count)) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        unsigned type, id;
+        if (!(is >> type >> id)) {
+            return false;
+        }
+        if (type == ModRefAnalysis::ReturnValue) {
+            Function *f;
+            if (!decode(is, f)) {
+                return false;
+            }
+            ModRefAnalysis::SideEffect sideEffect = {
+                .type = ModRefAnalysis::ReturnValue,
+                .id = id,
+                .info = {
+                    .f = f
+                }
+            };
+            sideEffects.push_back(sideEffect);
+        } else {
+            ModRefAnalysis::ModInfo modInfo;
+            DECODE_MODINFO(modInfo);
+            ModRefAnalysis::SideEffect sideEffect = {
+                .type = ModRefAnalysis::Modifier,
+                .id = id,
+                .info = {
+                    .modInfo = modInfo
+                }
+            };
+            sideEffects.push_back(sideEffect);
+        }
+    }
+
+#undef DECODE_MODINFO
+#undef DECODE_INSTRUCTIONS
+
+    mra->entryFunction = module->getFunction(entry);
+    mra->targetFunctions = targetFunctions;
+    mra->modSetMap = modSetMap;
+    mra->dependentLoads = dependentLoads;
+    mra->overridingStores = overridingStores;
+    mra->loadToModInfoMap = loadToModInfoMap;
+    mra->modInfoToStoreMap = modInfoToStoreMap;
+    mra->modInfoToIdMap = modInfoToIdMap;
+    mra->retSliceIdMap = retSliceIdMap;
+    mra->sideEffects = sideEffects;
+    mra->modPtsMap = modPtsMap;
+    mra->refPtsMap = refPtsMap;
+    mra->objToStoreMap = objToStoreMap;
+    mra->objToLoadMap = objToLoadMap;
+    mra->objToOverridingStoreMap = objToOverridingStoreMap;
+    return true;
+}
@@ -58,10 +58,13 @@ void Cloner::cloneFunction(Function *f, uint32_t sliceId) {
         .isSliced = false,
         .v2vmap = v2vmap
     };
+    ValueTranslationMap *reversedMap = buildReversedMap(v2vmap);
+
+    std::lock_guard<std::mutex> guard(mapsLock);
     functionMap[f][sliceId] = sliceInfo;
 
     /* update map */
-    cloneInfoMap[cloned] = buildReversedMap(v2vmap);
+    cloneInfoMap[cloned] = reversedMap;
 }
 
 Cloner::ValueTranslationMap *Cloner::buildReversedMap(ValueToValueMapTy *v2vmap) {
@@ -84,6 +87,7 @@ Cloner::ValueTranslationMap *Cloner::buildReversedMap(ValueToValueMapTy *v2vmap)
 }
 
 Cloner::SliceMap *Cloner::getSlices(llvm::Function *function) {
+    std::lock_guard<std::mutex> guard(mapsLock);
     FunctionMap::iterator i = functionMap.find(function);
     if (i == functionMap.end()) {
         return 0;
@@ -99,6 +103,7 @@ Cloner::SliceInfo *Cloner::getSliceInfo(llvm::Function *function, uint32_t slice
         return 0;
     }
 
+    std::lock_guard<std::mutex> guard(mapsLock);
     SliceMap::iterator i = sliceMap->find(sliceId);
     if (i == sliceMap->end()) {
         return 0;
@@ -117,6 +122,7 @@ Value *Cloner::translateValue(Value *value) {
     }
 
     Function *f = inst->getParent()->getParent();
+    std::lock_guard<std::mutex> guard(mapsLock);
     CloneInfoMap::iterator entry = cloneInfoMap.find(f);
     if (entry == cloneInfoMap.end()) {
         /* the value is not contained in a cloned function */
@@ -9,6 +9,7 @@
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "../Core/SpecialFunctionHandler.h"
 #include <vector>
+#include <algorithm>
 
 using klee::Interpreter;
 using llvm::Function;
@@ -324,7 +325,7 @@ bool Keeper::updateWhiteList(llvm::Function* f) {
   llvm::StringRef fname = f->getName();
 
   // if it is already in the whitelist
-  if(std::find(dynamicWhitelist.begin(), dynamicWhitelist.end(), fname.str()) != dynamicWhitelist.end()) {
+  if(isDynamicallyKept(f)) {
     // chopstats[f].adviseWhitelisting(); // TODO: remove, this is just a hack for debugging printing
     return true;
   }
@@ -340,6 +341,17 @@ bool Keeper::updateWhiteList(llvm::Function* f) {
   return false;
 }
 
+bool Keeper::keepFunction(llvm::Function* f) {
+  if(isDynamicallyKept(f))
+    return false;
+  dynamicWhitelist.push_back(f->getName().str());
+  return true;
+}
+
+bool Keeper::isDynamicallyKept(llvm::Function* f) const {
+  return std::find(dynamicWhitelist.begin(), dynamicWhitelist.end(), f->getName().str()) != dynamicWhitelist.end();
+}
+
 bool Keeper::ChopperStats::adviseWhitelisting() const {
   assert(this->numSkips > 0 && "numskips should always be null at this point");
   if(this->numRecoveries >= 5 && this->numRecoveries / this->numSkips > 3) {
@@ -350,9 +362,10 @@ bool Keeper::ChopperStats::adviseWhitelisting() const {
   return false;
 }
 
-void Keeper::skippingRiskyFunction(llvm::Function* f) {
+void Keeper::skippingRiskyFunction(llvm::Function* f, uint64_t snapshotUsage) {
   ChopperStats& cs = getOrInsertChopstats(f);
   cs.numSkips++;
+  cs.snapshotUsage += snapshotUsage;
 }
 
 bool Keeper::shouldRestartUponRecovery(llvm::Function* f, int CumulativeRecoveryTimeThresold) {
@@ -379,8 +392,10 @@ void Keeper::recoveringFunction(klee::ref<klee::RecoveryInfo> ri) {
   updateWhiteList(ri->f); // TODO: JOR: should we do that here?
 }
 
-void Keeper::recoveredFunction(klee::ref<klee::RecoveryInfo> ri) {
+void Keeper::recoveredFunction(klee::ref<klee::RecoveryInfo> ri, uint64_t instructions, unsigned forks) {
   ChopperStats& cs = chopstats[ri->f]; // should always exist
+  cs.recoveryInstructions += instructions;
+  cs.recoveryForks += forks;
   // assert(cs.recoveryTimer && cs.recoveryStackCount);
   if(!(cs.recoveryTimer && cs.recoveryStackCount)) {
     klee::klee_warning("\e[0;31mrecoveredFunction called twice for a recoveryState!\e[0m");
@@ -395,6 +410,72 @@ void Keeper::recoveredFunction(klee::ref<klee::RecoveryInfo> ri) {
   cs.numRecoveries++; // moved here to have the timer keep track of something
 }
 
+// one python tuple per line, as in run.stats
+void Keeper::writeStats(llvm::raw_ostream& os) const {
+  os << "('Function','Skips','Recoveries','RecoveryTime','RecoveryInstructions','RecoveryForks','SnapshotMemory')\n";
+  for(auto ci = chopstats.begin(); ci != chopstats.end(); ci++) {
+    const ChopperStats& cs = ci->second;
+    os << "('" << ci->first->getName() << "',"
+       << cs.numSkips << ","
+       << cs.numRecoveries << ","
+       << cs.totalRecoveryTime / 1000000. << ","
+       << cs.recoveryInstructions << ","
+       << cs.recoveryForks << ","
+       << cs.snapshotUsage << ")\n";
+  }
+}
+
+unsigned Keeper::getFunctionSize(llvm::Function* f) {
+  auto i = functionSizes.find(f);
+  if(i != functionSizes.end())
+    return i->second;
+  unsigned size = 0;
+  for(auto bb = f->begin(); bb != f->end(); bb++)
+    size += bb->size();
+  functionSizes[f] = size;
+  return size;
+}
+
+// the cost of skipping f (per call) is the recovery time spent per skip,
+// the cost of keeping f (per call) is the estimated time of executing it
+// directly: the instructions of a recovery (scaled from the executed slice to
+// the whole function), at the rate of the normal (non-recovery) execution so
+// far, and multiplied by the forks taken in the recovery (which would be
+// taken by the normal state as well).
+// The side effects of f (see ModRefAnalysis) are not weighted separately,
+// the recoveries they cause are already part of the measured recovery time.
+// The model only compares times, it does not estimate the coverage gained
+// per second (the coverage of a skipped call is not attributed to f).
+void Keeper::selectFunctionsToKeep(std::vector<llvm::Function*>& result, int minRecoveries, double elapsedTime, uint64_t instructions) {
+  double totalRecoveryTime = 0, totalRecoveryInstructions = 0;
+  for(auto ci = chopstats.begin(); ci != chopstats.end(); ci++) {
+    totalRecoveryTime += ci->second.totalRecoveryTime;
+    totalRecoveryInstructions += ci->second.recoveryInstructions;
+  }
+  double normalInstructions = (double)instructions - totalRecoveryInstructions;
+  if(normalInstructions < 1.)
+    return;
+  double instructionTime = std::max(0., elapsedTime - totalRecoveryTime) / normalInstructions;
+
+  for(auto ci = chopstats.begin(); ci != chopstats.end(); ci++) {
+    llvm::Function* f = ci->first;
+    const ChopperStats& cs = ci->second;
+    if(cs.numSkips == 0 || cs.numRecoveries < minRecoveries || isDynamicallyKept(f))
+      continue;
+
+    double recoveryInstructions = std::max(1., (double)cs.recoveryInstructions / cs.numRecoveries);
+    double sizeRatio = std::max(1., getFunctionSize(f) / recoveryInstructions);
+    double forkFactor = 1. + (double)cs.recoveryForks / cs.numRecoveries;
+
+    double skipCost = (double)cs.totalRecoveryTime / cs.numSkips;
+    double keepCost = recoveryInstructions * sizeRatio * instructionTime * forkFactor;
+    DEBUG_WITH_TYPE("chop", klee::klee_message("cost model '%s': skip = %.6f, keep = %.6f",
+      f->getName().str().c_str(), skipCost/1000000.f, keepCost/1000000.f));
+    if(skipCost > keepCost)
+      result.push_back(f);
+  }
+}
+
 /******************************************************************/ 
 /******************* reverse reachability stuff *******************/ 
 /******************************************************************/ 
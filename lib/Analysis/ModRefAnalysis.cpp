@@ -3,6 +3,7 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <algorithm>
 
 #include <llvm/IR/Module.h>
 #include <llvm/IR/DataLayout.h>
@@ -35,7 +36,8 @@ ModRefAnalysis::ModRefAnalysis(
     vector<string> targets,
     llvm::raw_ostream &debugs
 ) :
-    module(module), ra(ra), aa(aa), entry(entry), targets(targets), debugs(debugs)
+    module(module), ra(ra), aa(aa), entry(entry), targets(targets),
+    nextSliceId(0), debugs(debugs)
 {
 
 }
@@ -391,109 +393,229 @@ void ModRefAnalysis::addOverridingStore(Instruction *store) {
 void ModRefAnalysis::computeModRefInfo() {
     for (ModPtsMap::iterator i = modPtsMap.begin(); i != modPtsMap.end(); i++) {
         Function *f = i->first;
-        PointsTo &modPts = i->second;
+        computeModRefInfo(f);
+    }
+}
 
-        /* get the corresponding ref-set */
-        PointsTo &refPts = refPtsMap[f];
+void ModRefAnalysis::computeModRefInfo(Function *f) {
+    ModPtsMap::iterator entry = modPtsMap.find(f);
+    if (entry == modPtsMap.end()) {
+        return;
+    }
 
-        debugs << "function = " << f->getName().str() << "\n";
-        for (PointsTo::iterator ni = modPts.begin(); ni != modPts.end(); ++ni) {
-            debugs << "\t-modPts: " << *ni;
-        } debugs << "\n";
-        for (PointsTo::iterator ni = refPts.begin(); ni != refPts.end(); ++ni) {
-            debugs << "\t-refPts: " << *ni;
-        } debugs << "\n";
+    PointsTo &modPts = entry->second;
 
-        /* compute the intersection */
-        PointsTo pts = modPts & refPts;
-        /* get the corresponding modifies-set */
-        InstructionSet &modSet = modSetMap[f];
+    /* get the corresponding ref-set */
+    PointsTo &refPts = refPtsMap[f];
 
-        for (PointsTo::iterator ni = pts.begin(); ni != pts.end(); ++ni) {
-            NodeID nodeId = *ni;
+    debugs << "function = " << f->getName().str() << "\n";
+    for (PointsTo::iterator ni = modPts.begin(); ni != modPts.end(); ++ni) {
+        debugs << "\t-modPts: " << *ni;
+    } debugs << "\n";
+    for (PointsTo::iterator ni = refPts.begin(); ni != refPts.end(); ++ni) {
+        debugs << "\t-refPts: " << *ni;
+    } debugs << "\n";
+
+    /* compute the intersection */
+    PointsTo pts = modPts & refPts;
+    /* get the corresponding modifies-set */
+    InstructionSet &modSet = modSetMap[f];
 
-            /* set key */
-            pair<Function *, NodeID> k = make_pair(f, nodeId);
+    for (PointsTo::iterator ni = pts.begin(); ni != pts.end(); ++ni) {
+        NodeID nodeId = *ni;
 
-            /* update modifies-set */
-            InstructionSet &stores = objToStoreMap[k];
-            modSet.insert(stores.begin(), stores.end());
-            debugs << "modSet of " << f->getName().str() << ", " << nodeId << " =\n";
-            for(InstructionSet::iterator stori = stores.begin(); stori != stores.end(); stori++) {
-                debugs << "\t-" << **stori << "\n";
-            }
+        /* set key */
+        pair<Function *, NodeID> k = make_pair(f, nodeId);
 
-            /* get allocation site */
-            AllocSite allocSite = getAllocSite(nodeId);
+        /* update modifies-set */
+        InstructionSet &stores = objToStoreMap[k];
+        modSet.insert(stores.begin(), stores.end());
+        debugs << "modSet of " << f->getName().str() << ", " << nodeId << " =\n";
+        for(InstructionSet::iterator stori = stores.begin(); stori != stores.end(); stori++) {
+            debugs << "\t-" << **stori << "\n";
+        }
 
-            InstructionSet &loads = objToLoadMap[k];
-            for (InstructionSet::iterator i = loads.begin(); i != loads.end(); i++) {
-                Instruction *load = *i;
+        /* get allocation site */
+        AllocSite allocSite = getAllocSite(nodeId);
 
-                /* update with store instructions */
-                dependentLoads.insert(load);
+        InstructionSet &loads = objToLoadMap[k];
+        for (InstructionSet::iterator i = loads.begin(); i != loads.end(); i++) {
+            Instruction *load = *i;
 
-                /* update with allocation site */
-                ModInfo modInfo = make_pair(f, allocSite);
-                loadToModInfoMap[load].insert(modInfo);
-            }
+            /* update with store instructions */
+            dependentLoads.insert(load);
 
-            /* update overriding stores */
-            InstructionSet &localOverridingStores = objToOverridingStoreMap[nodeId];
-            overridingStores.insert(localOverridingStores.begin(), localOverridingStores.end());
+            /* update with allocation site */
+            ModInfo modInfo = make_pair(f, allocSite);
+            loadToModInfoMap[load].insert(modInfo);
         }
+
+        /* update overriding stores */
+        InstructionSet &localOverridingStores = objToOverridingStoreMap[nodeId];
+        overridingStores.insert(localOverridingStores.begin(), localOverridingStores.end());
     }
 }
 
 void ModRefAnalysis::computeModInfoToStoreMap() {
-    uint32_t sliceId = 1;
+    for (vector<Function *>::iterator i = targetFunctions.begin(); i != targetFunctions.end(); i++) {
+        Function *f = *i;
+        computeModInfoToStoreMap(f);
+    }
+}
+
+void ModRefAnalysis::computeModInfoToStoreMap(Function *f) {
+    InstructionSet &modSet = modSetMap[f];
+
+    uint32_t retSliceId = allocateSliceId();
+    if (hasReturnValue(f)) {
+        retSliceIdMap[f] = retSliceId;
+        SideEffect sideEffect = {
+            .type = ReturnValue,
+            .id = retSliceId,
+            .info = {
+                .f = f
+            }
+        };
+        sideEffects.push_back(sideEffect);
+    }
+
+    for (InstructionSet::iterator i = modSet.begin(); i != modSet.end(); i++) {
+        Instruction *store = *i;
+        AliasAnalysis::Location storeLocation = getStoreLocation(dyn_cast<StoreInst>(store));
+        NodeID id = aa->getPTA()->getPAG()->getValueNode(storeLocation.Ptr);
+        PointsTo &pts = aa->getPTA()->getPts(id);
+
+        for (PointsTo::iterator ni = pts.begin(); ni != pts.end(); ++ni) {
+            NodeID nodeId = *ni;
+
+            /* update store instructions */
+            AllocSite allocSite = getAllocSite(nodeId);
+            ModInfo modInfo = make_pair(f, allocSite);
+            modInfoToStoreMap[modInfo].insert(store);
+
+            if (modInfoToIdMap.find(modInfo) == modInfoToIdMap.end()) {
+                uint32_t modSliceId = allocateSliceId();
+                modInfoToIdMap[modInfo] = modSliceId;
+                SideEffect sideEffect = {
+                    .type = Modifier,
+                    .id = modSliceId,
+                    .info = {
+                        .modInfo = modInfo
+                    }
+                };
+                sideEffects.push_back(sideEffect);
+            }
+        }
+    }
+}
+
+uint32_t ModRefAnalysis::allocateSliceId() {
+    if (nextSliceId == 0) {
+        /* the side effects might be loaded from the analysis cache */
+        nextSliceId = 1;
+        for (SideEffects::iterator i = sideEffects.begin(); i != sideEffects.end(); i++) {
+            if (i->id >= nextSliceId) {
+                nextSliceId = i->id + 1;
+            }
+        }
+    }
+
+    return nextSliceId++;
+}
+
+/* the stores which may override the objects modified by some target */
+void ModRefAnalysis::recomputeOverridingStores(InstructionSet &affected) {
+    InstructionSet previous;
+    previous.swap(overridingStores);
 
     for (vector<Function *>::iterator i = targetFunctions.begin(); i != targetFunctions.end(); i++) {
         Function *f = *i;
-        InstructionSet &modSet = modSetMap[f];
-
-        uint32_t retSliceId = sliceId++;
-        if (hasReturnValue(f)) {
-            retSliceIdMap[f] = retSliceId;
-            SideEffect sideEffect = {
-                .type = ReturnValue,
-                .id = retSliceId,
-                .info = {
-                    .f = f
-                }
-            };
-            sideEffects.push_back(sideEffect);
+        PointsTo pts = modPtsMap[f] & refPtsMap[f];
+        for (PointsTo::iterator ni = pts.begin(); ni != pts.end(); ++ni) {
+            InstructionSet &localOverridingStores = objToOverridingStoreMap[*ni];
+            overridingStores.insert(localOverridingStores.begin(), localOverridingStores.end());
         }
+    }
 
-        for (InstructionSet::iterator i = modSet.begin(); i != modSet.end(); i++) {
-            Instruction *store = *i;
-            AliasAnalysis::Location storeLocation = getStoreLocation(dyn_cast<StoreInst>(store));
-            NodeID id = aa->getPTA()->getPAG()->getValueNode(storeLocation.Ptr);
-            PointsTo &pts = aa->getPTA()->getPts(id);
-
-            for (PointsTo::iterator ni = pts.begin(); ni != pts.end(); ++ni) {
-                NodeID nodeId = *ni;
-
-                /* update store instructions */
-                AllocSite allocSite = getAllocSite(nodeId);
-                ModInfo modInfo = make_pair(f, allocSite);
-                modInfoToStoreMap[modInfo].insert(store);
-
-                if (modInfoToIdMap.find(modInfo) == modInfoToIdMap.end()) {
-                    uint32_t modSliceId = sliceId++;
-                    modInfoToIdMap[modInfo] = modSliceId;
-                    SideEffect sideEffect = {
-                        .type = Modifier,
-                        .id = modSliceId,
-                        .info = {
-                            .modInfo = modInfo
-                        }
-                    };
-                    sideEffects.push_back(sideEffect);
-                }
+    for (InstructionSet::iterator i = previous.begin(); i != previous.end(); i++) {
+        if (overridingStores.find(*i) == overridingStores.end()) {
+            affected.insert(*i);
+        }
+    }
+    for (InstructionSet::iterator i = overridingStores.begin(); i != overridingStores.end(); i++) {
+        if (previous.find(*i) == previous.end()) {
+            affected.insert(*i);
+        }
+    }
+}
+
+void ModRefAnalysis::removeTarget(Function *f, InstructionSet &affected) {
+    vector<Function *>::iterator t = find(targetFunctions.begin(), targetFunctions.end(), f);
+    if (t == targetFunctions.end()) {
+        return;
+    }
+
+    targetFunctions.erase(t);
+
+    /* the loads which may depend only on f do not block any more */
+    for (LoadToModInfoMap::iterator i = loadToModInfoMap.begin(); i != loadToModInfoMap.end(); ) {
+        Instruction *load = i->first;
+        set<ModInfo> &modInfos = i->second;
+        for (set<ModInfo>::iterator j = modInfos.begin(); j != modInfos.end(); ) {
+            if (j->first == f) {
+                modInfos.erase(j++);
+                affected.insert(load);
+            } else {
+                j++;
             }
         }
+
+        if (modInfos.empty()) {
+            dependentLoads.erase(load);
+            loadToModInfoMap.erase(i++);
+        } else {
+            i++;
+        }
     }
+
+    /* the slice ids of the other targets are kept */
+    for (SideEffects::iterator i = sideEffects.begin(); i != sideEffects.end(); ) {
+        if (i->getFunction() == f) {
+            i = sideEffects.erase(i);
+        } else {
+            i++;
+        }
+    }
+
+    ModInfo first = make_pair(f, AllocSite(NULL, 0));
+    for (ModInfoToStoreMap::iterator i = modInfoToStoreMap.lower_bound(first);
+         i != modInfoToStoreMap.end() && i->first.first == f; ) {
+        modInfoToStoreMap.erase(i++);
+    }
+    for (ModInfoToIdMap::iterator i = modInfoToIdMap.lower_bound(first);
+         i != modInfoToIdMap.end() && i->first.first == f; ) {
+        modInfoToIdMap.erase(i++);
+    }
+
+    pair<Function *, NodeID> firstObj = make_pair(f, 0);
+    for (ObjToStoreMap::iterator i = objToStoreMap.lower_bound(firstObj);
+         i != objToStoreMap.end() && i->first.first == f; ) {
+        objToStoreMap.erase(i++);
+    }
+    for (ObjToLoadMap::iterator i = objToLoadMap.lower_bound(firstObj);
+         i != objToLoadMap.end() && i->first.first == f; ) {
+        objToLoadMap.erase(i++);
+    }
+
+    modPtsMap.erase(f);
+    refPtsMap.erase(f);
+    modSetMap.erase(f);
+    retSliceIdMap.erase(f);
+
+    /* the stores which are reachable from the call sites of f are kept in
+       objToOverridingStoreMap, which over-approximates the overriding stores
+       of the other targets (this is safe) */
+    recomputeOverridingStores(affected);
 }
 
 ModRefAnalysis::AllocSite ModRefAnalysis::getAllocSite(NodeID nodeId) {
@@ -554,6 +676,20 @@ void ModRefAnalysis::getApproximateModInfos(Instruction *inst, AllocSite hint, s
     return;
 }
 
+void ModRefAnalysis::getDependentFunctions(Function *f, set<Function *> &result) {
+    for (LoadToModInfoMap::iterator i = loadToModInfoMap.begin(); i != loadToModInfoMap.end(); i++) {
+        Instruction *load = i->first;
+        set<ModInfo> &modifiers = i->second;
+
+        for (set<ModInfo>::iterator j = modifiers.begin(); j != modifiers.end(); j++) {
+            if (j->first == f) {
+                result.insert(load->getParent()->getParent());
+                break;
+            }
+        }
+    }
+}
+
 void ModRefAnalysis::dumpModSetMap() {
     debugs << "### ModSetMap ###\n";
 
@@ -37,14 +37,29 @@ void SliceGenerator::generate() {
     SVFPointerAnalysis svfpa(module, llvmpta, aa);
     svfpa.run();
 
+    /* the reaching definitions of a function are kept until all of its
+       slices are generated */
+    ModRefAnalysis::SideEffects &sideEffects = mra->getSideEffects();
+    for (ModRefAnalysis::SideEffects::iterator i = sideEffects.begin(); i != sideEffects.end(); i++) {
+        pendingSlices[i->getFunction()]++;
+    }
+
     if (lazyMode) {
         return;
     }
 
     /* generate all the slices... */
-    ModRefAnalysis::SideEffects &sideEffects = mra->getSideEffects();
     for (ModRefAnalysis::SideEffects::iterator i = sideEffects.begin(); i != sideEffects.end(); i++) {
-        generateSlice(i->getFunction(), i->id, i->type);
+        if (backgroundMode) {
+            SliceRequest request = {
+                .f = i->getFunction(),
+                .sliceId = i->id,
+                .type = i->type
+            };
+            schedule(request, SLICE_AHEAD);
+        } else {
+            generateSlice(i->getFunction(), i->id, i->type);
+        }
     }
 }
 
@@ -58,29 +73,95 @@ void SliceGenerator::generateSlice(Function *f, uint32_t sliceId, ModRefAnalysis
         criterions.push_back("ret");
         break;
 
-    case ModRefAnalysis::Modifier:
-        fnames = annotator->getAnnotatedNames(sliceId);
+    case ModRefAnalysis::Modifier: {
+        std::set<uint32_t> components;
+        if (!getUnionComponents(sliceId, components)) {
+            components.insert(sliceId);
+        }
+        for (std::set<uint32_t>::iterator i = components.begin(); i != components.end(); i++) {
+            std::set<std::string> &names = annotator->getAnnotatedNames(*i);
+            fnames.insert(names.begin(), names.end());
+        }
         for (std::set<std::string>::iterator i = fnames.begin(); i != fnames.end(); i++) {
             std::string fname = *i;
             criterions.push_back(fname);
         }
         break;
+    }
 
     default:
         assert(false);
         break;
     }
 
-    /* create the clone (inclusive) */
-    cloner->clone(f, sliceId);
+    {
+        /* the dependence graph is built and marked over the original
+           functions, which are not modified, so the background worker does
+           it without the module lock */
+        string entryName = f->getName().data();
+        Slicer slicer(module, 0, entryName, criterions, llvmpta, cloner,
+                      getReachingDefinitions(f));
+        slicer.setSliceId(sliceId);
+        bool analyzed = slicer.analyze();
+
+        /* cloning and slicing create and erase instructions, which updates
+           the use lists of the shared constants and globals */
+        std::unique_lock<std::mutex> guard(moduleLock, std::defer_lock);
+        if (backgroundMode) {
+            guard.lock();
+        }
+
+        /* create the clone (inclusive) */
+        cloner->clone(f, sliceId);
+
+        /* remove the unmarked instructions from the clone (which is kept
+           whole if the dependence graph could not be built) */
+        if (analyzed) {
+            slicer.project();
+        }
+
+        markAsSliced(f, sliceId);
+    }
+
+    /* union slices are not counted, so their reaching definitions are
+       released once they are used (unless other slices still need them) */
+    std::map<Function *, unsigned>::iterator i = pendingSlices.find(f);
+    if (i != pendingSlices.end() && i->second > 0 && !isUnionSlice(sliceId)) {
+        i->second--;
+    }
+    if (i == pendingSlices.end() || i->second == 0) {
+        releaseReachingDefinitions(f);
+    }
+}
+
+/* dg's slicer removes the nodes of the other slices from the dependence
+   graph (and erases their instructions), so the graph can't be shared and
+   is built for each slice. The reaching definitions are computed over the
+   original functions, so they are shared by all the slices of a function */
+dg::analysis::rd::LLVMReachingDefinitions *
+SliceGenerator::getReachingDefinitions(Function *f) {
+    if (!reuseReachingDefinitions) {
+        return 0;
+    }
+
+    std::map<Function *, dg::analysis::rd::LLVMReachingDefinitions *>::iterator i = rds.find(f);
+    if (i != rds.end()) {
+        return i->second;
+    }
 
-    /* generate slice */
     string entryName = f->getName().data();
-    Slicer slicer(module, 0, entryName, criterions, llvmpta, cloner);
-    slicer.setSliceId(sliceId);
-    slicer.run();
+    dg::analysis::rd::LLVMReachingDefinitions *rd = Slicer::createReachingDefinitions(module, llvmpta, entryName);
+    rd->run();
+    rds[f] = rd;
+    return rd;
+}
 
-    markAsSliced(f, sliceId);
+void SliceGenerator::releaseReachingDefinitions(Function *f) {
+    std::map<Function *, dg::analysis::rd::LLVMReachingDefinitions *>::iterator i = rds.find(f);
+    if (i != rds.end()) {
+        delete i->second;
+        rds.erase(i);
+    }
 }
 
 void SliceGenerator::markAsSliced(Function *sliceEntry, uint32_t sliceId) {
@@ -126,7 +207,178 @@ void SliceGenerator::dumpSlice(Function *f, uint32_t sliceId, bool recursively)
     }
 }
 
+uint32_t SliceGenerator::getUnionSliceId(const std::set<uint32_t> &sliceIds) {
+    assert(!sliceIds.empty());
+    if (sliceIds.size() == 1) {
+        return *sliceIds.begin();
+    }
+
+    std::lock_guard<std::mutex> guard(unionLock);
+    std::map<std::set<uint32_t>, uint32_t>::iterator i = unionIds.find(sliceIds);
+    if (i != unionIds.end()) {
+        return i->second;
+    }
+
+    /* union slices get ids which are not used by the analysis */
+    uint32_t id = mra->allocateSliceId();
+    unionIds[sliceIds] = id;
+    unionComponents[id] = sliceIds;
+    return id;
+}
+
+bool SliceGenerator::isUnionSlice(uint32_t sliceId) {
+    std::lock_guard<std::mutex> guard(unionLock);
+    return unionComponents.find(sliceId) != unionComponents.end();
+}
+
+bool SliceGenerator::getUnionComponents(uint32_t sliceId, std::set<uint32_t> &result) {
+    std::lock_guard<std::mutex> guard(unionLock);
+    std::map<uint32_t, std::set<uint32_t> >::iterator i = unionComponents.find(sliceId);
+    if (i == unionComponents.end()) {
+        return false;
+    }
+
+    result = i->second;
+    return true;
+}
+
+/* DG keeps global state and all the slices share the DG points-to graph,
+   so the slices are generated by a single worker */
+void SliceGenerator::startWorker() {
+    assert(backgroundMode && !worker);
+    {
+        /* the worker may be restarted (e.g., around a fork) */
+        std::lock_guard<std::mutex> guard(queueLock);
+        stopping = false;
+    }
+    worker = new std::thread(&SliceGenerator::runWorker, this);
+}
+
+void SliceGenerator::stopWorker() {
+    if (!worker) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        stopping = true;
+    }
+    queueCond.notify_all();
+
+    worker->join();
+    delete worker;
+    worker = 0;
+}
+
+void SliceGenerator::scheduleSlices(Function *f, SlicePriority priority) {
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        if (!scheduledFunctions.insert(f).second) {
+            return;
+        }
+    }
+
+    ModRefAnalysis::SideEffects &sideEffects = mra->getSideEffects();
+    for (ModRefAnalysis::SideEffects::iterator i = sideEffects.begin(); i != sideEffects.end(); i++) {
+        if (i->getFunction() != f) {
+            continue;
+        }
+
+        SliceRequest request = {
+            .f = f,
+            .sliceId = i->id,
+            .type = i->type
+        };
+        schedule(request, priority);
+    }
+}
+
+void SliceGenerator::schedule(SliceRequest &request, SlicePriority priority) {
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        if (generatedSlices.find(std::make_pair(request.f, request.sliceId)) != generatedSlices.end()) {
+            return;
+        }
+
+        /* a request may be queued more than once (with different priorities),
+           the worker ignores the stale ones */
+        if (priority == SLICE_NEEDED) {
+            queues[priority].push_front(request);
+        } else {
+            queues[priority].push_back(request);
+        }
+    }
+    queueCond.notify_one();
+}
+
+void SliceGenerator::waitForSlice(Function *f, uint32_t sliceId, ModRefAnalysis::SideEffectType type) {
+    SliceKey key = std::make_pair(f, sliceId);
+    SliceRequest request = {
+        .f = f,
+        .sliceId = sliceId,
+        .type = type
+    };
+    schedule(request, SLICE_NEEDED);
+
+    std::unique_lock<std::mutex> guard(queueLock);
+    while (generatedSlices.find(key) == generatedSlices.end()) {
+        generatedCond.wait(guard);
+    }
+}
+
+void SliceGenerator::runWorker() {
+    while (true) {
+        SliceRequest request;
+        {
+            std::unique_lock<std::mutex> guard(queueLock);
+            bool found = false;
+            while (!found) {
+                if (stopping) {
+                    return;
+                }
+
+                for (unsigned i = 0; i < SLICE_PRIORITIES && !found; i++) {
+                    while (!queues[i].empty()) {
+                        request = queues[i].front();
+                        queues[i].pop_front();
+                        if (generatedSlices.find(std::make_pair(request.f, request.sliceId)) == generatedSlices.end()) {
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+
+                if (!found) {
+                    queueCond.wait(guard);
+                }
+            }
+        }
+
+        bool isSliced;
+        {
+            std::lock_guard<std::mutex> guard(moduleLock);
+            Cloner::SliceInfo *sliceInfo = cloner->getSliceInfo(request.f, request.sliceId);
+            isSliced = sliceInfo && sliceInfo->isSliced;
+        }
+
+        /* generateSlice takes the module lock only for the clone */
+        if (!isSliced) {
+            generateSlice(request.f, request.sliceId, request.type);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(queueLock);
+            generatedSlices.insert(std::make_pair(request.f, request.sliceId));
+        }
+        generatedCond.notify_all();
+    }
+}
+
 SliceGenerator::~SliceGenerator() {
+    stopWorker();
+    for (std::map<Function *, dg::analysis::rd::LLVMReachingDefinitions *>::iterator i = rds.begin(); i != rds.end(); i++) {
+        delete i->second;
+    }
     delete llvmpta;
     delete annotator;
 }
@@ -111,8 +111,8 @@ enum PtaType {
 llvm::cl::OptionCategory SlicingOpts("Slicer options", "");
 
 llvm::cl::opt<std::string> output("o",
-    llvm::cl::desc("Save the output to given file. If not specified,\n"
-                   "a .sliced suffix is used with the original module name."),
+    llvm::cl::desc("Save the sliced module to given file.\n"
+                   "If not specified, the sliced module is not saved."),
     llvm::cl::value_desc("filename"), llvm::cl::init(""), llvm::cl::cat(SlicingOpts));
 
 //llvm::cl::opt<std::string> llvmfile(llvm::cl::Positional, llvm::cl::Required,
@@ -268,34 +268,54 @@ Slicer::Slicer(
     std::string entryFunction,
     std::vector<std::string> criterions,
     LLVMPointerAnalysis *llvmpta,
-    Cloner *cloner
+    Cloner *cloner,
+    LLVMReachingDefinitions *rd
 ) :
     M(mod), 
     opts(o),
     entryFunction(entryFunction),
     criterions(criterions),
     PTA(llvmpta),
-    RD(
-        new LLVMReachingDefinitions(
-            mod,
-            PTA,
-            rd_strong_update_unknown,
-            undefined_are_pure,
-            ~((uint32_t)(0)),
-            entryFunction
-        )
-    )
+    RD(rd)
 {
     assert(mod && "Need module");
+    // not shared, so computed by this slicer
+    if (!RD) {
+        ownRD.reset(createReachingDefinitions(mod, PTA, entryFunction));
+        RD = ownRD.get();
+    }
     slicer.setCloner(cloner);
     slice_id = 0xdead;
 }
 
+LLVMReachingDefinitions *Slicer::createReachingDefinitions(
+    llvm::Module *mod,
+    LLVMPointerAnalysis *llvmpta,
+    std::string entryFunction
+) {
+    return new LLVMReachingDefinitions(
+        mod,
+        llvmpta,
+        rd_strong_update_unknown,
+        undefined_are_pure,
+        ~((uint32_t)(0)),
+        entryFunction
+    );
+}
+
 int Slicer::run()
+{
+    if (!analyze())
+        return 1;
+
+    return project();
+}
+
+bool Slicer::analyze()
 {
     if (!M) {
         llvm::errs() << "Failed parsing '" << llvmfile << "' file:\n";
-        return 1;
+        return false;
     }
 
     // remove unused from module, we don't need that
@@ -304,12 +324,16 @@ int Slicer::run()
     // build the dependence graph, so that we can dump it if desired
     if (!buildDG()) {
         errs() << "ERROR: Failed building DG\n";
-        return 1;
+        return false;
     }
 
     // mark nodes that are going to be in the slice
     mark();
+    return true;
+}
 
+int Slicer::project()
+{
     // slice the graph
     if (!slice()) {
         errs() << "ERROR: Slicing failed\n";
@@ -323,6 +347,10 @@ int Slicer::run()
     // fix linkage of declared functions (if needs to be fixed)
     make_declarations_external();
 
+    // the sliced module is saved only on demand
+    if (output.empty())
+        return 0;
+
     return save_module(M, false);
 }
 
@@ -442,16 +470,19 @@ void Slicer::computeEdges()
     assert(PTA && "BUG: No PTA");
     assert(RD && "BUG: No RD");
 
-    tm.start();
-    RD->run();
-    tm.stop();
+    // shared reaching definitions are already computed
+    if (ownRD) {
+        tm.start();
+        RD->run();
+        tm.stop();
 #ifndef MAKE_CHECK
-    DEBUG_CHOPPER(DEBUG_RECOVERY_TIMERS, tm.report("INFO: Reaching defs analysis took"));
+        DEBUG_CHOPPER(DEBUG_RECOVERY_TIMERS, tm.report("INFO: Reaching defs analysis took"));
 #else
-    tm.report("INFO: Reaching defs analysis took");
+        tm.report("INFO: Reaching defs analysis took");
 #endif
+    }
 
-    LLVMDefUseAnalysis DUA(&dg, RD.get(), PTA, undefined_are_pure);
+    LLVMDefUseAnalysis DUA(&dg, RD, PTA, undefined_are_pure);
     tm.start();
     DUA.run(); // add def-use edges according that
     tm.stop();
@@ -478,11 +509,6 @@ bool Slicer::slice()
     if (!got_slicing_criterion)
         return true;
 
-    if (slice_id == 0) {
-        if (!mark())
-            return false;
-    }
-
     debug::TimeMeasure tm;
 
     tm.start();
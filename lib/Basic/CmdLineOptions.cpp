@@ -59,6 +59,12 @@ UseForkedCoreSolver("use-forked-solver",
              llvm::cl::desc("Run the core SMT solver in a forked process (default=on)"),
              llvm::cl::init(true));
 
+llvm::cl::opt<unsigned>
+SolverConstructCacheSize("solver-construct-cache-size",
+                         llvm::cl::desc("Keep up to this many constructed solver expressions between queries, "
+                                        "0 constructs every query from scratch (default=65536)"),
+                         llvm::cl::init(65536));
+
 llvm::cl::opt<bool>
 CoreSolverOptimizeDivides("solver-optimize-divides", 
                  llvm::cl::desc("Optimize constant divides into add/shift/multiplies before passing to core SMT solver (default=off)"),
@@ -20,7 +20,8 @@ Solver *constructSolverChain(Solver *coreSolver,
                              std::string querySMT2LogPath,
                              std::string baseSolverQuerySMT2LogPath,
                              std::string queryKQueryLogPath,
-                             std::string baseSolverQueryKQueryLogPath) {
+                             std::string baseSolverQueryKQueryLogPath,
+                             ArrayCache *arrayCache) {
   Solver *solver = coreSolver;
 
   if (optionIsSet(queryLoggingOptions, SOLVER_KQUERY)) {
@@ -41,7 +42,7 @@ Solver *constructSolverChain(Solver *coreSolver,
     solver = createFastCexSolver(solver);
 
   if (UseCexCache)
-    solver = createCexCachingSolver(solver);
+    solver = createCexCachingSolver(solver, arrayCache);
 
   if (UseCache)
     solver = createCachingSolver(solver);
@@ -13,26 +13,39 @@
 using namespace llvm;
 using namespace klee;
 
-ASContext::ASContext(Cloner *cloner, std::vector<Instruction *> &callTrace, Instruction *allocInst) {
-    refCount = 0;
+CallTraceNode::CallTraceNode(CallTraceNode *parent, Instruction *inst) :
+    parent(parent),
+    inst(inst)
+{
+    /* 0 is the id of a context without a call trace */
+    static uint64_t nextId = 1;
+    id = nextId++;
+}
 
-    for (std::vector<Instruction *>::iterator i = callTrace.begin(); i != callTrace.end(); i++) {
-        Instruction *inst = *i;
-        trace.push_back(getTranslatedInst(cloner, inst));
+CallTraceNode::~CallTraceNode() {
+    for (std::map<Instruction *, CallTraceNode *>::iterator i = children.begin(); i != children.end(); i++) {
+        delete i->second;
     }
+}
 
-    trace.push_back(getTranslatedInst(cloner, allocInst));
+CallTraceNode *CallTraceNode::getRoot() {
+    /* the interned nodes live as long as the process */
+    static CallTraceNode root(0, 0);
+    return &root;
 }
 
-ASContext::ASContext(ASContext &other) :
-    refCount(0),
-    trace(other.trace)    
-{
+CallTraceNode *CallTraceNode::getChild(Cloner *cloner, Instruction *inst) {
+    Instruction *translated = getTranslatedInst(cloner, inst);
+    CallTraceNode *&child = children[translated];
+    if (!child) {
+        child = new CallTraceNode(this, translated);
+    }
 
+    return child;
 }
 
 /* TODO: use the translatedValue API? */
-Instruction *ASContext::getTranslatedInst(Cloner *cloner, Instruction *inst) {
+Instruction *CallTraceNode::getTranslatedInst(Cloner *cloner, Instruction *inst) {
     Value *value = cloner->translateValue(inst);
     if (!isa<Instruction>(value)) {
         /* why... */
@@ -42,9 +55,28 @@ Instruction *ASContext::getTranslatedInst(Cloner *cloner, Instruction *inst) {
     return dyn_cast<Instruction>(value);
 }
 
+ASContext::ASContext(Cloner *cloner, CallTraceNode *callTrace, Instruction *allocInst) :
+    refCount(0),
+    node(callTrace->getChild(cloner, allocInst))
+{
+
+}
+
+ASContext::ASContext(ASContext &other) :
+    refCount(0),
+    node(other.node)
+{
+
+}
+
 void ASContext::dump() {
+    std::vector<Instruction *> trace;
+    for (CallTraceNode *n = node; n && n->getParent(); n = n->getParent()) {
+        trace.push_back(n->getInst());
+    }
+
     DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("allocation site context:"));
-    for (std::vector<Instruction *>::iterator i = trace.begin(); i != trace.end(); i++) {
+    for (std::vector<Instruction *>::reverse_iterator i = trace.rbegin(); i != trace.rend(); i++) {
         Instruction *inst = *i;
         Function *f = inst->getParent()->getParent();
         DEBUG_WITH_TYPE(DEBUG_BASIC, errs() << "  -- " << f->getName() << ":");
@@ -52,8 +84,9 @@ void ASContext::dump() {
     }
 }
 
+/* call traces are interned, so the nodes can be compared directly */
 bool ASContext::operator==(ASContext &other) {
-    return trace == other.trace;
+    return node == other.node;
 }
 
 bool ASContext::operator!=(ASContext &other) {
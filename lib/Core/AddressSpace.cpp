@@ -19,13 +19,23 @@ using namespace klee;
 
 ///
 
+void AddressSpace::chargeObject(ObjectState *os) {
+  size_t usage = os->getMemoryUsage();
+  ownedUsage = ownedUsage - os->chargedUsage + usage;
+  os->chargedUsage = usage;
+}
+
 void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
   assert(os->copyOnWriteOwner==0 && "object already has owner");
   os->copyOnWriteOwner = cowKey;
+  chargeObject(os);
   objects = objects.replace(std::make_pair(mo, os));
 }
 
 void AddressSpace::unbindObject(const MemoryObject *mo) {
+  const ObjectState *os = findObject(mo);
+  if (os && os->copyOnWriteOwner == cowKey)
+    ownedUsage -= os->chargedUsage;
   objects = objects.remove(mo);
 }
 
@@ -35,15 +45,28 @@ const ObjectState *AddressSpace::findObject(const MemoryObject *mo) const {
   return res ? res->second : 0;
 }
 
+void AddressSpace::getOwnedObjects(std::vector<ObjectState *> &result) const {
+  for (MemoryMap::iterator it = objects.begin(), ie = objects.end();
+       it != ie; ++it) {
+    ObjectState *os = it->second;
+    if (os->copyOnWriteOwner == cowKey)
+      result.push_back(os);
+  }
+}
+
 ObjectState *AddressSpace::getWriteable(const MemoryObject *mo,
                                         const ObjectState *os) {
   assert(!os->readOnly);
 
   if (cowKey==os->copyOnWriteOwner) {
-    return const_cast<ObjectState*>(os);
+    // the object is about to be written, account for its previous write
+    ObjectState *wos = const_cast<ObjectState*>(os);
+    chargeObject(wos);
+    return wos;
   } else {
     ObjectState *n = new ObjectState(*os);
     n->copyOnWriteOwner = cowKey;
+    chargeObject(n);
     objects = objects.replace(std::make_pair(mo, n));
     return n;    
   }
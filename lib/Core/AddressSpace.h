@@ -38,6 +38,13 @@ namespace klee {
     /// Epoch counter used to control ownership of objects.
     mutable unsigned cowKey;
 
+    /// The memory used by the objects that we own, as of their last
+    /// binding or ownership check (see getWriteable()).
+    mutable size_t ownedUsage;
+
+    /// Update the usage of an owned object in ownedUsage.
+    void chargeObject(ObjectState *os);
+
     /// Unsupported, use copy constructor
     AddressSpace &operator=(const AddressSpace&); 
     
@@ -52,8 +59,12 @@ namespace klee {
     MemoryMap objects;
     
   public:
-    AddressSpace() : cowKey(1) {}
-    AddressSpace(const AddressSpace &b) : cowKey(++b.cowKey), objects(b.objects) { }
+    AddressSpace() : cowKey(1), ownedUsage(0) {}
+    AddressSpace(const AddressSpace &b)
+      : cowKey(++b.cowKey), ownedUsage(0), objects(b.objects) {
+      // neither address space owns the shared objects anymore
+      b.ownedUsage = 0;
+    }
     ~AddressSpace() {}
 
     /// Resolve address to an ObjectPair in result.
@@ -100,6 +111,17 @@ namespace klee {
     /// Lookup a binding from a MemoryObject.
     const ObjectState *findObject(const MemoryObject *mo) const;
 
+    /// Collect the objects which are owned by this address space, i.e. which
+    /// were bound or written since it was last copied (no other address
+    /// space refers to them).
+    void getOwnedObjects(std::vector<ObjectState *> &result) const;
+
+    /// An estimate of the memory used by the objects that we own, i.e. the
+    /// memory which is released with the address space. It is maintained
+    /// incrementally, so the last write to an object is accounted for only
+    /// when the object is written again.
+    size_t getOwnedUsage() const { return ownedUsage; }
+
     /// \brief Obtain an ObjectState suitable for writing.
     ///
     /// This returns a writeable object state, creating a new copy of
@@ -36,10 +36,9 @@ AllocationRecord::~AllocationRecord() {
 
 void AllocationRecord::incRefCount() {
     for (Record::iterator i = record.begin(); i != record.end(); i++) {
-        Entry &entry = *i;
-        std::list<MemoryObject *> &memoryObjects = entry.second;
-        for (std::list<MemoryObject *>::iterator j = memoryObjects.begin(); j != memoryObjects.end(); j++) {
-            MemoryObject *mo = *j;
+        std::list<MemoryObject *> &memoryObjects = i->second.second;
+        for (std::list<MemoryObject *>::iterator k = memoryObjects.begin(); k != memoryObjects.end(); k++) {
+            MemoryObject *mo = *k;
             if (!mo) {
                 continue;
             }
@@ -51,10 +50,9 @@ void AllocationRecord::incRefCount() {
 
 void AllocationRecord::decRefCount() {
     for (Record::iterator i = record.begin(); i != record.end(); i++) {
-        Entry &entry = *i;
-        std::list<MemoryObject *> &memoryObjects = entry.second;
-        for (std::list<MemoryObject *>::iterator j = memoryObjects.begin(); j != memoryObjects.end(); j++) {
-            MemoryObject *mo = *j;
+        std::list<MemoryObject *> &memoryObjects = i->second.second;
+        for (std::list<MemoryObject *>::iterator k = memoryObjects.begin(); k != memoryObjects.end(); k++) {
+            MemoryObject *mo = *k;
             if (!mo) {
                 continue;
             }
@@ -74,7 +72,7 @@ void AllocationRecord::addAddr(ASContext &context, MemoryObject *mo) {
         ref<ASContext> c(new ASContext(context));
         std::list<MemoryObject *> q;
         q.push_back(mo);
-        record.push_back(std::make_pair(c, q));
+        record[context.getId()] = std::make_pair(c, q);
     } else {
         std::list<MemoryObject *> &q = entry->second;
         q.push_back(mo);
@@ -112,14 +110,12 @@ bool AllocationRecord::exists(ASContext &context) {
 }
 
 AllocationRecord::Entry *AllocationRecord::find(ASContext &context) {
-    for (Record::iterator i = record.begin(); i != record.end(); i++) {
-        Entry &entry = *i;
-        if (*entry.first == context) {
-            return &entry;
-        }
+    Record::iterator i = record.find(context.getId());
+    if (i == record.end()) {
+        return NULL;
     }
 
-    return NULL;
+    return &i->second;
 }
 
 void AllocationRecord::dump() {
@@ -128,7 +124,7 @@ void AllocationRecord::dump() {
     } else {
         DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("allocation record:"));
         for (Record::iterator i = record.begin(); i != record.end(); i++) {
-            Entry &entry = *i;
+            Entry &entry = i->second;
 
             /* dump context */
             ref<ASContext> c = entry.first;
@@ -137,8 +133,8 @@ void AllocationRecord::dump() {
             /* dump addresses */
             MemoryObjectList &memoryObjects = entry.second;
             DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("memory objects:"));
-            for (MemoryObjectList::iterator j = memoryObjects.begin(); j != memoryObjects.end(); j++) {
-                MemoryObject *mo = *j;
+            for (MemoryObjectList::iterator k = memoryObjects.begin(); k != memoryObjects.end(); k++) {
+                MemoryObject *mo = *k;
                 if (mo) {
                     DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("-- %lx", mo->address));
                 } else {
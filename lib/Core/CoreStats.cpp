@@ -12,6 +12,8 @@
 using namespace klee;
 
 Statistic stats::allocations("Allocations", "Alloc");
+Statistic stats::batchedRecoveries("BatchedRecoveries", "Rbatch");
+Statistic stats::costModelKeeps("CostModelKeeps", "CMkeeps");
 Statistic stats::coveredInstructions("CoveredInstructions", "Icov");
 Statistic stats::falseBranches("FalseBranches", "Bf");
 Statistic stats::forkTime("ForkTime", "Ftime");
@@ -22,8 +24,22 @@ Statistic stats::instructions("Instructions", "I");
 Statistic stats::minDistToReturn("MinDistToReturn", "Rdist");
 Statistic stats::minDistToUncovered("MinDistToUncovered", "UCdist");
 Statistic stats::reachableUncovered("ReachableUncovered", "IuncovReach");
+Statistic stats::recoveriesStarted("RecoveriesStarted", "Rstart");
+Statistic stats::recoveryCacheHits("RecoveryCacheHits", "Rhits");
+Statistic stats::recoveryTime("RecoveryTime", "RecTime");
 Statistic stats::resolveTime("ResolveTime", "Rtime");
+Statistic stats::sharedRecoveredValues("SharedRecoveredValues", "Rshared");
+Statistic stats::slicesGenerated("SlicesGenerated", "Slices");
+Statistic stats::slicingTime("SlicingTime", "SliceTime");
+Statistic stats::snapshotMemoryReclaimed("SnapshotMemoryReclaimed", "SnapMem");
+Statistic stats::snapshotsCollected("SnapshotsCollected", "SnapGC");
+Statistic stats::snapshotsTaken("SnapshotsTaken", "Snap");
 Statistic stats::solverTime("SolverTime", "Stime");
+Statistic stats::speculativeRecoveries("SpeculativeRecoveries", "Rspec");
+Statistic stats::speculativeRecoveryHits("SpeculativeRecoveryHits", "RspecHits");
 Statistic stats::states("States", "States");
+Statistic stats::statesSwappedIn("StatesSwappedIn", "SwapIn");
+Statistic stats::statesSwappedOut("StatesSwappedOut", "SwapOut");
 Statistic stats::trueBranches("TrueBranches", "Bt");
 Statistic stats::uncoveredInstructions("UncoveredInstructions", "Iuncov");
+Statistic stats::warmRestarts("WarmRestarts", "Wrst");
@@ -47,6 +47,51 @@ namespace stats {
   /// distance to a function return.
   extern Statistic minDistToReturn;
 
+  /// The number of recoveries saved by batching slices of the same snapshot.
+  extern Statistic batchedRecoveries;
+
+  /// The number of recovered values which were reused from another state.
+  extern Statistic sharedRecoveredValues;
+
+  /// The number of recoveries which speculatively executed all the slices
+  /// of the skipped function, and the number of blocking loads which were
+  /// resolved by them without another recovery.
+  extern Statistic speculativeRecoveries;
+  extern Statistic speculativeRecoveryHits;
+
+  /// The number of functions kept by an in-process restart.
+  extern Statistic warmRestarts;
+
+  /// The number of functions kept by the online cost model of the Keeper.
+  extern Statistic costModelKeeps;
+
+  /// The number of snapshots dropped by the snapshot collector, and the
+  /// memory (in bytes) which was reclaimed by dropping them.
+  extern Statistic snapshotsCollected;
+  extern Statistic snapshotMemoryReclaimed;
+
+  /// The number of snapshots taken at calls to skipped functions, and the
+  /// number of recovery states started from them.
+  extern Statistic snapshotsTaken;
+  extern Statistic recoveriesStarted;
+
+  /// The number of blocking loads which were resolved by a recovered value
+  /// (of this state, of a speculative recovery or of another state).
+  extern Statistic recoveryCacheHits;
+
+  /// The number of slices generated, and the time (in microseconds) spent by
+  /// the executor generating or waiting for them.
+  extern Statistic slicesGenerated;
+  extern Statistic slicingTime;
+
+  /// The time (in microseconds) spent in recoveries, see Keeper.
+  extern Statistic recoveryTime;
+
+  /// The number of states which were written to disk at the memory cap, and
+  /// the number of states which were read back.
+  extern Statistic statesSwappedIn;
+  extern Statistic statesSwappedOut;
+
 }
 }
 
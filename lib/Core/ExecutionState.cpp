@@ -44,8 +44,8 @@ namespace {
 
 StackFrame::StackFrame(KInstIterator _caller, KFunction *_kf)
   : caller(_caller), kf(_kf), callPathNode(0), 
-    minDistToUncoveredOnReturn(0), varargs(0) {
-  locals = new Cell[kf->numRegisters];
+    locals(std::vector<Cell>(kf->numRegisters)),
+    minDistToUncoveredOnReturn(0), varargs(0), callTraceNode(0) {
 }
 
 StackFrame::StackFrame(const StackFrame &s) 
@@ -53,15 +53,13 @@ StackFrame::StackFrame(const StackFrame &s)
     kf(s.kf),
     callPathNode(s.callPathNode),
     allocas(s.allocas),
+    locals(s.locals),
     minDistToUncoveredOnReturn(s.minDistToUncoveredOnReturn),
-    varargs(s.varargs) {
-  locals = new Cell[s.kf->numRegisters];
-  for (unsigned i=0; i<s.kf->numRegisters; i++)
-    locals[i] = s.locals[i];
+    varargs(s.varargs),
+    callTraceNode(s.callTraceNode) {
 }
 
 StackFrame::~StackFrame() { 
-  delete[] locals; 
 }
 
 /***/
@@ -83,6 +81,8 @@ ExecutionState::ExecutionState(KFunction *kf) :
     recoveryInfo(0),
     level(0),
     priority(PRIORITY_LOW),
+    pathDependent(false),
+    allocated(false),
 
     pc(kf->instructions),
     prevPC(pc),
@@ -90,6 +90,7 @@ ExecutionState::ExecutionState(KFunction *kf) :
     queryCost(0.), 
     weight(1),
     depth(0),
+    steppedInstructions(0),
 
     instsSinceCovNew(0),
     coveredNew(false),
@@ -132,6 +133,7 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     writtenAddresses(state.writtenAddresses),
     pendingRecoveryInfos(state.pendingRecoveryInfos),
     recoveryCache(state.recoveryCache),
+    recoveredSlices(state.recoveredSlices),
 
     /* recovery state properties */
     exitInst(state.exitInst),
@@ -141,6 +143,8 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     guidingAllocationRecord(state.guidingAllocationRecord),
     level(state.level),
     priority(state.priority),
+    pathDependent(state.pathDependent),
+    allocated(state.allocated),
 
     pc(state.pc),
     prevPC(state.prevPC),
@@ -153,6 +157,7 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     queryCost(state.queryCost),
     weight(state.weight),
     depth(state.depth),
+    steppedInstructions(state.steppedInstructions),
 
     pathOS(state.pathOS),
     symPathOS(state.symPathOS),
@@ -366,13 +371,14 @@ bool ExecutionState::merge(const ExecutionState &b) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
-      ref<Expr> &av = af.locals[i].value;
-      const ref<Expr> &bv = bf.locals[i].value;
+      const ref<Expr> &av = af.getLocal(i).value;
+      const ref<Expr> &bv = bf.getLocal(i).value;
       if (av.isNull() || bv.isNull()) {
         // if one is null then by implication (we are at same pc)
         // we cannot reuse this local, so just ignore
       } else {
-        av = SelectExpr::create(inA, av, bv);
+        ref<Expr> merged = SelectExpr::create(inA, av, bv);
+        af.getWritableLocal(i).value = merged;
       }
     }
   }
@@ -425,7 +431,7 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 
       out << ai->getName().str();
       // XXX should go through function
-      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].value;
+      ref<Expr> value = sf.getLocal(sf.kf->getArgRegister(index++)).value;
       if (value.get() && isa<ConstantExpr>(value))
         out << "=" << value;
     }
@@ -437,16 +443,49 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
   }
 }
 
-void ExecutionState::getCallTrace(std::vector<Instruction *> &callTrace) {
-    for (std::vector<StackFrame>::iterator i = stack.begin(); i != stack.end(); i++) {
-        StackFrame sf = *i;
+CallTraceNode *ExecutionState::getCallTraceNode(Cloner *cloner) {
+    /* find the innermost frame with a computed node */
+    int start = (int)stack.size() - 1;
+    while (start >= 0 && !stack[start].callTraceNode) {
+        start--;
+    }
+
+    CallTraceNode *node = start >= 0 ? stack[start].callTraceNode : CallTraceNode::getRoot();
+    for (unsigned i = start + 1; i < stack.size(); i++) {
+        StackFrame &sf = stack[i];
 
         /* skip the main frame */
-        if (sf.kf->function->getName() == "main") {
+        if (sf.caller && sf.kf->function->getName() != "main") {
+            node = node->getChild(cloner, sf.caller->inst);
+        }
+
+        sf.callTraceNode = node;
+    }
+
+    return node;
+}
+
+size_t Snapshot::getMemoryUsage() const {
+    size_t usage = sizeof(Snapshot) + sizeof(ExecutionState) + retainedUsage;
+    return usage + recoveredValues.size() * sizeof(RecoveredValues::value_type);
+}
+
+StateMemoryUsage ExecutionState::getMemoryUsage() const {
+    StateMemoryUsage usage;
+    usage.objects = addressSpace.getOwnedUsage();
+    /* a typical expression node */
+    usage.constraints = constraints.getNumNodes() * sizeof(BinaryExpr) +
+                        constraints.getIndexMemoryUsage();
+
+    for (std::vector< ref<Snapshot> >::const_iterator i = snapshots->begin(); i != snapshots->end(); i++) {
+        const ref<Snapshot> &snapshot = *i;
+        if (snapshot.isNull()) {
             continue;
         }
 
-        Instruction *inst = sf.caller->inst;
-        callTrace.push_back(inst);
+        usage.snapshots += snapshot->getMemoryUsage();
     }
+
+    usage.recoveryCache = recoveryCache->size() * sizeof(RecoveryCache::value_type);
+    return usage;
 }
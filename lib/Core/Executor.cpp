@@ -18,6 +18,7 @@
 #include "Searcher.h"
 #include "SeedInfo.h"
 #include "SpecialFunctionHandler.h"
+#include "StateSwapper.h"
 #include "StatsTracker.h"
 #include "TimingSolver.h"
 #include "UserSearcher.h"
@@ -119,8 +120,11 @@
 #include <string>
 
 #include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <errno.h>
+#include <string.h>
 #include <cxxabi.h>
 
 using namespace llvm;
@@ -333,11 +337,27 @@ namespace {
             cl::desc("Refuse to fork when above this amount of memory (in MB, default=2000)"),
             cl::init(2000));
 
+  cl::opt<unsigned>
+  Threads("threads",
+          cl::desc("Explore the states in this many worker processes. The "
+                   "states are partitioned once, when there are enough of them "
+                   "and no recovery is in flight or state swapped out, and the "
+                   "workers do not exchange states afterwards. Each worker "
+                   "writes to worker-<id> in the output directory, and its "
+                   "statistics are added to the totals of the main process "
+                   "(default=1)"),
+          cl::init(1));
+
   cl::opt<bool>
   MaxMemoryInhibit("max-memory-inhibit",
             cl::desc("Inhibit forking at memory cap (vs. random terminate) (default=on)"),
             cl::init(true));
 
+  cl::opt<bool>
+  SwapStates("swap-states",
+             cl::desc("Write the memory of cold states to disk at memory cap, instead of terminating them (default=off)"),
+             cl::init(false));
+
   // CHASER options
 
   cl::opt<bool>
@@ -351,6 +371,50 @@ namespace {
   llvm::cl::opt<bool> UseSlicer("use-slicer",
                                 llvm::cl::desc("Slice skipped functions"),
                                 llvm::cl::init(true));
+
+  cl::opt<bool>
+  ShareRecoveredValues("share-recovered-values", cl::init(false),
+                       cl::desc("Reuse the values recovered from a snapshot by other states which hold the snapshot (default=off)"));
+
+  cl::opt<bool>
+  BatchRecovery("batch-recovery", cl::init(false),
+                cl::desc("Recover all the modifiers of a snapshot which may affect a blocking load in a single recovery state (default=off)"));
+
+  cl::opt<bool>
+  SpeculativeRecovery("speculative-recovery", cl::init(false),
+                      cl::desc("When recovering a function whose results are usually needed, execute all its slices and record all their writes, so later blocking loads from the same snapshot do not need another recovery (default=off)"));
+
+  cl::opt<unsigned>
+  SpeculativeRecoveryRatio("speculative-recovery-ratio", cl::init(90),
+                           cl::desc("The minimal percentage of recoveries per skip of a function for recovering it speculatively (default=90)"));
+
+  cl::opt<bool>
+  CollectSnapshots("collect-snapshots", cl::init(true),
+                   cl::desc("Periodically drop the snapshots which can not be used by any future recovery (default=on)"));
+
+  cl::opt<bool>
+  BackgroundSlicing("background-slicing", cl::init(false),
+                    cl::desc("Generate slices in a background thread, prioritizing skipped functions (default=off)"));
+
+  cl::opt<bool>
+  ReuseReachingDefinitions("reuse-reaching-definitions", cl::init(true),
+                           cl::desc("Compute the reaching definitions of a skipped function once for all of its slices, and keep them until its last slice is generated (the dependence graph is still built for each slice) (default=on)"));
+
+  cl::opt<bool>
+  WarmRestart("warm-restart", cl::init(true),
+              cl::desc("Keep a timed-out function in-process instead of writing restart.sh and halting (default=on)"));
+
+  cl::opt<double>
+  KeeperTuneInterval("keeper-tune-interval", cl::init(0),
+                     cl::desc("Periodically (in seconds) keep the skipped functions which are estimated to be cheaper to execute than to recover (default=0 (off))"));
+
+  cl::opt<unsigned>
+  KeeperTuneMinRecoveries("keeper-tune-min-recoveries", cl::init(5),
+                          cl::desc("The number of recoveries of a function before its cost is estimated (default=5)"));
+
+  cl::opt<double>
+  KeeperTuneWarmup("keeper-tune-warmup", cl::init(60),
+                   cl::desc("The time (in seconds) from the start of the exploration before the cost model keeps any function (default=60)"));
 }
 
 
@@ -374,6 +438,8 @@ const char *Executor::TerminateReasonNames[] = {
 };
 
 #define HUGE_ALLOC_SIZE (1U << 31)
+/* the minimal number of states per worker before partitioning the states */
+#define MIN_STATES_PER_WORKER 4
 
 Executor::Executor(InterpreterOptions &opts, InterpreterHandler *ih)
     : Interpreter(opts), kmodule(0), interpreterHandler(ih), searcher(0),
@@ -381,29 +447,19 @@ Executor::Executor(InterpreterOptions &opts, InterpreterHandler *ih)
       pathWriter(0), symPathWriter(0), specialFunctionHandler(0),
       processTree(0), replayKTest(0), replayPath(0), usingSeeds(0),
       atMemoryLimit(false), inhibitForking(false), haltExecution(false),
-      ivcEnabled(false),
+      ivcEnabled(false), workerId(0), statesPartitioned(false),
+      numRecoveryStates(0), numSuspendedStates(0),
       coreSolverTimeout(MaxCoreSolverTime != 0 && MaxInstructionTime != 0
                             ? std::min(MaxCoreSolverTime, MaxInstructionTime)
                             : std::max(MaxCoreSolverTime, MaxInstructionTime)),
       debugInstFile(0), debugLogBuffer(debugBufferString),
-      errorCount(0),
+      keeperTuneStartTime(0), errorCount(0),
       logFile(0) {
 
   if (coreSolverTimeout) UseForkedCoreSolver = true;
-  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
-  if (!coreSolver) {
-    klee_error("Failed to create core solver\n");
-  }
-
-  Solver *solver = constructSolverChain(
-      coreSolver,
-      interpreterHandler->getOutputFilename(ALL_QUERIES_SMT2_FILE_NAME),
-      interpreterHandler->getOutputFilename(SOLVER_QUERIES_SMT2_FILE_NAME),
-      interpreterHandler->getOutputFilename(ALL_QUERIES_KQUERY_FILE_NAME),
-      interpreterHandler->getOutputFilename(SOLVER_QUERIES_KQUERY_FILE_NAME));
-
-  this->solver = new TimingSolver(solver, EqualitySubstitution);
+  this->solver = createSolver();
   memory = new MemoryManager(&arrayCache);
+  swapper = SwapStates ? new StateSwapper(interpreterHandler) : NULL;
 
   if (optionIsSet(DebugPrintInstructions, FILE_ALL) ||
       optionIsSet(DebugPrintInstructions, FILE_COMPACT) ||
@@ -479,13 +535,18 @@ const Module *Executor::setModule(llvm::Module *module,
     mra = new ModRefAnalysis(kmodule->module, ra, aa, opts.EntryPoint, skippedTargets, *logFile);
     cloner = new Cloner(module, ra, *logFile);
     if (UseSlicer) {
-      sliceGenerator = new SliceGenerator(module, ra, aa, mra, cloner, *logFile, LazySlicing);
+      sliceGenerator = new SliceGenerator(module, ra, aa, mra, cloner, *logFile, LazySlicing, BackgroundSlicing,
+                                          ReuseReachingDefinitions);
     }
   }
 
   // calls ReturnToVoidFunctionPass with (keeper.skipMode, keeper.selectedFunctions)
   kmodule->prepare(opts, keeper, interpreterHandler, ra, inliner, aa, mra, cloner, sliceGenerator);
 
+  if (sliceGenerator && sliceGenerator->isBackground()) {
+    sliceGenerator->startWorker();
+  }
+
   specialFunctionHandler->bind();
 
   if (StatsTracker::useStatistics() || userSearcherRequiresMD2U()) {
@@ -508,11 +569,14 @@ Executor::~Executor() {
     delete specialFunctionHandler;
   if (statsTracker)
     delete statsTracker;
+  if (swapper)
+    delete swapper;
   delete solver;
   /* TODO: is it the right place? */
   if (sliceGenerator) delete sliceGenerator;
   if (cloner) delete cloner;
   if (mra) delete mra;
+  if (aa) delete aa;
   if (inliner) delete inliner;
   if (ra) delete ra;
   if (keeper) delete keeper;
@@ -912,6 +976,10 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
   if (isSeeding)
     timeout *= it->second.size();
   solver->setTimeout(timeout);
+  if (current.isRecoveryState() && !isa<ConstantExpr>(condition)) {
+    current.setPathDependent(true);
+  }
+
   bool success = solver->evaluate(current, condition, res);
   solver->setTimeout(0);
   if (!success) {
@@ -1225,7 +1293,7 @@ const Cell& Executor::eval(KInstruction *ki, unsigned index,
   } else {
     unsigned index = vnumber;
     StackFrame &sf = state.stack.back();
-    return sf.locals[index];
+    return sf.getLocal(index);
   }
 }
 
@@ -1265,6 +1333,11 @@ ref<klee::ConstantExpr>
 Executor::toConstant(ExecutionState &state, 
                      ref<Expr> e,
                      const char *reason) {
+  /* the value is fixed either by the equalities of the (guiding) constraints,
+     or by the constraint which is added below */
+  if (state.isRecoveryState() && !isa<ConstantExpr>(e))
+    state.setPathDependent(true);
+
   e = state.constraints.simplifyExpr(e);
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(e))
     return CE;
@@ -1293,6 +1366,9 @@ Executor::toConstant(ExecutionState &state,
 void Executor::executeGetValue(ExecutionState &state,
                                ref<Expr> e,
                                KInstruction *target) {
+  if (state.isRecoveryState() && !isa<ConstantExpr>(e))
+    state.setPathDependent(true);
+
   e = state.constraints.simplifyExpr(e);
   std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it = 
     seedMap.find(&state);
@@ -1372,6 +1448,7 @@ void Executor::stepInstruction(ExecutionState &state) {
     statsTracker->stepInstruction(state);
 
   ++stats::instructions;
+  ++state.steppedInstructions;
   state.prevPC = state.pc;
   ++state.pc;
 
@@ -1495,15 +1572,22 @@ void Executor::executeCall(ExecutionState &state,
           DEBUG_BASIC,
           klee_message("%p: adding snapshot (index = %u)", &state, index)
         );
+        /* the owned memory is shared with the snapshot state once it is created */
+        size_t retainedUsage = state.addressSpace.getOwnedUsage();
         ref<ExecutionState> snapshotState(createSnapshotState(state));
-        ref<Snapshot> snapshot(new Snapshot(snapshotState, f));
+        ref<Snapshot> snapshot(new Snapshot(snapshotState, f, retainedUsage));
         state.addSnapshot(snapshot);
         interpreterHandler->incSnapshotsCount();
+        ++stats::snapshotsTaken;
 
         /* TODO: will be replaced later... */
         state.clearRecoveredAddresses();
 
-        keeper->skippingRiskyFunction(/*state, */f);
+        keeper->skippingRiskyFunction(/*state, */f, retainedUsage);
+
+        if (sliceGenerator && sliceGenerator->isBackground()) {
+          sliceGenerator->scheduleSlices(f, SliceGenerator::SLICE_SKIPPED);
+        }
 
         DEBUG_WITH_TYPE(
           DEBUG_BASIC,
@@ -1689,7 +1773,11 @@ Function* Executor::getTargetFunction(Value *calledVal, ExecutionState &state) {
       if (alias != "") {
         llvm::Module* currModule = kmodule->module;
         GlobalValue *old_gv = gv;
-        gv = currModule->getNamedValue(alias);
+        {
+          /* the slicing worker adds the clones to the symbol table */
+          std::unique_lock<std::mutex> guard = lockModule();
+          gv = currModule->getNamedValue(alias);
+        }
         if (!gv) {
           klee_error("Function %s(), alias for %s not found!\n", alias.c_str(),
                      old_gv->getName().str().c_str());
@@ -2833,15 +2921,24 @@ void Executor::updateStates(ExecutionState *current) {
     for (std::vector<ExecutionState *>::iterator i = suspendedStates.begin(); i != suspendedStates.end(); i++) {
       searcher->removeState(*i);
     }
+    numSuspendedStates += suspendedStates.size();
     suspendedStates.clear();
 
     /* handle resumed states */
     for (std::vector<ExecutionState *>::iterator i = resumedStates.begin(); i != resumedStates.end(); i++) {
       searcher->addState(*i);
     }
+    numSuspendedStates -= resumedStates.size();
     resumedStates.clear();
   }
   
+  for (std::vector<ExecutionState *>::iterator i = addedStates.begin(); i != addedStates.end(); i++) {
+    ExecutionState *es = *i;
+    if (es->isRecoveryState())
+      numRecoveryStates++;
+    if (es->isNormalState() && es->isSuspended())
+      numSuspendedStates++;
+  }
   states.insert(addedStates.begin(), addedStates.end());
   addedStates.clear();
 
@@ -2857,6 +2954,10 @@ void Executor::updateStates(ExecutionState *current) {
     } else {
       states.erase(it2);
     }
+    if (es->isRecoveryState())
+      numRecoveryStates--;
+    if (es->isNormalState() && es->isSuspended())
+      numSuspendedStates--;
     std::map<ExecutionState*, std::vector<SeedInfo> >::iterator it3 = 
       seedMap.find(es);
     if (it3 != seedMap.end())
@@ -2930,7 +3031,40 @@ void Executor::bindModuleConstants() {
   }
 }
 
+namespace {
+  /* a state and its memory usage, which is computed once for sorting */
+  typedef std::pair<size_t, ExecutionState *> StateCost;
+
+  /* the most expensive states are killed first */
+  struct KillOrder {
+    bool operator()(const StateCost &a, const StateCost &b) const {
+      return a.first > b.first;
+    }
+  };
+
+  /* cold states are swapped out first: the suspended states (which wait for
+     a recovery) and then the states which did not cover new code, the ones
+     which release the most memory first */
+  struct SwapOrder {
+    bool operator()(const StateCost &a, const StateCost &b) const {
+      if (a.second->isSuspended() != b.second->isSuspended()) {
+        return a.second->isSuspended();
+      }
+      if (a.second->coveredNew != b.second->coveredNew) {
+        return !a.second->coveredNew;
+      }
+      return a.first > b.first;
+    }
+  };
+}
+
 void Executor::checkMemoryUsage() {
+  if (CollectSnapshots && (stats::instructions & 0xFFFF) == 0)
+    collectSnapshots();
+
+  if (!pendingKeptTargets.empty() && (stats::instructions & 0xFFFF) == 0)
+    removeKeptTargets();
+
   if (!MaxMemory)
     return;
   if ((stats::instructions & 0xFFFF) == 0) {
@@ -2945,24 +3079,27 @@ void Executor::checkMemoryUsage() {
         // just guess at how many to kill
         unsigned numStates = states.size();
         unsigned toKill = std::max(1U, numStates - numStates * MaxMemory / mbs);
-        klee_warning("killing %d states (over memory cap)", toKill);
-        std::vector<ExecutionState *> arr;
-        for (std::set<ExecutionState *>::iterator i = states.begin(); i != states.end(); i++) {
-          ExecutionState *toremove = *i;
-          if ((toremove->isNormalState() && toremove->isSuspended()) || toremove->isRecoveryState())  {
-            continue;
-          }
-          arr.push_back(toremove);
+        if (swapper) {
+          /* swapping a state releases only its owned memory, so the states
+             are killed in proportion to the memory which is still needed */
+          uint64_t needed = (uint64_t) (mbs - MaxMemory) << 20;
+          uint64_t released = swapOutStates(needed);
+          toKill = released >= needed ? 0 : std::max(1U, (unsigned) (toKill * (needed - released) / needed));
         }
-        for (unsigned i = 0, N = arr.size(); N && i < toKill; ++i, --N) {
-          unsigned idx = rand() % N;
-          // Make two pulls to try and not hit a state that
-          // covered new code.
-          if (arr[idx]->coveredNew)
-            idx = rand() % N;
-
-          std::swap(arr[idx], arr[N - 1]);
-          terminateStateEarly(*arr[N - 1], "Memory limit exceeded.");
+        if (toKill) {
+          klee_warning("killing %d states (over memory cap)", toKill);
+          std::vector<StateCost> arr;
+          for (std::set<ExecutionState *>::iterator i = states.begin(); i != states.end(); i++) {
+            ExecutionState *toremove = *i;
+            if ((toremove->isNormalState() && toremove->isSuspended()) || toremove->isRecoveryState())  {
+              continue;
+            }
+            arr.push_back(StateCost(getMemoryUsage(*toremove).total(), toremove));
+          }
+          std::stable_sort(arr.begin(), arr.end(), KillOrder());
+          for (unsigned i = 0; i < arr.size() && i < toKill; ++i) {
+            terminateStateEarly(*arr[i].second, "Memory limit exceeded.");
+          }
         }
       }
       atMemoryLimit = true;
@@ -2972,6 +3109,242 @@ void Executor::checkMemoryUsage() {
   }
 }
 
+uint64_t Executor::swapOutStates(uint64_t needed) {
+  std::vector<StateCost> candidates;
+  for (std::set<ExecutionState *>::iterator i = states.begin(); i != states.end(); i++) {
+    ExecutionState *es = *i;
+    if (!es->isNormalState() || es->isRecoveryState() || swapper->isSwapped(*es)) {
+      continue;
+    }
+    candidates.push_back(StateCost(es->addressSpace.getOwnedUsage(), es));
+  }
+
+  std::stable_sort(candidates.begin(), candidates.end(), SwapOrder());
+
+  unsigned swapped = 0;
+  uint64_t released = 0;
+  for (unsigned i = 0; i < candidates.size() && released < needed; i++) {
+    size_t size = swapper->swapOut(*candidates[i].second);
+    if (size) {
+      swapped++;
+      released += size;
+    }
+  }
+
+  if (swapped) {
+    klee_warning("swapping out %u states, releasing %lu MB (over memory cap)", swapped, (unsigned long) (released >> 20));
+  }
+  return released;
+}
+
+void Executor::swapInState(ExecutionState &state) {
+  if (swapper) {
+    swapper->swapIn(state);
+  }
+}
+
+StateMemoryUsage Executor::getMemoryUsage(ExecutionState &state) {
+  StateMemoryUsage usage = state.getMemoryUsage();
+  /* the objects of a swapped state are not in memory */
+  if (swapper && swapper->isSwapped(state)) {
+    usage.objects = 0;
+  }
+  return usage;
+}
+
+TimingSolver *Executor::createSolver() {
+  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
+  if (!coreSolver) {
+    klee_error("Failed to create core solver\n");
+  }
+
+  Solver *solver = constructSolverChain(
+      coreSolver,
+      interpreterHandler->getOutputFilename(ALL_QUERIES_SMT2_FILE_NAME),
+      interpreterHandler->getOutputFilename(SOLVER_QUERIES_SMT2_FILE_NAME),
+      interpreterHandler->getOutputFilename(ALL_QUERIES_KQUERY_FILE_NAME),
+      interpreterHandler->getOutputFilename(SOLVER_QUERIES_KQUERY_FILE_NAME),
+      &arrayCache);
+
+  return new TimingSolver(solver, EqualitySubstitution);
+}
+
+/* the states are independent only if there is no recovery in flight
+   (recovery states and their suspended dependent states must stay together) */
+bool Executor::canPartitionStates() {
+  if (Threads <= 1 || statesPartitioned)
+    return false;
+
+  /* the swapped states are not owned by a worker */
+  if (swapper && !swapper->empty())
+    return false;
+
+  if (states.size() < Threads * MIN_STATES_PER_WORKER)
+    return false;
+
+  return numRecoveryStates == 0 && numSuspendedStates == 0;
+}
+
+/* fork the worker processes, each worker keeps every Threads-th state. The
+   partitioning is static: the workers can't exchange states, since a state
+   can't be moved between processes */
+void Executor::partitionStates() {
+  statesPartitioned = true;
+
+  /* the slicing thread does not survive a fork */
+  bool backgroundSlicing = sliceGenerator && sliceGenerator->isBackground();
+  if (backgroundSlicing)
+    sliceGenerator->stopWorker();
+
+  /* otherwise, the buffered output is written by each worker */
+  interpreterHandler->getInfoStream().flush();
+  if (logFile)
+    logFile->flush();
+  if (debugInstFile)
+    debugInstFile->flush();
+  if (statsTracker)
+    statsTracker->flush();
+  fflush(NULL);
+
+  /* the workers send the statistics they collect from now on */
+  partitionTotals.resize(theStatisticManager->getNumStatistics());
+  for (unsigned i = 0; i < partitionTotals.size(); i++)
+    partitionTotals[i] = theStatisticManager->getValue(theStatisticManager->getStatistic(i));
+
+  std::vector<bool> owned(Threads, false);
+  owned[0] = true;
+  for (unsigned id = 1; id < Threads; id++) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+      klee_warning("unable to create a pipe for worker %u: %s", id, strerror(errno));
+      owned[id] = true;
+      continue;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+      workerId = id;
+      workers.clear();
+      for (std::vector<int>::iterator i = workerPipes.begin(); i != workerPipes.end(); i++)
+        close(*i);
+      workerPipes.clear();
+      close(fds[0]);
+      workerPipes.push_back(fds[1]);
+      owned.assign(Threads, false);
+      owned[id] = true;
+      break;
+    }
+
+    close(fds[1]);
+    if (pid < 0) {
+      klee_warning("unable to fork worker %u: %s", id, strerror(errno));
+      close(fds[0]);
+      owned[id] = true;
+      continue;
+    }
+
+    workers.push_back(pid);
+    workerPipes.push_back(fds[0]);
+  }
+
+  if (workerId != 0) {
+    interpreterHandler->setWorkerId(workerId);
+    if (statsTracker)
+      statsTracker->reopenFiles();
+
+    /* the forked core solver communicates through a shared memory segment,
+       so each worker needs its own solver (the inherited counterexample
+       cache is merged into -cex-cache-file, and reloaded by the new one) */
+    delete solver;
+    solver = createSolver();
+  }
+
+  /* the states are ordered by address, so all the workers see the same order */
+  unsigned index = 0;
+  for (std::set<ExecutionState *>::iterator i = states.begin(); i != states.end(); i++, index++) {
+    if (!owned[index % Threads]) {
+      removedStates.push_back(*i);
+    }
+  }
+  updateStates(0);
+
+  klee_message("worker %u: exploring %u states", workerId, (unsigned) states.size());
+
+  if (backgroundSlicing)
+    sliceGenerator->startWorker();
+}
+
+/* the statistics of the worker are added to the totals of the main process
+   (and so to the last line of its run.stats and to its final summary) */
+void Executor::sendWorkerStatistics() {
+  std::vector<uint64_t> values(partitionTotals.size());
+  for (unsigned i = 0; i < values.size(); i++)
+    values[i] = theStatisticManager->getValue(theStatisticManager->getStatistic(i)) - partitionTotals[i];
+
+  const char *buffer = (const char *) values.data();
+  size_t size = values.size() * sizeof(uint64_t);
+  int fd = workerPipes.front();
+  while (size > 0) {
+    ssize_t written = write(fd, buffer, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      klee_warning("unable to send the statistics of worker %u: %s", workerId, strerror(errno));
+      break;
+    }
+    buffer += written;
+    size -= written;
+  }
+
+  close(fd);
+  workerPipes.clear();
+}
+
+void Executor::waitForWorkers() {
+  if (workerId != 0) {
+    sendWorkerStatistics();
+    return;
+  }
+
+  for (unsigned w = 0; w < workers.size(); w++) {
+    /* read before waiting, so the worker doesn't block on a full pipe */
+    std::vector<uint64_t> values(partitionTotals.size());
+    char *buffer = (char *) values.data();
+    size_t size = values.size() * sizeof(uint64_t);
+    while (size > 0) {
+      ssize_t n = read(workerPipes[w], buffer, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      buffer += n;
+      size -= n;
+    }
+    close(workerPipes[w]);
+
+    if (size == 0) {
+      for (unsigned i = 0; i < values.size(); i++)
+        theStatisticManager->incrementGlobalValue(theStatisticManager->getStatistic(i), values[i]);
+    } else {
+      klee_warning("unable to read the statistics of worker process %d", workers[w]);
+    }
+  }
+  workerPipes.clear();
+
+  for (std::vector<pid_t>::iterator i = workers.begin(); i != workers.end(); i++) {
+    int status;
+    if (waitpid(*i, &status, 0) < 0) {
+      klee_warning("unable to wait for worker process %d: %s", *i, strerror(errno));
+      continue;
+    }
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      klee_warning("worker process %d did not exit normally", *i);
+    }
+  }
+  workers.clear();
+}
+
 void Executor::doDumpStates() {
   if (!DumpStatesOnHalt || states.empty())
     return;
@@ -2993,6 +3366,11 @@ void Executor::run(ExecutionState &initialState) {
   // optimization and such.
   initTimers();
 
+  if (KeeperTuneInterval && keeper->isSkipping()) {
+    keeperTuneStartTime = util::getWallTime();
+    addTimer(new KeeperTuneTimer(this), KeeperTuneInterval);
+  }
+
   states.insert(&initialState);
 
   if (usingSeeds) {
@@ -3072,6 +3450,7 @@ void Executor::run(ExecutionState &initialState) {
   while (!states.empty() && !haltExecution) {
     assert(!searcher->empty());
     ExecutionState &state = searcher->selectState();
+    swapInState(state);
     KInstruction *ki = state.pc;
     stepInstruction(state);
 
@@ -3081,12 +3460,17 @@ void Executor::run(ExecutionState &initialState) {
     checkMemoryUsage();
 
     updateStates(&state);
+
+    if (canPartitionStates())
+      partitionStates();
   }
 
   delete searcher;
   searcher = 0;
 
   doDumpStates();
+
+  waitForWorkers();
 }
 
 std::string Executor::getAddressInfo(ExecutionState &state, 
@@ -3145,6 +3529,10 @@ void Executor::terminateState(ExecutionState &state) {
                       "replay did not consume all objects in test input.");
   }
 
+  if (swapper) {
+    swapper->discard(state);
+  }
+
   if (!state.isRecoveryState()) {
     interpreterHandler->incPathsExplored();
   }
@@ -3427,7 +3815,12 @@ void Executor::callExternalFunction(ExecutionState &state,
       klee_warning_once(function, "%s", os.str().c_str());
   }
   
-  bool success = externalDispatcher->executeCall(function, target->inst, args);
+  bool success;
+  {
+    /* the dispatcher creates stubs in the shared LLVM context */
+    std::unique_lock<std::mutex> guard = lockModule();
+    success = externalDispatcher->executeCall(function, target->inst, args);
+  }
   if (!success) {
     terminateStateOnError(state, "failed external call: " + function->getName(),
                           External);
@@ -3683,10 +4076,24 @@ void Executor::executeMemoryOperation(ExecutionState &state,
   unsigned bytes = Expr::getMinBytesForWidth(type);
 
   if (SimplifySymIndices) {
+    ref<Expr> simplifiedAddress = address;
+    ref<Expr> simplifiedValue = value;
     if (!isa<ConstantExpr>(address))
-      address = state.constraints.simplifyExpr(address);
+      simplifiedAddress = state.constraints.simplifyExpr(address);
     if (isWrite && !isa<ConstantExpr>(value))
-      value = state.constraints.simplifyExpr(value);
+      simplifiedValue = state.constraints.simplifyExpr(value);
+
+    /* the equalities may come from the guiding constraints */
+    if (state.isRecoveryState() &&
+        (simplifiedAddress != address || (isWrite && simplifiedValue != value)))
+      state.setPathDependent(true);
+
+    address = simplifiedAddress;
+    value = simplifiedValue;
+  }
+
+  if (state.isRecoveryState() && !isa<ConstantExpr>(address)) {
+    state.setPathDependent(true);
   }
 
   // fast path: single in-bounds resolution
@@ -4162,7 +4569,11 @@ bool Executor::isRecoveryRequired(ExecutionState &state, KInstruction *ki) {
   ref<Expr> addressExpr = eval(ki, 0, state).value;
   if (!isa<ConstantExpr>(addressExpr)) {
     addressExpr = state.constraints.simplifyExpr(addressExpr);
-    addressExpr = toConstant(state, addressExpr, "resolveOne failure");
+    if (!isa<ConstantExpr>(addressExpr)) {
+      /* the load may read from more than one location (or object),
+         this is checked when the load is resolved */
+      return true;
+    }
   }
 
   uint64_t address = dyn_cast<ConstantExpr>(addressExpr)->getZExtValue();
@@ -4213,6 +4624,10 @@ bool Executor::handleMayBlockingLoad(ExecutionState &state, KInstruction *ki,
     return false;
   }
 
+  if (BatchRecovery) {
+    batchRecoveryInfos(recoveryInfos);
+  }
+
   #if 0
   // JOR: debugging
   if(PrintFunctionCalls) {
@@ -4247,6 +4662,7 @@ bool Executor::getAllRecoveryInfo(ExecutionState &state, KInstruction *ki,
   uint64_t loadAddr;
   uint64_t loadSize;
   ModRefAnalysis::AllocSite preciseAllocSite;
+  bool isSymbolic;
 
   /* TODO: decide which value to pass (original, cloned) */
   loadInst = ki->getOrigInst();
@@ -4255,7 +4671,7 @@ bool Executor::getAllRecoveryInfo(ExecutionState &state, KInstruction *ki,
   DEBUG_WITH_TYPE(DEBUG_BASIC, errs() << "- stack trace:\n");
   DEBUG_WITH_TYPE(DEBUG_BASIC, state.dumpStack(errs()));
 
-  if (!getLoadInfo(state, ki, loadAddr, loadSize, preciseAllocSite))
+  if (!getLoadInfo(state, ki, loadAddr, loadSize, preciseAllocSite, isSymbolic))
     return false;
 
   /* get the allocation site computed by static analysis */
@@ -4265,9 +4681,10 @@ bool Executor::getAllRecoveryInfo(ExecutionState &state, KInstruction *ki,
   /* all the recovery information which may be required  */
   std::list< ref<RecoveryInfo> > required;
   /* the snapshots of the state */
-  std::vector< ref<Snapshot> > &snapshots = state.getSnapshots();
-  /* we start from the last snapshot which is not affected by an overwrite */
-  unsigned int startIndex = state.getStartingIndex(loadAddr, loadSize);
+  const std::vector< ref<Snapshot> > &snapshots = state.getSnapshots();
+  /* we start from the last snapshot which is not affected by an overwrite
+     (for a symbolic load, the overwrites are checked per address) */
+  unsigned int startIndex = isSymbolic ? 0 : state.getStartingIndex(loadAddr, loadSize);
 
   /* collect recovery information */
   for (unsigned int index = startIndex; index < snapshots.size(); index++) {
@@ -4278,6 +4695,10 @@ bool Executor::getAllRecoveryInfo(ExecutionState &state, KInstruction *ki,
     }
 
     ref<Snapshot> snapshot = snapshots[index];
+    if (snapshot.isNull()) {
+      /* dropped by the snapshot collector */
+      continue;
+    }
     Function *snapshotFunction = snapshot->f;
 
     for (std::set<ModRefAnalysis::ModInfo>::iterator j = approximateModInfos.begin(); j != approximateModInfos.end(); j++) {
@@ -4303,14 +4724,44 @@ bool Executor::getAllRecoveryInfo(ExecutionState &state, KInstruction *ki,
       recoveryInfo->loadSize = loadSize;
       recoveryInfo->f = modInfo.first;
       recoveryInfo->sliceId = sliceId;
+      recoveryInfo->sliceIds.push_back(sliceId);
       recoveryInfo->snapshot = snapshot;
       recoveryInfo->snapshotIndex = index;
+      recoveryInfo->objectWide = isSymbolic;
 
       required.push_back(recoveryInfo);
 
-      /* TODO: validate that each snapshot corresponds to at most one modifier */
-      break;
+      if (!BatchRecovery) {
+        /* TODO: validate that each snapshot corresponds to at most one modifier */
+        break;
+      }
+    }
+  }
+
+  if (isSymbolic) {
+    /* the load may read any part of the object, so the writes of all the
+       slices are applied by the order of the snapshots */
+    bool isRecovered = true;
+    for (std::list< ref<RecoveryInfo> >::iterator i = required.begin(); i != required.end(); i++) {
+      if (!state.isRecoveredSlice((*i)->snapshotIndex, (*i)->sliceId)) {
+        isRecovered = false;
+        break;
+      }
+    }
+
+    if (isRecovered) {
+      for (std::list< ref<RecoveryInfo> >::iterator i = required.begin(); i != required.end(); i++) {
+        applyRecoveredWrites(state, *i);
+      }
+      if (state.isRecoveryState()) {
+        /* the writes were recovered on the path of the dependent states */
+        state.setPathDependent(true);
+      }
+    } else {
+      /* the recovery states write to the object in the same order */
+      result.insert(result.end(), required.begin(), required.end());
     }
+    return true;
   }
 
   /* do some filtering... */
@@ -4332,10 +4783,28 @@ bool Executor::getAllRecoveryInfo(ExecutionState &state, KInstruction *ki,
     );
 
     ref<Expr> expr;
-    if (state.getRecoveredValue(index, sliceId, loadAddr, expr)) {
+    bool isCached = state.getRecoveredValue(index, sliceId, loadAddr, expr);
+    if (!isCached && state.isRecoveredSlice(index, sliceId)) {
+      /* the slice was speculatively executed and did not modify the address */
+      ++stats::speculativeRecoveryHits;
+      isCached = true;
+    }
+    if (!isCached && ShareRecoveredValues && getSharedRecoveredValue(state, recoveryInfo, expr)) {
+      /* recovered by another state which holds the same snapshot */
+      state.updateRecoveredValue(index, sliceId, loadAddr, expr);
+      isCached = true;
+    }
+
+    if (isCached) {
       /* this slice was already executed from this snapshot,
          and we know which value was written (or not) */
+      ++stats::recoveryCacheHits;
       state.addRecoveredAddress(loadAddr);
+      if (state.isRecoveryState()) {
+        /* the value may have been recovered on the path of the dependent
+           states, or point to an object which was allocated there */
+        state.setPathDependent(true);
+      }
 
       if (!expr.isNull()) {
         DEBUG_WITH_TYPE(
@@ -4381,24 +4850,194 @@ bool Executor::getAllRecoveryInfo(ExecutionState &state, KInstruction *ki,
       );
       /* TODO: add docs */
       state.updateRecoveredValue(index, sliceId, loadAddr, NULL);
+      if (shouldRecoverSpeculatively(recoveryInfo->f)) {
+        makeSpeculative(recoveryInfo);
+      }
       result.push_front(recoveryInfo);
     }
   }
   return true;
 }
 
+/* a recovered value can be reused by another state which holds the snapshot
+   (only the values which are the same on every path are shared) */
+bool Executor::getSharedRecoveredValue(ExecutionState &state, ref<RecoveryInfo> recoveryInfo, ref<Expr> &expr) {
+  Snapshot::RecoveredValues &recoveredValues = recoveryInfo->snapshot->recoveredValues;
+  Snapshot::RecoveredValues::iterator entry = recoveredValues.find(
+    std::make_pair(recoveryInfo->sliceId, recoveryInfo->loadAddr)
+  );
+  if (entry == recoveredValues.end()) {
+    return false;
+  }
+
+  ++stats::sharedRecoveredValues;
+  expr = entry->second;
+  return true;
+}
+
+void Executor::shareRecoveredValues(ExecutionState &recoveryState) {
+  /* a path dependent value may not be valid in the other states, and the
+     objects allocated by the recovery are bound only in its dependent states */
+  if (recoveryState.isPathDependent() || recoveryState.hasAllocated()) {
+    return;
+  }
+
+  ref<RecoveryInfo> recoveryInfo = recoveryState.getRecoveryInfo();
+  ExecutionState *dependentState = recoveryState.getDependentState();
+  ref<Snapshot> snapshot = recoveryInfo->snapshot;
+
+  for (std::vector<uint32_t>::iterator i = recoveryInfo->sliceIds.begin(); i != recoveryInfo->sliceIds.end(); i++) {
+    ref<Expr> value;
+    if (!dependentState->getRecoveredValue(recoveryInfo->snapshotIndex, *i, recoveryInfo->loadAddr, value)) {
+      continue;
+    }
+
+    snapshot->recoveredValues[std::make_pair(*i, recoveryInfo->loadAddr)] = value;
+  }
+}
+
+/* merges the recovery infos which use the same snapshot, so their slices are
+   executed by a single recovery state (which uses the union slice) */
+void Executor::batchRecoveryInfos(std::list<ref<RecoveryInfo> > &recoveryInfos) {
+  std::list< ref<RecoveryInfo> > batched;
+
+  for (std::list< ref<RecoveryInfo> >::iterator i = recoveryInfos.begin(); i != recoveryInfos.end(); ) {
+    ref<RecoveryInfo> first = *i;
+    std::set<uint32_t> sliceIds;
+    bool speculative = false;
+    for (; i != recoveryInfos.end() && (*i)->snapshotIndex == first->snapshotIndex; i++) {
+      sliceIds.insert((*i)->sliceIds.begin(), (*i)->sliceIds.end());
+      speculative |= (*i)->speculative;
+    }
+
+    if (sliceIds.size() == 1) {
+      batched.push_back(first);
+      continue;
+    }
+
+    ref<RecoveryInfo> recoveryInfo(new RecoveryInfo());
+    recoveryInfo->loadInst = first->loadInst;
+    recoveryInfo->loadAddr = first->loadAddr;
+    recoveryInfo->loadSize = first->loadSize;
+    recoveryInfo->f = first->f;
+    /* without slicing, the whole function is executed anyway */
+    recoveryInfo->sliceId = sliceGenerator ? sliceGenerator->getUnionSliceId(sliceIds) : first->sliceId;
+    recoveryInfo->sliceIds.assign(sliceIds.begin(), sliceIds.end());
+    recoveryInfo->speculative = speculative;
+    recoveryInfo->objectWide = first->objectWide;
+    recoveryInfo->snapshot = first->snapshot;
+    recoveryInfo->snapshotIndex = first->snapshotIndex;
+    batched.push_back(recoveryInfo);
+
+    DEBUG_WITH_TYPE(
+      DEBUG_BASIC,
+      klee_message(
+        "batching %lu slices (snapshot index = %u, slice id = %u)",
+        sliceIds.size(),
+        recoveryInfo->snapshotIndex,
+        recoveryInfo->sliceId
+      )
+    );
+    stats::batchedRecoveries += sliceIds.size() - 1;
+  }
+
+  recoveryInfos.swap(batched);
+}
+
+/* the results of a function are usually needed if most of its skips were
+   followed by a recovery */
+bool Executor::shouldRecoverSpeculatively(Function *f) {
+  if (!SpeculativeRecovery) {
+    return false;
+  }
+
+  int skips = keeper->getSkipsCount(f);
+  if (skips == 0) {
+    return false;
+  }
+
+  return (uint64_t)(keeper->getRecoveriesCount(f)) * 100 >= (uint64_t)(skips) * SpeculativeRecoveryRatio;
+}
+
+/* extends the recovery info to all the slices of the function, so all the
+   values which may be needed later are recovered by a single recovery state */
+void Executor::makeSpeculative(ref<RecoveryInfo> recoveryInfo) {
+  std::set<uint32_t> sliceIds;
+  ModRefAnalysis::ModInfoToIdMap &modInfoToIdMap = mra->getModInfoToIdMap();
+  for (ModRefAnalysis::ModInfoToIdMap::iterator i = modInfoToIdMap.begin(); i != modInfoToIdMap.end(); i++) {
+    if (i->first.first == recoveryInfo->f) {
+      sliceIds.insert(i->second);
+    }
+  }
+
+  if (sliceIds.size() <= 1) {
+    /* the slice of the load already contains all the modifications */
+    recoveryInfo->speculative = true;
+    ++stats::speculativeRecoveries;
+    return;
+  }
+
+  /* without slicing, the whole function is executed anyway */
+  if (sliceGenerator) {
+    recoveryInfo->sliceId = sliceGenerator->getUnionSliceId(sliceIds);
+  }
+  recoveryInfo->sliceIds.assign(sliceIds.begin(), sliceIds.end());
+  recoveryInfo->speculative = true;
+  ++stats::speculativeRecoveries;
+
+  DEBUG_WITH_TYPE(
+    DEBUG_BASIC,
+    klee_message(
+      "speculative recovery of %s: %lu slices (snapshot index = %u, slice id = %u)",
+      recoveryInfo->f->getName().data(),
+      sliceIds.size(),
+      recoveryInfo->snapshotIndex,
+      recoveryInfo->sliceId
+    )
+  );
+}
+
+/* applies the recorded writes of an object-wide recovery, except the ones
+   which were overridden by the state after the snapshot was taken */
+void Executor::applyRecoveredWrites(ExecutionState &state, ref<RecoveryInfo> recoveryInfo) {
+  std::vector<std::pair<uint64_t, ref<Expr> > > values;
+  state.getRecoveredValues(recoveryInfo->snapshotIndex, recoveryInfo->sliceId,
+                           recoveryInfo->loadAddr, recoveryInfo->loadSize, values);
+
+  for (std::vector<std::pair<uint64_t, ref<Expr> > >::iterator i = values.begin(); i != values.end(); i++) {
+    uint64_t address = i->first;
+    ref<Expr> value = i->second;
+    if (value.isNull()) {
+      continue;
+    }
+
+    WrittenAddressInfo info;
+    size_t size = Expr::getMinBytesForWidth(value->getWidth());
+    if (state.getWrittenAddressInfo(address, size, info) && info.snapshotIndex >= recoveryInfo->snapshotIndex) {
+      continue;
+    }
+
+    executeMemoryOperation(state, true, Expr::createPointer(address), value, 0);
+  }
+}
+
 bool Executor::getLoadInfo(ExecutionState &state, KInstruction *ki,
                            uint64_t &loadAddr, uint64_t &loadSize,
-                           ModRefAnalysis::AllocSite &allocSite) {
+                           ModRefAnalysis::AllocSite &allocSite, bool &isSymbolic) {
   ObjectPair op;
   bool success;
   ConstantExpr *ce;
 
   ref<Expr> address = eval(ki, 0, state).value;
+  Expr::Width width = getWidthForLLVMType(ki->inst->getType());
+  unsigned int bytes = Expr::getMinBytesForWidth(width);
 
-  if (SimplifySymIndices) {
-    if (!isa<ConstantExpr>(address)) {
-      address = state.constraints.simplifyExpr(address);
+  /* simplified as in isRecoveryRequired() */
+  if (!isa<ConstantExpr>(address)) {
+    address = state.constraints.simplifyExpr(address);
+    /* the recovered location may be fixed by the guiding constraints */
+    if (state.isRecoveryState()) {
+      state.setPathDependent(true);
     }
   }
 
@@ -4410,32 +5049,50 @@ bool Executor::getLoadInfo(ExecutionState &state, KInstruction *ki,
   }
   solver->setTimeout(0);
 
+  if (success && !isa<ConstantExpr>(address)) {
+    /* the whole object is recovered, so the load must be in its bounds */
+    bool inBounds;
+    solver->setTimeout(coreSolverTimeout);
+    bool result = solver->mustBeTrue(state,
+                                     op.first->getBoundsCheckPointer(address, bytes),
+                                     inBounds);
+    solver->setTimeout(0);
+    success = result && inBounds;
+  }
+
   if (success) {
-    /* get load address */
+    const MemoryObject *mo = op.first;
+    uint64_t offset;
+
     ce = dyn_cast<ConstantExpr>(address);
-    if (!ce) {
-      /* TODO: use the resolve() API in order to support symbolic addresses */
-      state.dumpStack(llvm::errs());
-      llvm_unreachable("getLoadInfo() does not support symbolic addresses");
+    if (ce) {
+      isSymbolic = false;
+
+      /* get load address and size */
+      loadAddr = ce->getZExtValue();
+      loadSize = bytes;
+
+      /* get allocation site offset */
+      /* TODO: we don't actually need the offset... */
+      ref<Expr> offsetExpr = mo->getOffsetExpr(address);
+      offsetExpr = toConstant(state, offsetExpr, "...");
+      ce = dyn_cast<ConstantExpr>(offsetExpr);
+      assert(ce);
+      offset = ce->getZExtValue();
+    } else {
+      /* the load may read any part of the object */
+      isSymbolic = true;
+      loadAddr = mo->address;
+      loadSize = mo->size;
+      offset = 0;
+      DEBUG_WITH_TYPE(
+        DEBUG_BASIC,
+        klee_message("%p: symbolic blocking load, recovering the object %#lx (size = %lu)", &state, loadAddr, loadSize)
+      );
     }
 
-    loadAddr = ce->getZExtValue();
-
-    /* get load size */
-    Expr::Width width = getWidthForLLVMType(ki->inst->getType());
-    loadSize = Expr::getMinBytesForWidth(width);
-
-    /* get allocation site value and offset */
-    const MemoryObject *mo = op.first;
-    /* TODO: we don't actually need the offset... */
-    ref<Expr> offsetExpr = mo->getOffsetExpr(address);
-    offsetExpr = toConstant(state, offsetExpr, "...");
-    ce = dyn_cast<ConstantExpr>(offsetExpr);
-    assert(ce);
-
     /* translate value... */
     const Value *translatedValue = cloner->translateValue((Value *)(mo->allocSite));
-    uint64_t offset = ce->getZExtValue();
 
     /* get the precise allocation site */
     allocSite = std::make_pair(translatedValue, offset);
@@ -4450,21 +5107,33 @@ bool Executor::getLoadInfo(ExecutionState &state, KInstruction *ki,
                                                  coreSolverTimeout);
     solver->setTimeout(0);
 
-    if (rl.empty()) {
-      if (!incomplete) {
-        klee_warning(
-            "Unable to resolve blocking load to any address. Terminating state");
-        terminateStateOnError(
-            state, "Unable to resolve blocking load to any address", Unhandled);
-      } else {
+    /* fork for each object, the forked states execute the load again and
+       resolve it to a single object */
+    ExecutionState *unbound = &state;
+    for (ResolutionList::iterator i = rl.begin(); i != rl.end(); i++) {
+      const MemoryObject *mo = i->first;
+      ref<Expr> inBounds = mo->getBoundsCheckPointer(address, bytes);
+
+      StatePair branches = fork(*unbound, inBounds, true);
+      ExecutionState *bound = branches.first;
+      if (bound) {
+        bound->pc = bound->prevPC;
+      }
+
+      unbound = branches.second;
+      if (!unbound)
+        break;
+    }
+
+    if (unbound) {
+      if (incomplete) {
         klee_warning("Unable to resolve blocking load address: Solver timeout");
         terminateStateEarly(
-            state, "Unable to resolve blocking load address: solver timeout");
+            *unbound, "Unable to resolve blocking load address: solver timeout");
+      } else {
+        terminateStateOnError(*unbound, "memory error: out of bound pointer", Ptr,
+                              NULL, getAddressInfo(*unbound, address));
       }
-    } else {
-      klee_warning("Resolving blocking load address: multiple resolutions");
-      terminateStateEarly(
-          state, "Resolving blocking load address: multiple resolutions");
     }
     return false;
   }
@@ -4479,6 +5148,7 @@ void Executor::suspendState(ExecutionState &state) {
 
 void Executor::resumeState(ExecutionState &state, bool implicitlyCreated) {
   DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("resuming: %p", &state));
+  swapInState(state);
   state.setResumed();
   state.setRecoveryState(0);
   state.markLoadAsUnrecovered();
@@ -4506,7 +5176,34 @@ void Executor::onRecoveryStateExit(ExecutionState &state) {
     for(unsigned i = 0; i < state.stack.size(); i++) prefix += "\u2012 "; // —
     DEBUG_CHOPPER(DEBUG_RECOVERY, klee_message("%s ", prefix.c_str())); //, state.getRecoveryInfo()->f->getName().str().c_str());
   }
-  keeper->recoveredFunction(state.getRecoveryInfo());
+  ref<RecoveryInfo> recoveryInfo = state.getRecoveryInfo();
+  ref<ExecutionState> snapshotState = recoveryInfo->snapshot->state;
+  uint64_t recoveryTime = keeper->getTotalRecoveryTime(recoveryInfo->f);
+  keeper->recoveredFunction(recoveryInfo,
+                            state.steppedInstructions - snapshotState->steppedInstructions,
+                            state.depth - snapshotState->depth);
+  stats::recoveryTime += keeper->getTotalRecoveryTime(recoveryInfo->f) - recoveryTime;
+
+  if (recoveryInfo->speculative || recoveryInfo->objectWide) {
+    /* all the writes of the slices were recorded in the recovery cache */
+    for (std::vector<uint32_t>::iterator i = recoveryInfo->sliceIds.begin(); i != recoveryInfo->sliceIds.end(); i++) {
+      dependentState->addRecoveredSlice(recoveryInfo->snapshotIndex, *i);
+    }
+  }
+
+  if (ShareRecoveredValues) {
+    shareRecoveredValues(state);
+  }
+
+  if (dependentState->isRecoveryState()) {
+    /* the dependent recovery state uses the results of this recovery */
+    if (state.isPathDependent()) {
+      dependentState->setPathDependent(true);
+    }
+    if (state.hasAllocated()) {
+      dependentState->setAllocated(true);
+    }
+  }
 
   /* check if we need to run another recovery state */
   if (dependentState->hasPendingRecoveryInfo()) {
@@ -4524,7 +5221,7 @@ void Executor::notifyDependentState(ExecutionState &recoveryState) {
 
   if (recoveryState.isNormalState()) {
     /* the allocation record of the recovery states contains the allocation record of the dependent state */
-    dependentState->setAllocationRecord(recoveryState.getAllocationRecord());
+    dependentState->shareAllocationRecord(recoveryState);
   }
 
   if (states.find(dependentState) == states.end()) {
@@ -4605,9 +5302,9 @@ void Executor::startRecoveryState(ExecutionState &state, ref<RecoveryInfo> recov
     recoveryState->markLoadAsRecovered();
     recoveryState->clearRecoveredAddresses();
     /* TODO: we actually need only a prefix of that */
-    recoveryState->setRecoveryCache(state.getRecoveryCache());
+    recoveryState->shareRecoveryCache(state);
     /* this state may create another recovery state, so it must hold the allocation record */
-    recoveryState->setAllocationRecord(state.getAllocationRecord());
+    recoveryState->shareAllocationRecord(state);
     /* make sure it is empty... */
     assert(recoveryState->getGuidingConstraints().empty());
     /* TODO: handle writtenAddresses */
@@ -4635,15 +5332,15 @@ void Executor::startRecoveryState(ExecutionState &state, ref<RecoveryInfo> recov
   recoveryState->setRecoveryInfo(recoveryInfo);
 
   /* pass allocation record to recovery state */
-  recoveryState->setGuidingAllocationRecord(state.getAllocationRecord());
+  recoveryState->shareGuidingAllocationRecord(state);
 
   /* recursion level */
   unsigned int level = state.isRecoveryState() ? state.getLevel() + 1 : 0;
   recoveryState->setLevel(level);
 
   /* add the guiding constraints to the recovery state */
-  std::set< ref<Expr> > &constraints = originatingState->getGuidingConstraints();
-  for (std::set< ref<Expr> >::iterator i = constraints.begin(); i != constraints.end(); i++) {
+  const std::set< ref<Expr> > &constraints = originatingState->getGuidingConstraints();
+  for (std::set< ref<Expr> >::const_iterator i = constraints.begin(); i != constraints.end(); i++) {
     addConstraint(*recoveryState, *i);
   }
   DEBUG_WITH_TYPE(
@@ -4651,6 +5348,10 @@ void Executor::startRecoveryState(ExecutionState &state, ref<RecoveryInfo> recov
     klee_message("adding %lu guiding constraints", constraints.size())
   );
 
+  /* the guiding constraints are recorded separately */
+  recoveryState->setPathDependent(false);
+  recoveryState->setAllocated(false);
+
   /* TODO: update prevPC? */
   recoveryState->pc = recoveryState->prevPC;
 
@@ -4679,6 +5380,7 @@ void Executor::startRecoveryState(ExecutionState &state, ref<RecoveryInfo> recov
 
   /* update statistics */
   interpreterHandler->incRecoveryStatesCount();
+  ++stats::recoveriesStarted;
 }
 
 /* TODO: handle vastart calls */
@@ -4706,12 +5408,35 @@ void Executor::onRecoveryStateWrite(
 
   uint64_t storeAddr = dyn_cast<ConstantExpr>(address)->getZExtValue();
   ref<RecoveryInfo> recoveryInfo = state.getRecoveryInfo();
-  if (storeAddr != recoveryInfo->loadAddr) {
+  bool isLoaded;
+  if (recoveryInfo->objectWide) {
+    isLoaded = storeAddr >= recoveryInfo->loadAddr && storeAddr < recoveryInfo->loadAddr + recoveryInfo->loadSize;
+
+    /* the snapshots are not filtered by the overwrites of the object,
+       so the overridden addresses are checked here */
+    WrittenAddressInfo info;
+    size_t size = Expr::getMinBytesForWidth(value->getWidth());
+    if (isLoaded && state.getDependentState()->getWrittenAddressInfo(storeAddr, size, info) &&
+        info.snapshotIndex >= recoveryInfo->snapshotIndex) {
+      isLoaded = false;
+    }
+  } else {
+    isLoaded = storeAddr == recoveryInfo->loadAddr;
+  }
+  if (!isLoaded) {
+    if (recoveryInfo->speculative || recoveryInfo->objectWide) {
+      /* the value is written to the dependent state when it is loaded */
+      ExecutionState *dependentState = state.getDependentState();
+      for (std::vector<uint32_t>::iterator i = recoveryInfo->sliceIds.begin(); i != recoveryInfo->sliceIds.end(); i++) {
+        dependentState->updateRecoveredValue(recoveryInfo->snapshotIndex, *i, storeAddr, value);
+      }
+    }
     return;
   }
 
   /* copy data to dependent state... */
   ExecutionState *dependentState = state.getDependentState();
+  swapInState(*dependentState);
   const ObjectState *os = dependentState->addressSpace.findObject(mo);
   ObjectState *wos = dependentState->addressSpace.getWriteable(mo, os);
   wos->write(offset, value);
@@ -4731,12 +5456,14 @@ void Executor::onRecoveryStateWrite(
       recoveryInfo->sliceId
     )
   );
-  dependentState->updateRecoveredValue(
-    recoveryInfo->snapshotIndex,
-    recoveryInfo->sliceId,
-    storeAddr,
-    value
-  );
+  for (std::vector<uint32_t>::iterator i = recoveryInfo->sliceIds.begin(); i != recoveryInfo->sliceIds.end(); i++) {
+    dependentState->updateRecoveredValue(
+      recoveryInfo->snapshotIndex,
+      *i,
+      storeAddr,
+      value
+    );
+  }
 }
 
 void Executor::onNormalStateWrite(
@@ -4800,13 +5527,10 @@ void Executor::onNormalStateRead(
     return;
   }
 
-  assert(isa<ConstantExpr>(address));
-
-  ConstantExpr *ce = dyn_cast<ConstantExpr>(address);
-  uint64_t addr = ce->getZExtValue();
-
-  /* update recovered loads */
-  state.addRecoveredAddress(addr);
+  /* update recovered loads (a symbolic load is checked again) */
+  if (ConstantExpr *ce = dyn_cast<ConstantExpr>(address)) {
+    state.addRecoveredAddress(ce->getZExtValue());
+  }
   state.markLoadAsRecovered();
 }
 
@@ -4822,9 +5546,7 @@ MemoryObject *Executor::onExecuteAlloc(ExecutionState &state, uint64_t size, boo
     MemoryObject *mo = NULL;
 
     /* get the context of the allocation instruction */
-    std::vector<Instruction *> callTrace;
-    state.getCallTrace(callTrace);
-    ASContext context(cloner, callTrace, allocInst);
+    ASContext context(cloner, state.getCallTraceNode(cloner), allocInst);
 
     ExecutionState *dependentState = state.getDependentState();
     AllocationRecord &guidingAllocationRecord = state.getGuidingAllocationRecord();
@@ -4869,6 +5591,7 @@ MemoryObject *Executor::onExecuteAlloc(ExecutionState &state, uint64_t size, boo
     if (mo) {
         /* bind the address to the dependent states */
         bindAll(dependentState, mo, isLocal, zeroMemory);
+        state.setAllocated(true);
     }
 
     return mo;
@@ -4926,6 +5649,11 @@ void Executor::mergeConstraints(ExecutionState &dependentState, ref<Expr> condit
 }
 
 bool Executor::isFunctionToSkip(ExecutionState &state, Function *f) {
+    // kept by an in-process restart
+    if(keeper->isDynamicallyKept(f)) {
+      onFunctionKept(f);
+      return false;
+    }
     // keep mode, call keeper
     if(interpreterOpts.skipMode == CHOP_KEEP) {
       return keeper->isFunctionToSkip(f);
@@ -4983,6 +5711,7 @@ void Executor::bindAll(ExecutionState *state, MemoryObject *mo, bool isLocal, bo
         }
 
         DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("%p: binding address: %lx", state, mo->address));
+        swapInState(*state);
         if (!state->addressSpace.findObject(mo)) {
             ObjectState *os = bindObjectInState(*state, mo, isLocal);
             /* initialize allocated object */
@@ -5007,6 +5736,7 @@ void Executor::unbindAll(ExecutionState *state, const MemoryObject *mo) {
         }
 
         DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("%p: unbinding address %lx", state, mo->address));
+        swapInState(*state);
         state->addressSpace.unbindObject(mo);
 
         state = next;
@@ -5021,6 +5751,7 @@ void Executor::forkDependentStates(ExecutionState *trueState, ExecutionState *fa
 
     /* fork the chain of dependent states */
     do {
+        swapInState(*current);
         forked = new ExecutionState(*current);
         assert(forked->isSuspended());
         DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("forked dependent state: %p (from %p)", forked, current));
@@ -5083,6 +5814,25 @@ void Executor::mergeConstraintsForAll(ExecutionState &recoveryState, ref<Expr> c
 /* on demand slicing... */
 Function *Executor::getSlice(Function *target, uint32_t sliceId, ModRefAnalysis::SideEffectType type) {
     Cloner::SliceInfo *sliceInfo = NULL;
+    /* the time spent on the critical path (the background thread might
+       have generated the slice already) */
+    TimerStatIncrementer timer(stats::slicingTime);
+
+    if (sliceGenerator->isBackground()) {
+        sliceGenerator->waitForSlice(target, sliceId, type);
+
+        std::unique_lock<std::mutex> guard = lockModule();
+        if (installedSlices.insert(std::make_pair(target, sliceId)).second) {
+            sliceGenerator->dumpSlice(target, sliceId, true);
+            interpreterHandler->incGeneratedSlicesCount();
+            ++stats::slicesGenerated;
+            installSlice(target, sliceId);
+        }
+
+        sliceInfo = cloner->getSliceInfo(target, sliceId);
+        assert(sliceInfo);
+        return sliceInfo->f;
+    }
 
     sliceInfo = cloner->getSliceInfo(target, sliceId);
     if (!sliceInfo || !sliceInfo->isSliced) {
@@ -5094,54 +5844,68 @@ Function *Executor::getSlice(Function *target, uint32_t sliceId, ModRefAnalysis:
 
         /* update statistics */
         interpreterHandler->incGeneratedSlicesCount();
+        ++stats::slicesGenerated;
 
         if (!sliceInfo) {
             sliceInfo = cloner->getSliceInfo(target, sliceId);
             assert(sliceInfo);
         }
 
-        std::set<Function *> &reachable = ra->getReachableFunctions(target);
-        for (std::set<Function *>::iterator i = reachable.begin(); i != reachable.end(); i++) {
-            /* original function */
-            Function *f = *i;
-            if (f->isDeclaration()) {
-                continue;
-            }
+        installSlice(target, sliceId);
+    }
 
-            /* get the cloned function (using the slice id) */
-            Function *cloned = cloner->getSliceInfo(f, sliceId)->f;
-            if (cloned->isDeclaration()) {
-                /* a sliced function can become empty (a decleration) */
-                continue;
-            }
+    return sliceInfo->f;
+}
 
-            /* initialize KFunction */
-            KFunction *kcloned = new KFunction(cloned, kmodule);
-            kcloned->isCloned = true;
-
-            DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("adding function: %s", cloned->getName().data()));
-            /* update debug info */
-            kmodule->infos->addClonedInfo(cloner, cloned);
-            /* update function map */
-            kmodule->addFunction(kcloned, true, cloner, mra);
-            /* update the instruction constants of the new KFunction */
-            for (unsigned i = 0; i < kcloned->numInstructions; ++i) {
-                bindInstructionConstants(kcloned->instructions[i]);
-            }
-            /* when we add a KFunction, additional constants might be added */
-            for (unsigned i = kmodule->constantTable.size(); i < kmodule->constants.size(); ++i) {
-                Cell c = {
-                    .value = evalConstant(kmodule->constants[i])
-                };
-                kmodule->constantTable.push_back(c);
-            }
+void Executor::installSlice(Function *target, uint32_t sliceId) {
+    std::set<Function *> &reachable = ra->getReachableFunctions(target);
+    for (std::set<Function *>::iterator i = reachable.begin(); i != reachable.end(); i++) {
+        /* original function */
+        Function *f = *i;
+        if (f->isDeclaration()) {
+            continue;
+        }
+
+        /* get the cloned function (using the slice id) */
+        Function *cloned = cloner->getSliceInfo(f, sliceId)->f;
+        if (cloned->isDeclaration()) {
+            /* a sliced function can become empty (a decleration) */
+            continue;
+        }
+
+        /* initialize KFunction */
+        KFunction *kcloned = new KFunction(cloned, kmodule);
+        kcloned->isCloned = true;
+
+        DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("adding function: %s", cloned->getName().data()));
+        /* update debug info */
+        kmodule->infos->addClonedInfo(cloner, cloned);
+        /* update function map */
+        kmodule->addFunction(kcloned, true, cloner, mra);
+        /* update the instruction constants of the new KFunction */
+        for (unsigned i = 0; i < kcloned->numInstructions; ++i) {
+            bindInstructionConstants(kcloned->instructions[i]);
+        }
+        /* when we add a KFunction, additional constants might be added */
+        for (unsigned i = kmodule->constantTable.size(); i < kmodule->constants.size(); ++i) {
+            Cell c = {
+                .value = evalConstant(kmodule->constants[i])
+            };
+            kmodule->constantTable.push_back(c);
         }
     }
+}
 
-    return sliceInfo->f;
+std::unique_lock<std::mutex> Executor::lockModule() {
+    if (sliceGenerator && sliceGenerator->isBackground()) {
+        return std::unique_lock<std::mutex>(sliceGenerator->getModuleLock());
+    }
+    return std::unique_lock<std::mutex>();
 }
 
 ExecutionState *Executor::createSnapshotState(ExecutionState &state) {
+    /* the stack frames, the constraints and the chopper metadata are shared
+       with the state, and copied only when one of them is modified */
     ExecutionState *snapshotState = new ExecutionState(state);
 
     /* remove guiding constraints */
@@ -5150,6 +5914,122 @@ ExecutionState *Executor::createSnapshotState(ExecutionState &state) {
     return snapshotState;
 }
 
+/* a snapshot is used only by the may-blocking loads which may depend on the
+   side effects of its function, so it is dead if none of these loads is
+   reachable from the functions on the stack or from the functions of the
+   later snapshots (a recovery state may create nested recovery states) */
+void Executor::collectSnapshots() {
+    size_t usage = util::GetTotalMallocUsage();
+    unsigned int collected = 0;
+
+    for (std::set<ExecutionState *>::iterator i = states.begin(); i != states.end(); i++) {
+        ExecutionState *state = *i;
+        if (!state->isNormalState() || state->isRecoveryState() || state->isSuspended()) {
+            continue;
+        }
+
+        std::set<Function *> roots;
+        for (ExecutionState::stack_ty::iterator j = state->stack.begin(); j != state->stack.end(); j++) {
+            roots.insert(j->kf->function);
+        }
+        collected += collectDeadSnapshots(*state, roots);
+
+        /* compact the snapshot states (the result does not depend on the path) */
+        const std::vector< ref<Snapshot> > &snapshots = state->getSnapshots();
+        for (unsigned int index = 0; index < snapshots.size(); index++) {
+            ref<Snapshot> snapshot = snapshots[index];
+            if (snapshot.isNull() || snapshot->compacted) {
+                continue;
+            }
+
+            std::set<Function *> snapshotRoots;
+            snapshotRoots.insert(snapshot->f);
+            collected += collectDeadSnapshots(*snapshot->state, snapshotRoots);
+            snapshot->compacted = true;
+        }
+    }
+
+    if (collected == 0) {
+        return;
+    }
+
+    stats::snapshotsCollected += collected;
+    size_t current = util::GetTotalMallocUsage();
+    if (current < usage) {
+        stats::snapshotMemoryReclaimed += usage - current;
+    }
+    DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("collected %u snapshots", collected));
+}
+
+unsigned int Executor::collectDeadSnapshots(ExecutionState &state, std::set<Function *> &roots) {
+    const std::vector< ref<Snapshot> > &snapshots = state.getSnapshots();
+    std::set<Function *> users(roots);
+    std::vector<unsigned int> dead;
+
+    for (unsigned int index = snapshots.size(); index-- > 0; ) {
+        ref<Snapshot> snapshot = snapshots[index];
+        if (snapshot.isNull()) {
+            continue;
+        }
+
+        bool isLive = false;
+        for (std::set<Function *>::iterator i = users.begin(); i != users.end(); i++) {
+            if (mayDependOn(*i, snapshot->f)) {
+                isLive = true;
+                break;
+            }
+        }
+
+        if (isLive) {
+            users.insert(snapshot->f);
+        } else {
+            dead.push_back(index);
+        }
+    }
+
+    for (std::vector<unsigned int>::iterator i = dead.begin(); i != dead.end(); i++) {
+        state.dropSnapshot(*i);
+    }
+
+    return dead.size();
+}
+
+bool Executor::mayDependOn(Function *root, Function *f) {
+    std::pair<Function *, Function *> key = std::make_pair(root, f);
+    std::map<std::pair<Function *, Function *>, bool>::iterator entry = dependencyCache.find(key);
+    if (entry != dependencyCache.end()) {
+        return entry->second;
+    }
+
+    /* the analyses walk the module, which the slicing worker modifies */
+    std::unique_lock<std::mutex> guard = lockModule();
+
+    std::map<Function *, std::set<Function *> >::iterator dependents = dependentFunctions.find(f);
+    if (dependents == dependentFunctions.end()) {
+        dependents = dependentFunctions.insert(std::make_pair(f, std::set<Function *>())).first;
+        mra->getDependentFunctions(f, dependents->second);
+    }
+
+    std::map<Function *, std::set<Function *> >::iterator reachable = reachableFunctions.find(root);
+    if (reachable == reachableFunctions.end()) {
+        reachable = reachableFunctions.insert(std::make_pair(root, std::set<Function *>())).first;
+        /* indirect calls are resolved by the points-to analysis, resolving
+           them by type misses the targets of casted function pointers */
+        ra->computeReachableFunctions(root, true, reachable->second);
+    }
+
+    bool result = false;
+    for (std::set<Function *>::iterator i = dependents->second.begin(); i != dependents->second.end(); i++) {
+        if (reachable->second.find(*i) != reachable->second.end()) {
+            result = true;
+            break;
+        }
+    }
+
+    dependencyCache[key] = result;
+    return result;
+}
+
 // JOR
 Executor::RecoveryTimer* Executor::newRecoveryTimer(klee::ref<klee::RecoveryInfo> ri) {
   // should be called after recoveringFunction
@@ -5169,6 +6049,11 @@ static std::string unwrap(const std::string& fname) {
 // JOR
 // JOR: TODO: craft the -keep from scratch using keeper->userWhitelist and keeper->dynamicWhitelist
 void Executor::restartExecutionWithFunction(llvm::Function *f, bool singleTimer) {
+  if (WarmRestart) {
+    keepFunctionInProcess(f, singleTimer);
+    return;
+  }
+
   char** const argv = interpreterOpts.argv;
   // flag for halt
   setHaltExecution(true);
@@ -5231,10 +6116,194 @@ void Executor::restartExecutionWithFunction(llvm::Function *f, bool singleTimer)
   // exit(0);
 }
 
+/* warm restart: the module, the static analyses and the solver are kept as
+ * they are, we only stop skipping f. States which already skipped f keep
+ * their snapshots, so their pending and future recoveries remain sound. */
+void Executor::keepFunctionInProcess(llvm::Function *f, bool singleTimer) {
+  if (!keeper->keepFunction(f)) {
+    /* already kept, e.g. a timer of an older recovery */
+    return;
+  }
+
+  if (singleTimer)
+    klee_message("recovery of '%s' timed out, keeping it from now on", f->getName().str().c_str());
+  else
+    klee_message("cumulative recoveries of '%s' timed out, keeping it from now on", f->getName().str().c_str());
+
+  ++stats::warmRestarts;
+  onFunctionKept(f);
+}
+
+/* the recoveries of a function which is now kept are not waited for: each
+ * state blocked on such a recovery is terminated along with its dependent
+ * states, and the call is executed again from the snapshot, which is now done
+ * in-process. The paths which already passed the call are explored again. */
+void Executor::abortRecoveries(llvm::Function *f) {
+  std::vector<ExecutionState *> recoveryStates;
+  for (std::set<ExecutionState *>::iterator i = states.begin(); i != states.end(); i++) {
+    ExecutionState *es = *i;
+    if (es->isRecoveryState() && !(es->isNormalState() && es->isSuspended())) {
+      recoveryStates.push_back(es);
+    }
+  }
+  for (std::vector<ExecutionState *>::iterator i = addedStates.begin(); i != addedStates.end(); i++) {
+    ExecutionState *es = *i;
+    if (es->isRecoveryState() && !(es->isNormalState() && es->isSuspended())) {
+      recoveryStates.push_back(es);
+    }
+  }
+
+  /* the forked dependent states share the snapshots, so the call is executed
+     again once per snapshot */
+  std::set<Snapshot *> restarted;
+  unsigned int aborted = 0;
+  for (std::vector<ExecutionState *>::iterator i = recoveryStates.begin(); i != recoveryStates.end(); i++) {
+    ExecutionState *recoveryState = *i;
+
+    /* the earliest recovery of f in the chain of dependent states */
+    ref<RecoveryInfo> recoveryInfo;
+    for (ExecutionState *es = recoveryState; es->isRecoveryState(); es = es->getDependentState()) {
+      ref<RecoveryInfo> ri = es->getRecoveryInfo();
+      if (ri->f == f && (recoveryInfo.isNull() || ri->snapshotIndex < recoveryInfo->snapshotIndex)) {
+        recoveryInfo = ri;
+      }
+    }
+    if (recoveryInfo.isNull()) {
+      continue;
+    }
+
+    ExecutionState *originatingState = recoveryState->getOriginatingState();
+    Snapshot *snapshot = recoveryInfo->snapshot.get();
+    if (restarted.insert(snapshot).second) {
+      ExecutionState *state = new ExecutionState(*snapshot->state);
+      state->setResumed();
+      state->setRecoveryState(0);
+      /* the snapshot state keeps only the snapshots which f may depend on,
+         the originating state keeps all the live ones */
+      const std::vector< ref<Snapshot> > &snapshots = originatingState->getSnapshots();
+      state->setSnapshots(std::vector< ref<Snapshot> >(snapshots.begin(),
+                                                       snapshots.begin() + recoveryInfo->snapshotIndex));
+      /* the guiding constraints were cleared in the snapshot state, the path
+         constraints are a sound replacement */
+      if (!state->getSnapshots().empty()) {
+        for (ConstraintManager::const_iterator j = state->constraints.begin(); j != state->constraints.end(); j++) {
+          state->addGuidingConstraint(*j);
+        }
+      }
+      /* execute the call again */
+      state->pc = state->prevPC;
+
+      originatingState->ptreeNode->data = 0;
+      std::pair<PTree::Node*, PTree::Node*> res = processTree->split(originatingState->ptreeNode, state, originatingState);
+      state->ptreeNode = res.first;
+      originatingState->ptreeNode = res.second;
+      addedStates.push_back(state);
+    }
+
+    terminateStateRecursively(*recoveryState);
+    aborted++;
+  }
+
+  if (aborted) {
+    klee_message("aborted %u recoveries of '%s', executing the call again (%zu states)",
+                 aborted, f->getName().str().c_str(), restarted.size());
+  }
+}
+
+void Executor::tuneKeptFunctions() {
+  /* the early measurements are dominated by the start-up (e.g., the first
+     slices and the solver caches are cold) */
+  double elapsed = util::getWallTime() - keeperTuneStartTime;
+  if (elapsed < KeeperTuneWarmup)
+    return;
+
+  std::vector<Function *> functions;
+  keeper->selectFunctionsToKeep(functions, KeeperTuneMinRecoveries,
+                                elapsed * 1000000., stats::instructions);
+  for (std::vector<Function *>::iterator i = functions.begin(); i != functions.end(); i++) {
+    Function *f = *i;
+    if (!keeper->keepFunction(f))
+      continue;
+
+    klee_message("recovering '%s' is estimated to be more expensive than executing it, keeping it from now on", f->getName().str().c_str());
+    ++stats::costModelKeeps;
+    onFunctionKept(f);
+  }
+}
+
+void Executor::onFunctionKept(Function *f) {
+  if (mra && keptTargets.insert(f).second)
+    pendingKeptTargets.insert(f);
+}
+
+bool Executor::holdsSnapshotOf(ExecutionState &state, Function *f, std::set<Snapshot *> &visited) {
+  const std::vector< ref<Snapshot> > &snapshots = state.getSnapshots();
+  for (unsigned int index = 0; index < snapshots.size(); index++) {
+    ref<Snapshot> snapshot = snapshots[index];
+    if (snapshot.isNull() || !visited.insert(snapshot.get()).second)
+      continue;
+
+    if (snapshot->f == f)
+      return true;
+
+    /* a recovery from the snapshot may recover nested side effects */
+    if (holdsSnapshotOf(*snapshot->state, f, visited))
+      return true;
+  }
+
+  return false;
+}
+
+/* the side effects of a kept function are dropped from the mod-ref analysis
+   (incrementally) once no state may need to recover them */
+void Executor::removeKeptTargets() {
+  bool updated = false;
+  for (std::set<Function *>::iterator i = pendingKeptTargets.begin(); i != pendingKeptTargets.end(); ) {
+    Function *f = *i;
+    std::set<Snapshot *> visited;
+    bool isUsed = false;
+    for (std::set<ExecutionState *>::iterator j = states.begin(); j != states.end(); j++) {
+      if (holdsSnapshotOf(**j, f, visited)) {
+        isUsed = true;
+        break;
+      }
+    }
+
+    if (isUsed) {
+      i++;
+      continue;
+    }
+
+    ModRefAnalysis::InstructionSet affected;
+    {
+      std::unique_lock<std::mutex> guard = lockModule();
+      mra->removeTarget(f, affected);
+      kmodule->updateModRefFlags(mra, affected);
+    }
+    updated = true;
+    DEBUG_WITH_TYPE(DEBUG_BASIC, klee_message("removed '%s' from the mod-ref analysis (%zu instructions affected)",
+                                              f->getName().str().c_str(), affected.size()));
+    pendingKeptTargets.erase(i++);
+  }
+
+  if (updated) {
+    /* invalidate the caches of the snapshot collector */
+    dependentFunctions.clear();
+    dependencyCache.clear();
+  }
+}
+
+void Executor::KeeperTuneTimer::run() {
+  executor->tuneKeptFunctions();
+}
+
 // JOR
 void Executor::RecoveryTimer::run() {
   if(keeper->getRecoveriesCount(f) == nr) {
     // executor->setHaltExecution(true);
     executor->restartExecutionWithFunction(f, true);
+    if (WarmRestart) {
+      executor->abortRecoveries(f);
+    }
   }
 }
@@ -38,6 +38,8 @@
 #include <map>
 #include <set>
 
+#include <sys/types.h>
+
 struct KTest;
 
 namespace llvm {
@@ -77,6 +79,7 @@ namespace klee {
   class SeedInfo;
   class SpecialFunctionHandler;
   struct StackFrame;
+  class StateSwapper;
   class StatsTracker;
   class TimingSolver;
   class TreeStreamWriter;
@@ -93,6 +96,7 @@ class Executor : public Interpreter {
   friend class OwningSearcher;
   friend class WeightedRandomSearcher;
   friend class RandomRecoveryPath;
+  friend class RecoveryCostSearcher;
   friend class SpecialFunctionHandler;
   friend class StatsTracker;
 
@@ -137,6 +141,8 @@ private:
   MemoryManager *memory;
   std::set<ExecutionState*> states;
   StatsTracker *statsTracker;
+  /* writes the memory of cold states to disk at the memory cap */
+  StateSwapper *swapper;
   TreeStreamWriter *pathWriter, *symPathWriter;
   SpecialFunctionHandler *specialFunctionHandler;
   std::vector<TimerInfo*> timers;
@@ -201,6 +207,28 @@ private:
   /// false, it is buggy (it needs to validate its writes).
   bool ivcEnabled;
 
+  /// The index of this worker process (see -threads), 0 in the main
+  /// process.
+  unsigned workerId;
+
+  /// Whether the states were already partitioned between the workers.
+  bool statesPartitioned;
+
+  /// The worker processes forked by the main process.
+  std::vector<pid_t> workers;
+
+  /// The pipes through which the workers send their statistics (the read
+  /// ends in the main process, the write end in a worker).
+  std::vector<int> workerPipes;
+
+  /// The totals of the statistics when the states were partitioned.
+  std::vector<uint64_t> partitionTotals;
+
+  /// The number of recovery states, and of suspended (normal) states, in
+  /// the state set.
+  unsigned numRecoveryStates;
+  unsigned numSuspendedStates;
+
   /// The maximum time to allow for a single core solver query.
   /// (e.g. for a single STP query)
   double coreSolverTimeout;
@@ -227,6 +255,17 @@ private:
   ModRefAnalysis *mra;
   Cloner *cloner;
   SliceGenerator *sliceGenerator;
+  /* slices which were generated in the background and installed */
+  std::set<std::pair<llvm::Function *, uint32_t> > installedSlices;
+  /* caches of the snapshot collector */
+  std::map<llvm::Function *, std::set<llvm::Function *> > dependentFunctions;
+  std::map<llvm::Function *, std::set<llvm::Function *> > reachableFunctions;
+  std::map<std::pair<llvm::Function *, llvm::Function *>, bool> dependencyCache;
+  /* kept functions which are still skipping targets of the mod-ref analysis */
+  std::set<llvm::Function *> keptTargets;
+  std::set<llvm::Function *> pendingKeptTargets;
+  /* when the exploration started (wall time), for the keeper's cost model */
+  double keeperTuneStartTime;
   // BottomUpPass *bottomUp;
 
   unsigned int errorCount;
@@ -361,12 +400,12 @@ private:
   Cell& getArgumentCell(ExecutionState &state,
                         KFunction *kf,
                         unsigned index) {
-    return state.stack.back().locals[kf->getArgRegister(index)];
+    return state.stack.back().getWritableLocal(kf->getArgRegister(index));
   }
 
   Cell& getDestCell(ExecutionState &state,
                     KInstruction *target) {
-    return state.stack.back().locals[target->dest];
+    return state.stack.back().getWritableLocal(target->dest);
   }
 
   void bindLocal(KInstruction *target, 
@@ -458,6 +497,17 @@ private:
   void processTimers(ExecutionState *current,
                      double maxInstTime);
   void checkMemoryUsage();
+  /// Swap out cold states until the given number of bytes is released,
+  /// returns the number of released bytes.
+  uint64_t swapOutStates(uint64_t needed);
+  void swapInState(ExecutionState &state);
+  /// The memory held by a state, excluding its swapped-out objects.
+  StateMemoryUsage getMemoryUsage(ExecutionState &state);
+  TimingSolver *createSolver();
+  bool canPartitionStates();
+  void partitionStates();
+  void waitForWorkers();
+  void sendWorkerStatistics();
   void printDebugInstructions(ExecutionState &state);
   void doDumpStates();
 
@@ -469,7 +519,8 @@ private:
                           std::list<ref<RecoveryInfo> > &result);
   bool getLoadInfo(ExecutionState &state, KInstruction *kinst,
                    uint64_t &loadAddr, uint64_t &loadSize,
-                   ModRefAnalysis::AllocSite &allocSite);
+                   ModRefAnalysis::AllocSite &allocSite, bool &isSymbolic);
+  void applyRecoveredWrites(ExecutionState &state, ref<RecoveryInfo> recoveryInfo);
   void suspendState(ExecutionState &state);
   void resumeState(ExecutionState &state, bool implicitlyCreated);
   void notifyDependentState(ExecutionState &recoveryState);
@@ -506,7 +557,20 @@ private:
   void forkDependentStates(ExecutionState *trueState, ExecutionState *falseState);
   void mergeConstraintsForAll(ExecutionState &recoveryState, ref<Expr> condition);
   llvm::Function *getSlice(llvm::Function *target, uint32_t sliceId, ModRefAnalysis::SideEffectType type);
+  void installSlice(llvm::Function *target, uint32_t sliceId);
+  std::unique_lock<std::mutex> lockModule();
   ExecutionState *createSnapshotState(ExecutionState &state);
+  bool getSharedRecoveredValue(ExecutionState &state, ref<RecoveryInfo> recoveryInfo, ref<Expr> &expr);
+  void shareRecoveredValues(ExecutionState &recoveryState);
+  void batchRecoveryInfos(std::list<ref<RecoveryInfo> > &recoveryInfos);
+  bool shouldRecoverSpeculatively(llvm::Function *f);
+  void makeSpeculative(ref<RecoveryInfo> recoveryInfo);
+  void collectSnapshots();
+  unsigned int collectDeadSnapshots(ExecutionState &state, std::set<llvm::Function *> &roots);
+  bool mayDependOn(llvm::Function *root, llvm::Function *f);
+  void onFunctionKept(llvm::Function *f);
+  bool holdsSnapshotOf(ExecutionState &state, llvm::Function *f, std::set<Snapshot *> &visited);
+  void removeKeptTargets();
 
   // JOR
   class RecoveryTimer : public Executor::Timer {
@@ -523,6 +587,20 @@ private:
     void run();
   };
   RecoveryTimer* newRecoveryTimer(klee::ref<klee::RecoveryInfo> ri);
+  void keepFunctionInProcess(llvm::Function *f, bool singleTimer);
+  void abortRecoveries(llvm::Function *f);
+
+  /* periodically re-evaluates the skipped functions (Keeper's cost model) */
+  class KeeperTuneTimer : public Executor::Timer {
+    Executor *executor;
+
+  public:
+    KeeperTuneTimer(Executor *_executor) : executor(_executor) {}
+    ~KeeperTuneTimer() {}
+
+    void run();
+  };
+  void tuneKeptFunctions();
 
 public:
   Executor(InterpreterOptions &opts, InterpreterHandler *ie);
@@ -15,6 +15,7 @@
 #include "klee/util/BitArray.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/util/ArrayCache.h"
+#include "klee/util/ExprSerialization.h"
 
 #include "ObjectHolder.h"
 #include "MemoryManager.h"
@@ -100,6 +101,7 @@ void MemoryObject::getAllocInfo(std::string &result) const {
 
 ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
+    chargedUsage(0),
     refCount(0),
     object(mo),
     concreteStore(new uint8_t[mo->size]),
@@ -122,6 +124,7 @@ ObjectState::ObjectState(const MemoryObject *mo)
 
 ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
+    chargedUsage(0),
     refCount(0),
     object(mo),
     concreteStore(new uint8_t[mo->size]),
@@ -138,6 +141,7 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
+    chargedUsage(0),
     refCount(0),
     object(os.object),
     concreteStore(new uint8_t[os.size]),
@@ -184,6 +188,93 @@ ArrayCache *ObjectState::getArrayCache() const {
 
 /***/
 
+static void writeBitArray(ExprWriter &writer, BitArray *bits, unsigned size) {
+  writer.writeInt(bits != 0);
+  if (!bits)
+    return;
+
+  std::vector<uint8_t> bytes((size + 7) / 8, 0);
+  for (unsigned i = 0; i < size; i++)
+    if (bits->get(i))
+      bytes[i / 8] |= 1 << (i % 8);
+  if (!bytes.empty())
+    writer.writeBytes(&bytes[0], bytes.size());
+}
+
+static BitArray *readBitArray(ExprReader &reader, unsigned size) {
+  if (!reader.readInt())
+    return 0;
+
+  std::vector<uint8_t> bytes((size + 7) / 8, 0);
+  if (!bytes.empty())
+    reader.readBytes(&bytes[0], bytes.size());
+  BitArray *bits = new BitArray(size);
+  for (unsigned i = 0; i < size; i++)
+    if (bytes[i / 8] & (1 << (i % 8)))
+      bits->set(i);
+  return bits;
+}
+
+void ObjectState::writeContents(ExprWriter &writer) const {
+  assert(hasContents() && "contents were dropped");
+  writer.writeBytes(concreteStore, size);
+  writeBitArray(writer, concreteMask, size);
+  writeBitArray(writer, flushMask, size);
+  writer.writeInt(knownSymbolics != 0);
+  if (knownSymbolics)
+    for (unsigned i = 0; i < size; i++)
+      writer.write(knownSymbolics[i]);
+  writer.write(updates);
+}
+
+void ObjectState::dropContents() {
+  assert(hasContents() && "contents were dropped");
+  delete concreteMask;
+  concreteMask = 0;
+  delete flushMask;
+  flushMask = 0;
+  delete[] knownSymbolics;
+  knownSymbolics = 0;
+  delete[] concreteStore;
+  concreteStore = 0;
+  updates = UpdateList(0, 0);
+}
+
+bool ObjectState::readContents(ExprReader &reader) {
+  assert(!hasContents() && "contents were not dropped");
+  concreteStore = new uint8_t[size];
+  reader.readBytes(concreteStore, size);
+  concreteMask = readBitArray(reader, size);
+  flushMask = readBitArray(reader, size);
+  if (reader.readInt()) {
+    knownSymbolics = new ref<Expr>[size];
+    for (unsigned i = 0; i < size; i++)
+      knownSymbolics[i] = reader.read();
+  }
+  updates = reader.readUpdates();
+  return reader.good();
+}
+
+size_t ObjectState::getContentsUsage() const {
+  size_t usage = 0;
+  if (concreteStore)
+    usage += size;
+  if (concreteMask)
+    usage += (size + 31) / 32 * sizeof(uint32_t);
+  if (flushMask)
+    usage += (size + 31) / 32 * sizeof(uint32_t);
+  if (knownSymbolics)
+    usage += size * sizeof(ref<Expr>);
+  return usage;
+}
+
+size_t ObjectState::getMemoryUsage() const {
+  return sizeof(ObjectState) + getContentsUsage() +
+         updates.getSize() * sizeof(UpdateNode);
+}
+
+/***/
+
 const UpdateList &ObjectState::getUpdates() const {
   // Constant arrays are created lazily.
   if (!updates.root) {
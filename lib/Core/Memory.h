@@ -25,6 +25,8 @@ namespace llvm {
 namespace klee {
 
 class BitArray;
+class ExprReader;
+class ExprWriter;
 class MemoryManager;
 class Solver;
 class ArrayCache;
@@ -151,6 +153,7 @@ class ObjectState {
 private:
   friend class AddressSpace;
   unsigned copyOnWriteOwner; // exclusively for AddressSpace
+  size_t chargedUsage; // exclusively for AddressSpace
 
   friend class ObjectHolder;
   unsigned refCount;
@@ -209,6 +212,33 @@ public:
   void write32(unsigned offset, uint32_t value);
   void write64(unsigned offset, uint64_t value);
 
+  /// Write the contents of the object (the concrete and symbolic bytes and
+  /// the updates) to the writer.
+  void writeContents(ExprWriter &writer) const;
+
+  /// Release the contents of the object, which must not be accessed (or
+  /// copied) until they are read back by readContents().
+  void dropContents();
+
+  /// Read back the contents which were written by writeContents(), returns
+  /// false if the reader failed.
+  bool readContents(ExprReader &reader);
+
+  bool hasContents() const { return concreteStore != 0; }
+
+  /// The expressions of the known symbolic bytes (null if there are none)
+  /// and the updates of the contents.
+  const ref<Expr> *getKnownSymbolics() const { return knownSymbolics; }
+  const UpdateNode *getUpdatesHead() const { return updates.head; }
+
+  /// The memory used by the concrete store, the masks and the known
+  /// symbolics (in bytes), without the expressions and the updates.
+  size_t getContentsUsage() const;
+
+  /// An estimate of the memory used by the object (in bytes), including
+  /// its updates (which are shared with the copies of the object).
+  size_t getMemoryUsage() const;
+
 private:
   const UpdateList &getUpdates() const;
 
@@ -20,6 +20,8 @@
 #include "klee/Internal/Module/KInstruction.h"
 #include "klee/Internal/Module/KModule.h"
 #include "klee/Internal/ADT/DiscretePDF.h"
+#include "klee/Internal/Analysis/Cloner.h"
+#include "klee/Internal/Analysis/Keeper.h"
 #include "klee/Internal/ADT/RNG.h"
 #include "klee/Internal/Support/ModuleUtil.h"
 #include "klee/Internal/System/Time.h"
@@ -195,6 +197,7 @@ WeightedRandomSearcher::WeightedRandomSearcher(WeightType _type)
   case QueryCost:
   case MinDistToUncovered:
   case CoveringNew:
+  case MemoryUsage:
     updateWeights = true;
     break;
   default:
@@ -229,6 +232,10 @@ double WeightedRandomSearcher::getWeight(ExecutionState *es) {
   }
   case QueryCost:
     return (es->queryCost < .1) ? 1. : 1./es->queryCost;
+  case MemoryUsage: {
+    double mbs = (double) es->getMemoryUsage().total() / (1 << 20);
+    return (mbs < 1.) ? 1. : 1./mbs;
+  }
   case CoveringNew:
   case MinDistToUncovered: {
     uint64_t md2u = computeMinDistToUncovered(es->pc,
@@ -823,6 +830,106 @@ bool RandomRecoveryPath::empty() {
   return treeStack.empty() && states.empty();
 }
 
+/* the estimated time (in microseconds) of executing a slice instruction,
+   used for functions which were not recovered yet */
+#define RECOVERY_COST_PER_INSTRUCTION 10
+
+/* cost-model searcher for the recovery states */
+RecoveryCostSearcher::RecoveryCostSearcher(Executor &executor)
+  : executor(executor), states(new DiscretePDF<ExecutionState*>())
+{
+
+}
+
+RecoveryCostSearcher::~RecoveryCostSearcher() {
+  delete states;
+}
+
+ExecutionState &RecoveryCostSearcher::selectState() {
+  return *states->choose(theRNG.getDoubleL());
+}
+
+unsigned int RecoveryCostSearcher::getSliceSize(Function *f, uint32_t sliceId) {
+  std::pair<Function *, uint32_t> key = std::make_pair(f, sliceId);
+  auto i = sliceSizes.find(key);
+  if (i != sliceSizes.end()) {
+    return i->second;
+  }
+
+  {
+    /* the background worker creates and slices the clone under this lock */
+    std::unique_lock<std::mutex> guard = executor.lockModule();
+    Cloner::SliceInfo *sliceInfo = executor.cloner->getSliceInfo(f, sliceId);
+    if (sliceInfo && sliceInfo->isSliced) {
+      unsigned int size = 0;
+      for (Function::iterator bb = sliceInfo->f->begin(); bb != sliceInfo->f->end(); bb++) {
+        size += bb->size();
+      }
+      sliceSizes[key] = size;
+      return size;
+    }
+  }
+
+  /* the slice is not ready yet, so we use the size of the function */
+  unsigned int size = 0;
+  for (Function::iterator bb = f->begin(); bb != f->end(); bb++) {
+    size += bb->size();
+  }
+  return size;
+}
+
+/* the expected time (in microseconds) of the recovery of a state */
+double RecoveryCostSearcher::getRecoveryCost(ExecutionState *es) {
+  ref<RecoveryInfo> ri = es->getRecoveryInfo();
+  Keeper *keeper = executor.keeper;
+
+  int recoveries = keeper->getRecoveriesCount(ri->f);
+  if (recoveries > 0) {
+    /* the current recovery is already accounted in the count */
+    return (double)(keeper->getTotalRecoveryTime(ri->f)) / recoveries;
+  }
+
+  return (double)(getSliceSize(ri->f, ri->sliceId)) * RECOVERY_COST_PER_INSTRUCTION;
+}
+
+/* the expected time (in microseconds) until the originating state resumes: a
+   recovery state may resume a dependent recovery state (suspended on a nested
+   recovery), which then has to complete its own recovery */
+double RecoveryCostSearcher::getCost(ExecutionState *es) {
+  double cost = 0;
+  for (ExecutionState *s = es; s && s->isRecoveryState(); s = s->getDependentState()) {
+    cost += getRecoveryCost(s);
+  }
+  return cost;
+}
+
+void RecoveryCostSearcher::update(
+  ExecutionState *current,
+  const std::vector<ExecutionState *> &addedStates,
+  const std::vector<ExecutionState *> &removedStates
+) {
+  /* the recovery history changes over time, so we update the current state
+     (the splitted searcher passes the current state to all of its searchers,
+     so it might be managed by another one) */
+  if (current && states->inTree(current) &&
+      std::find(removedStates.begin(), removedStates.end(), current) == removedStates.end()) {
+    states->update(current, 1. / std::max(1., getCost(current)));
+  }
+
+  for (auto i = addedStates.begin(); i != addedStates.end(); i++) {
+    ExecutionState *es = *i;
+    states->insert(es, 1. / std::max(1., getCost(es)));
+  }
+
+  for (auto i = removedStates.begin(); i != removedStates.end(); i++) {
+    states->remove(*i);
+  }
+}
+
+bool RecoveryCostSearcher::empty() {
+  return states->empty();
+}
+
 /* optimized splitted searcher */
 OptimizedSplittedSearcher::OptimizedSplittedSearcher(
   Searcher *baseSearcher,
@@ -17,6 +17,7 @@
 #include <set>
 #include <map>
 #include <queue>
+#include <stdint.h>
 
 namespace llvm {
   class BasicBlock;
@@ -78,12 +79,14 @@ namespace klee {
       NURS_Depth,
       NURS_ICnt,
       NURS_CPICnt,
-      NURS_QC
+      NURS_QC,
+      NURS_Mem
     };
 
     enum RecoverySearchType {
       RS_DFS,
       RS_RandomPath,
+      RS_Cost,
     };
   };
 
@@ -137,7 +140,8 @@ namespace klee {
       InstCount,
       CPInstCount,
       MinDistToUncovered,
-      CoveringNew
+      CoveringNew,
+      MemoryUsage
     };
 
   private:
@@ -165,6 +169,7 @@ namespace klee {
       case CPInstCount        : os << "CPInstCount\n"; return;
       case MinDistToUncovered : os << "MinDistToUncovered\n"; return;
       case CoveringNew        : os << "CoveringNew\n"; return;
+      case MemoryUsage        : os << "MemoryUsage\n"; return;
       default                 : os << "<unknown type>\n"; return;
       }
     }
@@ -362,6 +367,41 @@ namespace klee {
 
   };
 
+  /* selects recovery states with a probability which is inversely
+   * proportional to the expected cost of their recovery, estimated from the
+   * recovery history of the skipped function (see Keeper) or from the size
+   * of its slice if it was not recovered yet */
+  class RecoveryCostSearcher : public Searcher {
+    Executor &executor;
+    DiscretePDF<ExecutionState*> *states;
+    /* the number of instructions of each (function, slice id) */
+    std::map<std::pair<llvm::Function *, uint32_t>, unsigned int> sliceSizes;
+
+    unsigned int getSliceSize(llvm::Function *f, uint32_t sliceId);
+
+    double getRecoveryCost(ExecutionState *es);
+
+    double getCost(ExecutionState *es);
+
+  public:
+    RecoveryCostSearcher(Executor &executor);
+
+    ~RecoveryCostSearcher();
+
+    ExecutionState &selectState();
+
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates);
+
+    bool empty();
+
+    void printName(llvm::raw_ostream &os) {
+      os << "RecoveryCostSearcher\n";
+    }
+
+  };
+
   class OptimizedSplittedSearcher : public Searcher {
     Searcher *baseSearcher;
     Searcher *recoverySearcher;
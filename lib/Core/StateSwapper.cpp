@@ -0,0 +1,259 @@
+//===-- StateSwapper.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "StateSwapper.h"
+
+#include "AddressSpace.h"
+#include "CoreStats.h"
+#include "Memory.h"
+
+#include "klee/ExecutionState.h"
+#include "klee/Interpreter.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/util/ExprSerialization.h"
+
+#include "llvm/ADT/StringExtras.h"
+
+#include <fstream>
+#include <set>
+#include <stdint.h>
+#include <stdio.h>
+
+using namespace klee;
+
+namespace {
+  /* finds the expressions and update nodes of the swapped objects which are
+     also held from outside of them: the ones with more references than the
+     objects hold (directly or through their other expressions and update
+     nodes), and everything which is reachable from them */
+  class SharingAnalysis {
+    std::map<const Expr *, unsigned> exprRefs;
+    std::map<const UpdateNode *, unsigned> nodeRefs;
+
+    void count(const Expr *e) {
+      if (exprRefs[e]++)
+        return;
+      for (unsigned i = 0; i < e->getNumKids(); i++)
+        count(e->getKid(i).get());
+      if (const ReadExpr *re = dyn_cast<ReadExpr>(e))
+        count(re->updates.head);
+    }
+
+    void count(const UpdateNode *un) {
+      for (; un; un = un->next) {
+        if (nodeRefs[un]++)
+          return;
+        count(un->index.get());
+        count(un->value.get());
+      }
+    }
+
+    void mark(const Expr *e) {
+      if (!sharedExprs.insert(e).second)
+        return;
+      for (unsigned i = 0; i < e->getNumKids(); i++)
+        mark(e->getKid(i).get());
+      if (const ReadExpr *re = dyn_cast<ReadExpr>(e))
+        mark(re->updates.head);
+    }
+
+    void mark(const UpdateNode *un) {
+      for (; un; un = un->next) {
+        if (!sharedNodes.insert(un).second)
+          return;
+        mark(un->index.get());
+        mark(un->value.get());
+      }
+    }
+
+  public:
+    std::set<const Expr *> sharedExprs;
+    std::set<const UpdateNode *> sharedNodes;
+
+    void add(const ObjectState *os) {
+      if (const ref<Expr> *knownSymbolics = os->getKnownSymbolics()) {
+        for (unsigned i = 0; i < os->size; i++) {
+          if (!knownSymbolics[i].isNull()) {
+            count(knownSymbolics[i].get());
+          }
+        }
+      }
+      count(os->getUpdatesHead());
+    }
+
+    void run() {
+      for (std::map<const Expr *, unsigned>::iterator i = exprRefs.begin(); i != exprRefs.end(); i++) {
+        if (i->first->refCount > i->second) {
+          mark(i->first);
+        }
+      }
+      for (std::map<const UpdateNode *, unsigned>::iterator i = nodeRefs.begin(); i != nodeRefs.end(); i++) {
+        if (i->first->getRefCount() > i->second) {
+          mark(i->first);
+        }
+      }
+    }
+
+    /* the memory of the expressions and update nodes which are released */
+    size_t getReleasedUsage() const {
+      /* a typical expression node */
+      return (exprRefs.size() - sharedExprs.size()) * sizeof(BinaryExpr) +
+             (nodeRefs.size() - sharedNodes.size()) * sizeof(UpdateNode);
+    }
+  };
+
+  /* the swap files are read back by the same process, so the arrays (which
+     are owned by the array cache) are written as pointers, and the shared
+     expressions and update nodes as indices into the tables of the swapped
+     state */
+  class SwapWriter : public ExprWriter {
+    const SharingAnalysis &sharing;
+    std::vector< ref<Expr> > &sharedExprs;
+    std::vector<UpdateList> &sharedNodes;
+
+  protected:
+    void writeArrayDecl(const Array *array) {
+      writeInt((uintptr_t) array);
+    }
+
+    bool isShared(const Expr *e) {
+      return sharing.sharedExprs.find(e) != sharing.sharedExprs.end();
+    }
+
+    bool isShared(const UpdateNode *un) {
+      return sharing.sharedNodes.find(un) != sharing.sharedNodes.end();
+    }
+
+    void writeShared(const ref<Expr> &e) {
+      writeInt(sharedExprs.size());
+      sharedExprs.push_back(e);
+    }
+
+    void writeShared(const UpdateNode *un) {
+      writeInt(sharedNodes.size());
+      sharedNodes.push_back(UpdateList(0, un));
+    }
+
+  public:
+    SwapWriter(std::ostream &os, const SharingAnalysis &_sharing,
+               std::vector< ref<Expr> > &_sharedExprs,
+               std::vector<UpdateList> &_sharedNodes)
+      : ExprWriter(os), sharing(_sharing), sharedExprs(_sharedExprs),
+        sharedNodes(_sharedNodes) {}
+  };
+
+  class SwapReader : public ExprReader {
+    const std::vector< ref<Expr> > &sharedExprs;
+    const std::vector<UpdateList> &sharedNodes;
+
+  protected:
+    const Array *readArrayDecl() {
+      return (const Array *) (uintptr_t) readInt();
+    }
+
+    ref<Expr> readSharedExpr() {
+      uint64_t id = readInt();
+      if (!good() || id >= sharedExprs.size())
+        return 0;
+      return sharedExprs[id];
+    }
+
+    const UpdateNode *readSharedNode() {
+      uint64_t id = readInt();
+      if (!good() || id >= sharedNodes.size())
+        return 0;
+      return sharedNodes[id].head;
+    }
+
+  public:
+    SwapReader(std::istream &is, const std::vector< ref<Expr> > &_sharedExprs,
+               const std::vector<UpdateList> &_sharedNodes)
+      : ExprReader(is, 0), sharedExprs(_sharedExprs),
+        sharedNodes(_sharedNodes) {}
+  };
+}
+
+StateSwapper::StateSwapper(InterpreterHandler *_handler)
+  : handler(_handler), nextId(0) {}
+
+StateSwapper::~StateSwapper() {
+  for (std::map<ExecutionState *, SwappedState>::iterator i = swapped.begin(); i != swapped.end(); i++) {
+    remove(i->second.path.c_str());
+  }
+}
+
+size_t StateSwapper::swapOut(ExecutionState &state) {
+  assert(!isSwapped(state));
+
+  SwappedState swappedState;
+  state.addressSpace.getOwnedObjects(swappedState.objects);
+  if (swappedState.objects.empty()) {
+    return 0;
+  }
+
+  SharingAnalysis sharing;
+  for (std::vector<ObjectState *>::iterator i = swappedState.objects.begin(); i != swappedState.objects.end(); i++) {
+    sharing.add(*i);
+  }
+  sharing.run();
+
+  swappedState.path = handler->getOutputFilename("state" + llvm::utostr(++nextId) + ".swap");
+  std::ofstream os(swappedState.path.c_str(), std::ios::binary | std::ios::trunc);
+  SwapWriter writer(os, sharing, swappedState.sharedExprs, swappedState.sharedNodes);
+  for (std::vector<ObjectState *>::iterator i = swappedState.objects.begin(); i != swappedState.objects.end(); i++) {
+    (*i)->writeContents(writer);
+  }
+  os.close();
+  if (!os) {
+    klee_warning("unable to write swap file: %s", swappedState.path.c_str());
+    remove(swappedState.path.c_str());
+    return 0;
+  }
+
+  size_t size = sharing.getReleasedUsage();
+  for (std::vector<ObjectState *>::iterator i = swappedState.objects.begin(); i != swappedState.objects.end(); i++) {
+    size += (*i)->getContentsUsage();
+    (*i)->dropContents();
+  }
+  swapped[&state] = swappedState;
+  ++stats::statesSwappedOut;
+  return size;
+}
+
+void StateSwapper::swapIn(ExecutionState &state) {
+  std::map<ExecutionState *, SwappedState>::iterator it = swapped.find(&state);
+  if (it == swapped.end()) {
+    return;
+  }
+
+  SwappedState &swappedState = it->second;
+  std::ifstream is(swappedState.path.c_str(), std::ios::binary);
+  SwapReader reader(is, swappedState.sharedExprs, swappedState.sharedNodes);
+  for (std::vector<ObjectState *>::iterator i = swappedState.objects.begin(); i != swappedState.objects.end(); i++) {
+    if (!(*i)->readContents(reader)) {
+      klee_error("unable to read swap file: %s", swappedState.path.c_str());
+    }
+  }
+  is.close();
+
+  remove(swappedState.path.c_str());
+  swapped.erase(it);
+  ++stats::statesSwappedIn;
+}
+
+void StateSwapper::discard(ExecutionState &state) {
+  std::map<ExecutionState *, SwappedState>::iterator it = swapped.find(&state);
+  if (it == swapped.end()) {
+    return;
+  }
+
+  /* the objects without contents are released with the address space */
+  remove(it->second.path.c_str());
+  swapped.erase(it);
+}
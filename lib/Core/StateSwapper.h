@@ -0,0 +1,76 @@
+//===-- StateSwapper.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_STATESWAPPER_H
+#define KLEE_STATESWAPPER_H
+
+#include "klee/Expr.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace klee {
+  class ExecutionState;
+  class InterpreterHandler;
+  class ObjectState;
+
+  /* Writes the memory of cold states to disk (one file per state in the
+     output directory), so they do not have to be terminated at the memory
+     cap. Only the objects which are owned by the address space of a state
+     are written: the objects which are shared with other states (or with
+     snapshots) would not free any memory. The rest of the state (stack,
+     constraints, snapshots and recovery information) stays in memory, as it
+     is either small or shared with the recovery states.
+
+     The expressions and update nodes which are also held outside of the
+     written objects (by other states, by the constraints or by the caches)
+     would not be released either, so they stay in memory as well: they are
+     written as references into a table of the swapped state, and read back
+     as the same expressions, which keeps them shared with their other
+     holders.
+
+     A swapped state must be swapped in before its address space is accessed
+     or copied, and discarded when it is terminated. */
+  class StateSwapper {
+  public:
+    StateSwapper(InterpreterHandler *handler);
+    ~StateSwapper();
+
+    /* returns an estimate of the number of bytes which were released (0 if
+       the state was not swapped out) */
+    size_t swapOut(ExecutionState &state);
+
+    void swapIn(ExecutionState &state);
+
+    /* drops the swapped memory of a terminated state */
+    void discard(ExecutionState &state);
+
+    bool isSwapped(ExecutionState &state) const {
+      return swapped.find(&state) != swapped.end();
+    }
+
+    bool empty() const { return swapped.empty(); }
+
+  private:
+    struct SwappedState {
+      std::string path;
+      std::vector<ObjectState *> objects;
+      /* the expressions and update nodes which were written as references */
+      std::vector< ref<Expr> > sharedExprs;
+      std::vector<UpdateList> sharedNodes;
+    };
+
+    InterpreterHandler *handler;
+    std::map<ExecutionState *, SwappedState> swapped;
+    unsigned nextId;
+  };
+}
+
+#endif
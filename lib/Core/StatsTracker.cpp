@@ -281,6 +281,9 @@ void StatsTracker::done() {
   if (statsFile)
     writeStatsLine();
 
+  if (OutputStats && executor.keeper && executor.keeper->isSkipping())
+    writeChopperStats();
+
   if (OutputIStats) {
     if (updateMinDistToUncovered)
       computeReachableUncovered();
@@ -288,6 +291,29 @@ void StatsTracker::done() {
   }
 }
 
+void StatsTracker::flush() {
+  if (statsFile)
+    statsFile->flush();
+  if (istatsFile)
+    istatsFile->flush();
+}
+
+void StatsTracker::reopenFiles() {
+  if (statsFile) {
+    delete statsFile;
+    statsFile = executor.interpreterHandler->openOutputFile("run.stats");
+    assert(statsFile && "unable to open statistics trace file");
+    writeStatsHeader();
+    writeStatsLine();
+  }
+
+  if (istatsFile) {
+    delete istatsFile;
+    istatsFile = executor.interpreterHandler->openOutputFile("run.istats");
+    assert(istatsFile && "unable to open istats file");
+  }
+}
+
 void StatsTracker::stepInstruction(ExecutionState &es) {
   if (OutputIStats) {
     if (TrackInstructionTime) {
@@ -424,6 +450,17 @@ void StatsTracker::writeStatsHeader() {
              << "'CexCacheTime',"
              << "'ForkTime',"
              << "'ResolveTime',"
+             << "'SnapshotsCollected',"
+             << "'SnapshotMemoryReclaimed',"
+             << "'SnapshotsTaken',"
+             << "'RecoveriesStarted',"
+             << "'RecoveryCacheHits',"
+             << "'SlicesGenerated',"
+             << "'SlicingTime',"
+             << "'RecoveryTime',"
+             << "'NumSuspendedStates',"
+             << "'StateMemory',"
+             << "'SnapshotMemory',"
 #ifdef DEBUG
 	     << "'ArrayHashTime',"
 #endif
@@ -436,6 +473,9 @@ double StatsTracker::elapsed() {
 }
 
 void StatsTracker::writeStatsLine() {
+  uint64_t stateUsage, snapshotUsage;
+  getStateMemoryUsage(stateUsage, snapshotUsage);
+
   *statsFile << "(" << stats::instructions
              << "," << fullBranches
              << "," << partialBranches
@@ -454,6 +494,17 @@ void StatsTracker::writeStatsLine() {
              << "," << stats::cexCacheTime / 1000000.
              << "," << stats::forkTime / 1000000.
              << "," << stats::resolveTime / 1000000.
+             << "," << stats::snapshotsCollected
+             << "," << stats::snapshotMemoryReclaimed
+             << "," << stats::snapshotsTaken
+             << "," << stats::recoveriesStarted
+             << "," << stats::recoveryCacheHits
+             << "," << stats::slicesGenerated
+             << "," << stats::slicingTime / 1000000.
+             << "," << stats::recoveryTime / 1000000.
+             << "," << getSuspendedStatesCount()
+             << "," << stateUsage
+             << "," << snapshotUsage
 #ifdef DEBUG
              //<< "," << stats::arrayHashTime / 1000000.
 #endif
@@ -461,6 +512,51 @@ void StatsTracker::writeStatsLine() {
   statsFile->flush();
 }
 
+unsigned StatsTracker::getSuspendedStatesCount() {
+  unsigned count = 0;
+  for (std::set<ExecutionState*>::iterator it = executor.states.begin(),
+         ie = executor.states.end(); it != ie; ++it) {
+    ExecutionState &state = **it;
+    if (state.isNormalState() && state.isSuspended())
+      count++;
+  }
+  return count;
+}
+
+/* the snapshots are shared between states, so they are counted once (in
+   both totals) */
+void StatsTracker::getStateMemoryUsage(uint64_t &stateUsage,
+                                       uint64_t &snapshotUsage) {
+  std::set<Snapshot*> snapshots;
+  stateUsage = snapshotUsage = 0;
+  for (std::set<ExecutionState*>::iterator it = executor.states.begin(),
+         ie = executor.states.end(); it != ie; ++it) {
+    ExecutionState &state = **it;
+    StateMemoryUsage usage = executor.getMemoryUsage(state);
+    stateUsage += usage.total() - usage.snapshots;
+    if (!state.isNormalState())
+      continue;
+
+    const std::vector< ref<Snapshot> > &stateSnapshots = state.getSnapshots();
+    for (std::vector< ref<Snapshot> >::const_iterator
+           si = stateSnapshots.begin(), se = stateSnapshots.end();
+         si != se; ++si) {
+      if (!si->isNull() && snapshots.insert(si->get()).second)
+        snapshotUsage += (*si)->getMemoryUsage();
+    }
+  }
+  stateUsage += snapshotUsage;
+}
+
+void StatsTracker::writeChopperStats() {
+  llvm::raw_fd_ostream *chopperStatsFile =
+    executor.interpreterHandler->openOutputFile("chopper.stats");
+  if (!chopperStatsFile)
+    return;
+  executor.keeper->writeStats(*chopperStatsFile);
+  delete chopperStatsFile;
+}
+
 void StatsTracker::updateStateStatistics(uint64_t addend) {
   for (std::set<ExecutionState*>::iterator it = executor.states.begin(),
          ie = executor.states.end(); it != ie; ++it) {
@@ -473,6 +569,8 @@ void StatsTracker::updateStateStatistics(uint64_t addend) {
 }
 
 void StatsTracker::writeIStats() {
+  /* the module might be modified by the background slicing thread */
+  std::unique_lock<std::mutex> guard = executor.lockModule();
   Module *m = executor.kmodule->module;
   uint64_t istatsMask = 0;
   llvm::raw_fd_ostream &of = *istatsFile;
@@ -669,6 +767,7 @@ uint64_t klee::computeMinDistToUncovered(const KInstruction *ki,
 }
 
 void StatsTracker::computeReachableUncovered() {
+  std::unique_lock<std::mutex> guard = executor.lockModule();
   KModule *km = executor.kmodule;
   Module *m = km->module;
   static bool init = true;
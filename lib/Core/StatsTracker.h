@@ -55,6 +55,9 @@ namespace klee {
     void writeStatsHeader();
     void writeStatsLine();
     void writeIStats();
+    void writeChopperStats();
+    unsigned getSuspendedStatesCount();
+    void getStateMemoryUsage(uint64_t &stateUsage, uint64_t &snapshotUsage);
 
   public:
     StatsTracker(Executor &_executor, std::string _objectFilename,
@@ -77,6 +80,12 @@ namespace klee {
     // called when execution is done and stats files should be flushed
     void done();
 
+    // called before forking a worker process
+    void flush();
+
+    // called in a forked worker process, after the output directory changed
+    void reopenFiles();
+
     // process stats for a single instruction step, es is the state
     // about to be stepped
     void stepInstruction(ExecutionState &es);
@@ -31,6 +31,7 @@ namespace {
 			clEnumValN(Searcher::NURS_ICnt, "nurs:icnt", "use NURS with Instr-Count"),
 			clEnumValN(Searcher::NURS_CPICnt, "nurs:cpicnt", "use NURS with CallPath-Instr-Count"),
 			clEnumValN(Searcher::NURS_QC, "nurs:qc", "use NURS with Query-Cost"),
+			clEnumValN(Searcher::NURS_Mem, "nurs:mem", "use NURS with Memory-Usage (prefer the states which hold less memory)"),
 			clEnumValEnd));
 
   cl::opt<bool>
@@ -69,6 +70,7 @@ namespace {
 	  cl::values(
       clEnumValN(Searcher::RS_DFS, "dfs", "use depth first search"),
       clEnumValN(Searcher::RS_RandomPath, "random-path", "use random path selection"),
+      clEnumValN(Searcher::RS_Cost, "cost", "prefer the recovery states with the lowest expected cost"),
       clEnumValEnd
     )
   );
@@ -102,6 +104,7 @@ Searcher *getNewSearcher(Searcher::CoreSearchType type, Executor &executor) {
   case Searcher::NURS_ICnt: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::InstCount); break;
   case Searcher::NURS_CPICnt: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::CPInstCount); break;
   case Searcher::NURS_QC: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::QueryCost); break;
+  case Searcher::NURS_Mem: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::MemoryUsage); break;
   }
 
   return searcher;
@@ -155,6 +158,7 @@ Searcher *klee::constructUserSearcher(Executor &executor) {
 
   if (!RecoverySearch.empty()) {
     Searcher *recoverySearcher = NULL;
+    Searcher *lowPrioritySearcher = NULL;
     switch (RecoverySearch[0]) {
     case Searcher::RS_DFS:
         recoverySearcher = new DFSSearcher();
@@ -163,14 +167,24 @@ Searcher *klee::constructUserSearcher(Executor &executor) {
     case Searcher::RS_RandomPath:
         recoverySearcher = new RandomRecoveryPath(executor);
         break;
+
+    case Searcher::RS_Cost:
+        recoverySearcher = new RecoveryCostSearcher(executor);
+        /* the low priority recovery states belong to different recoveries */
+        lowPrioritySearcher = new RecoveryCostSearcher(executor);
+        break;
     }
 
     if (recoverySearcher == NULL) {
       klee_error("invalid recovery search heuristic");
     }
 
+    if (lowPrioritySearcher == NULL) {
+      lowPrioritySearcher = new DFSSearcher();
+    }
+
     searcher = new OptimizedSplittedSearcher(searcher,
-                                             new DFSSearcher(),
+                                             lowPrioritySearcher,
                                              recoverySearcher,
                                              SplitRatio);
   }
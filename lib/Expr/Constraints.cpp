@@ -10,16 +10,21 @@
 #include "klee/Constraints.h"
 
 #include "klee/util/ExprPPrinter.h"
+#include "klee/util/ExprUtil.h"
 #include "klee/util/ExprVisitor.h"
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
 #include "llvm/IR/Function.h"
 #else
 #include "llvm/Function.h"
 #endif
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/CommandLine.h"
 #include "klee/Internal/Module/KModule.h"
 
+#include <algorithm>
 #include <map>
+#include <set>
 
 using namespace klee;
 
@@ -57,15 +62,15 @@ public:
 
 class ExprReplaceVisitor2 : public ExprVisitor {
 private:
-  const std::map< ref<Expr>, ref<Expr> > &replacements;
+  const EqualityIndex::substitutions_ty &replacements;
 
 public:
-  ExprReplaceVisitor2(const std::map< ref<Expr>, ref<Expr> > &_replacements) 
+  ExprReplaceVisitor2(const EqualityIndex::substitutions_ty &_replacements) 
     : ExprVisitor(true),
       replacements(_replacements) {}
 
   Action visitExprPost(const Expr &e) {
-    std::map< ref<Expr>, ref<Expr> >::const_iterator it =
+    EqualityIndex::substitutions_ty::const_iterator it =
       replacements.find(ref<Expr>(const_cast<Expr*>(&e)));
     if (it!=replacements.end()) {
       return Action::changeTo(it->second);
@@ -75,25 +80,266 @@ public:
   }
 };
 
-bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
-  ConstraintManager::constraints_ty old;
-  bool changed = false;
+static uint64_t countNodes(ref<Expr> e) {
+  llvm::SmallPtrSet<const Expr *, 32> visited;
+  llvm::SmallVector<const Expr *, 32> stack(1, e.get());
+  while (!stack.empty()) {
+    const Expr *ep = stack.pop_back_val();
+    if (visited.count(ep))
+      continue;
+    visited.insert(ep);
+    for (unsigned i = 0; i < ep->getNumKids(); i++)
+      stack.push_back(ep->getKid(i).get());
+  }
+  return visited.size();
+}
+
+/***/
+
+const unsigned IndependenceIndex::WholeArray;
+
+void IndependenceIndex::getElements(ref<Expr> e,
+                                    std::vector<Element> &result) {
+  std::vector< ref<ReadExpr> > reads;
+  findReads(e, /* visitUpdates= */ true, reads);
+  for (unsigned i = 0; i != reads.size(); ++i) {
+    ReadExpr *re = reads[i].get();
+    const Array *array = re->updates.root;
+
+    // Reads of a constant array don't alias.
+    if (array->isConstantArray() && !re->updates.head)
+      continue;
+
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index)) {
+      result.push_back(Element(array, (unsigned) CE->getZExtValue(32)));
+    } else {
+      result.push_back(Element(array, WholeArray));
+    }
+  }
+
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+unsigned IndependenceIndex::find(unsigned id) const {
+  while (parent[id] != id)
+    id = parent[id];
+  return id;
+}
+
+void IndependenceIndex::merge(unsigned a, unsigned b) {
+  a = find(a);
+  b = find(b);
+  if (a == b)
+    return;
+
+  // union by size, the members of the smaller cluster are moved
+  if (members[a].size() < members[b].size())
+    std::swap(a, b);
+  parent[b] = a;
+  members[a].insert(members[a].end(), members[b].begin(), members[b].end());
+  std::vector<unsigned>().swap(members[b]);
+}
+
+void IndependenceIndex::add(const std::vector<Element> &_elements) {
+  unsigned id = parent.size();
+  parent.push_back(id);
+  members.push_back(std::vector<unsigned>(1, id));
+  elements.push_back(_elements);
+
+  for (std::vector<Element>::const_iterator it = _elements.begin(),
+         ie = _elements.end(); it != ie; ++it) {
+    const Array *array = it->first;
+    std::map<const Array *, unsigned>::iterator wit = wholeReaders.find(array);
+    if (wit != wholeReaders.end()) {
+      merge(id, wit->second);
+      continue;
+    }
+
+    if (it->second == WholeArray) {
+      // the array is read at a symbolic index, so this constraint depends on
+      // all the constraints which read any of its bytes
+      wholeReaders.insert(std::make_pair(array, id));
+      std::map<Element, unsigned>::iterator bit =
+        byteReaders.lower_bound(Element(array, 0));
+      while (bit != byteReaders.end() && bit->first.first == array) {
+        merge(id, bit->second);
+        byteReaders.erase(bit++);
+      }
+    } else {
+      std::pair<std::map<Element, unsigned>::iterator, bool> res =
+        byteReaders.insert(std::make_pair(*it, id));
+      if (!res.second)
+        merge(id, res.first->second);
+    }
+  }
+}
+
+void IndependenceIndex::getClusters(const std::vector<Element> &_elements,
+                                    std::vector<unsigned> &result) const {
+  std::set<unsigned> roots;
+  for (std::vector<Element>::const_iterator it = _elements.begin(),
+         ie = _elements.end(); it != ie; ++it) {
+    const Array *array = it->first;
+    std::map<const Array *, unsigned>::const_iterator wit =
+      wholeReaders.find(array);
+    if (wit != wholeReaders.end()) {
+      roots.insert(find(wit->second));
+    } else if (it->second == WholeArray) {
+      std::map<Element, unsigned>::const_iterator bit =
+        byteReaders.lower_bound(Element(array, 0));
+      for (; bit != byteReaders.end() && bit->first.first == array; ++bit)
+        roots.insert(find(bit->second));
+    } else {
+      std::map<Element, unsigned>::const_iterator bit = byteReaders.find(*it);
+      if (bit != byteReaders.end())
+        roots.insert(find(bit->second));
+    }
+  }
+
+  for (std::set<unsigned>::iterator it = roots.begin(), ie = roots.end();
+       it != ie; ++it)
+    result.insert(result.end(), members[*it].begin(), members[*it].end());
+  std::sort(result.begin(), result.end());
+}
+
+size_t IndependenceIndex::getMemoryUsage() const {
+  // the nodes of a map hold three pointers and a color besides the value
+  static const size_t mapNode = 4 * sizeof(void *);
+
+  size_t usage = parent.capacity() * sizeof(unsigned);
+  usage += members.capacity() * sizeof(std::vector<unsigned>);
+  for (unsigned i = 0; i != members.size(); ++i)
+    usage += members[i].capacity() * sizeof(unsigned);
+  usage += elements.capacity() * sizeof(std::vector<Element>);
+  for (unsigned i = 0; i != elements.size(); ++i)
+    usage += elements[i].capacity() * sizeof(Element);
+  usage += byteReaders.size() *
+    (mapNode + sizeof(std::map<Element, unsigned>::value_type));
+  usage += wholeReaders.size() *
+    (mapNode + sizeof(std::map<const Array *, unsigned>::value_type));
+  return usage;
+}
 
-  constraints.swap(old);
-  for (ConstraintManager::constraints_ty::iterator 
-         it = old.begin(), ie = old.end(); it != ie; ++it) {
-    ref<Expr> &ce = *it;
+/***/
+
+bool EqualityIndex::add(ref<Expr> constraint) {
+  numConstraints++;
+  if (const EqExpr *ee = dyn_cast<EqExpr>(constraint)) {
+    if (isa<ConstantExpr>(ee->left))
+      return substitutions.insert(std::make_pair(ee->right, ee->left)).second;
+  }
+  return substitutions.insert(std::make_pair(constraint,
+                                             ConstantExpr::alloc(1, Expr::Bool))).second;
+}
+
+/***/
+
+// bound on the memoized results of simplifyExpr()
+static const unsigned MaxSimplified = 4096;
+
+void ConstraintManager::pushConstraint(ref<Expr> e,
+                                       const std::vector<IndependenceIndex::Element> *elements) {
+  constraints.mutate().push_back(e);
+
+  // keep the indices up to date only if they cover all the constraints
+  if (index->size() + 1 == constraints->size()) {
+    if (elements) {
+      index.mutate().add(*elements);
+    } else {
+      std::vector<IndependenceIndex::Element> computed;
+      IndependenceIndex::getElements(e, computed);
+      index.mutate().add(computed);
+    }
+  }
+
+  if (equalities->size() + 1 == constraints->size()) {
+    if (equalities.mutate().add(e))
+      simplified.clear();
+  }
+}
+
+const IndependenceIndex &ConstraintManager::getIndex() const {
+  if (index->size() < constraints->size()) {
+    IndependenceIndex &ix = index.mutate();
+    for (unsigned i = ix.size(); i < constraints->size(); i++) {
+      std::vector<IndependenceIndex::Element> elements;
+      IndependenceIndex::getElements(constraints.get()[i], elements);
+      ix.add(elements);
+    }
+  }
+  return index.get();
+}
+
+const EqualityIndex &ConstraintManager::getEqualities() const {
+  if (equalities->size() < constraints->size()) {
+    EqualityIndex &eqs = equalities.mutate();
+    for (unsigned i = eqs.size(); i < constraints->size(); i++)
+      eqs.add(constraints.get()[i]);
+    simplified.clear();
+  }
+  return equalities.get();
+}
+
+bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor,
+                                           ref<Expr> src) {
+  // a constraint which contains src reads the elements of src, so only the
+  // clusters of src are visited (all the constraints if src reads nothing)
+  std::vector<IndependenceIndex::Element> elements;
+  IndependenceIndex::getElements(src, elements);
+  std::vector<unsigned> candidates;
+  if (elements.empty()) {
+    for (unsigned i = 0; i < constraints->size(); i++)
+      candidates.push_back(i);
+  } else {
+    getIndex().getClusters(elements, candidates);
+  }
+
+  std::map<unsigned, ref<Expr> > rewritten;
+  for (std::vector<unsigned>::iterator it = candidates.begin(),
+         ie = candidates.end(); it != ie; ++it) {
+    const ref<Expr> &ce = constraints.get()[*it];
     ref<Expr> e = visitor.visit(ce);
+    if (e != ce)
+      rewritten.insert(std::make_pair(*it, e));
+  }
+
+  if (rewritten.empty())
+    return false;
+
+  // the constraints are added again, the elements of the unchanged ones are
+  // reused by the independence index, and their nodes stay counted
+  ConstraintManager::constraints_ty old;
+  CopyOnWrite<IndependenceIndex> oldIndex = index;
+  index = IndependenceIndex();
+  equalities = EqualityIndex();
+  simplified.clear();
 
-    if (e!=ce) {
-      addConstraintInternal(e); // enable further reductions
-      changed = true;
+  constraints.mutate().swap(old);
+  for (unsigned i = 0; i < old.size(); i++) {
+    std::map<unsigned, ref<Expr> >::iterator it = rewritten.find(i);
+    if (it != rewritten.end()) {
+      numNodes -= std::min(numNodes, countNodes(old[i]));
+      addConstraintInternal(it->second); // enable further reductions
+    } else if (i < oldIndex->size()) {
+      pushConstraint(old[i], &oldIndex->getElements(i));
     } else {
-      constraints.push_back(ce);
+      pushConstraint(old[i]);
     }
   }
 
-  return changed;
+  return true;
+}
+
+void ConstraintManager::getIndependentConstraints(ref<Expr> e,
+                                                  std::vector< ref<Expr> > &result) const {
+  std::vector<IndependenceIndex::Element> elements;
+  IndependenceIndex::getElements(e, elements);
+  std::vector<unsigned> ids;
+  getIndex().getClusters(elements, ids);
+  for (std::vector<unsigned>::iterator it = ids.begin(), ie = ids.end();
+       it != ie; ++it)
+    result.push_back(constraints.get()[*it]);
 }
 
 void ConstraintManager::simplifyForValidConstraint(ref<Expr> e) {
@@ -104,25 +350,20 @@ ref<Expr> ConstraintManager::simplifyExpr(ref<Expr> e) const {
   if (isa<ConstantExpr>(e))
     return e;
 
-  std::map< ref<Expr>, ref<Expr> > equalities;
-  
-  for (ConstraintManager::constraints_ty::const_iterator 
-         it = constraints.begin(), ie = constraints.end(); it != ie; ++it) {
-    if (const EqExpr *ee = dyn_cast<EqExpr>(*it)) {
-      if (isa<ConstantExpr>(ee->left)) {
-        equalities.insert(std::make_pair(ee->right,
-                                         ee->left));
-      } else {
-        equalities.insert(std::make_pair(*it,
-                                         ConstantExpr::alloc(1, Expr::Bool)));
-      }
-    } else {
-      equalities.insert(std::make_pair(*it,
-                                       ConstantExpr::alloc(1, Expr::Bool)));
-    }
-  }
+  const EqualityIndex::substitutions_ty &substitutions =
+    getEqualities().getSubstitutions();
+  if (substitutions.empty())
+    return e;
+
+  EqualityIndex::substitutions_ty::iterator it = simplified.find(e);
+  if (it != simplified.end())
+    return it->second;
 
-  return ExprReplaceVisitor2(equalities).visit(e);
+  ref<Expr> result = ExprReplaceVisitor2(substitutions).visit(e);
+  if (simplified.size() >= MaxSimplified)
+    simplified.clear();
+  simplified.insert(std::make_pair(e, result));
+  return result;
 }
 
 void ConstraintManager::addConstraintInternal(ref<Expr> e) {
@@ -152,15 +393,17 @@ void ConstraintManager::addConstraintInternal(ref<Expr> e) {
       BinaryExpr *be = cast<BinaryExpr>(e);
       if (isa<ConstantExpr>(be->left)) {
 	ExprReplaceVisitor visitor(be->right, be->left);
-	rewriteConstraints(visitor);
+	rewriteConstraints(visitor, be->right);
       }
     }
-    constraints.push_back(e);
+    pushConstraint(e);
+    numNodes += countNodes(e);
     break;
   }
     
   default:
-    constraints.push_back(e);
+    pushConstraint(e);
+    numNodes += countNodes(e);
     break;
   }
 }
@@ -0,0 +1,494 @@
+//===-- ExprSerialization.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ExprSerialization.h"
+
+#include "klee/util/ArrayCache.h"
+
+#include <stdio.h>
+
+using namespace klee;
+
+namespace {
+  /// Every expression, update node and array is written as one of these
+  /// records (update nodes are written as a chain of new nodes followed by
+  /// a null, back reference or shared record, see ExprWriter::writeNode).
+  enum RecordKind {
+    RecordNull = 0,
+    RecordRef,
+    RecordNew,
+    RecordShared
+  };
+}
+
+/***/
+
+void ExprWriter::writeInt(uint64_t value) {
+  // LEB128
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value)
+      byte |= 0x80;
+    os.put(byte);
+  } while (value);
+}
+
+void ExprWriter::writeString(const std::string &s) {
+  writeInt(s.size());
+  os.write(s.data(), s.size());
+}
+
+void ExprWriter::writeBytes(const void *data, size_t size) {
+  os.write((const char *) data, size);
+}
+
+void ExprWriter::write(const ref<Expr> &e) {
+  if (e.isNull()) {
+    writeInt(RecordNull);
+    return;
+  }
+
+  std::map<const Expr *, unsigned>::iterator it = exprIds.find(e.get());
+  if (it != exprIds.end()) {
+    writeInt(RecordRef);
+    writeInt(it->second);
+    return;
+  }
+
+  if (isShared(e.get())) {
+    writeInt(RecordShared);
+    writeShared(e);
+    unsigned id = exprIds.size();
+    exprIds[e.get()] = id;
+    written.push_back(e);
+    return;
+  }
+
+  writeInt(RecordNew);
+  writeInt(e->getKind());
+  switch (e->getKind()) {
+  case Expr::Constant: {
+    const llvm::APInt &value = cast<ConstantExpr>(e)->getAPValue();
+    const uint64_t *words = value.getRawData();
+    writeInt(value.getBitWidth());
+    writeInt(value.getNumWords());
+    for (unsigned i = 0; i < value.getNumWords(); i++)
+      writeInt(words[i]);
+    break;
+  }
+
+  case Expr::Read: {
+    ReadExpr *re = cast<ReadExpr>(e);
+    write(re->updates);
+    write(re->index);
+    break;
+  }
+
+  case Expr::Extract: {
+    ExtractExpr *ee = cast<ExtractExpr>(e);
+    writeInt(ee->offset);
+    writeInt(ee->width);
+    write(ee->expr);
+    break;
+  }
+
+  case Expr::ZExt:
+  case Expr::SExt:
+    writeInt(e->getWidth());
+    write(e->getKid(0));
+    break;
+
+  default:
+    for (unsigned i = 0; i < e->getNumKids(); i++)
+      write(e->getKid(i));
+    break;
+  }
+
+  // the kids are numbered first, as they are rebuilt first
+  unsigned id = exprIds.size();
+  exprIds[e.get()] = id;
+  written.push_back(e);
+}
+
+void ExprWriter::write(const UpdateList &updates) {
+  write(updates.root);
+  writeNode(updates.head);
+}
+
+/// Update lists can be very long, so the nodes which were not written yet
+/// are written iteratively: their number, the node they extend and then
+/// their contents from the oldest to the most recent.
+void ExprWriter::writeNode(const UpdateNode *un) {
+  std::vector<const UpdateNode *> chain;
+  for (; un && nodeIds.find(un) == nodeIds.end() && !isShared(un);
+       un = un->next)
+    chain.push_back(un);
+
+  if (!chain.empty()) {
+    writeInt(RecordNew);
+    writeInt(chain.size());
+  }
+
+  if (!un) {
+    writeInt(RecordNull);
+  } else if (nodeIds.find(un) != nodeIds.end()) {
+    writeInt(RecordRef);
+    writeInt(nodeIds[un]);
+  } else {
+    writeInt(RecordShared);
+    writeShared(un);
+    unsigned id = nodeIds.size();
+    nodeIds[un] = id;
+  }
+
+  for (std::vector<const UpdateNode *>::reverse_iterator i = chain.rbegin();
+       i != chain.rend(); ++i) {
+    write((*i)->index);
+    write((*i)->value);
+    unsigned id = nodeIds.size();
+    nodeIds[*i] = id;
+  }
+}
+
+void ExprWriter::write(const Array *array) {
+  if (!array) {
+    writeInt(RecordNull);
+    return;
+  }
+
+  std::map<const Array *, unsigned>::iterator it = arrayIds.find(array);
+  if (it != arrayIds.end()) {
+    writeInt(RecordRef);
+    writeInt(it->second);
+    return;
+  }
+
+  writeInt(RecordNew);
+  writeArrayDecl(array);
+  unsigned id = arrayIds.size();
+  arrayIds[array] = id;
+}
+
+void ExprWriter::writeArrayDecl(const Array *array) {
+  writeString(array->name);
+  writeInt(array->size);
+  writeInt(array->domain);
+  writeInt(array->range);
+  writeInt(array->constantValues.size());
+  for (std::vector< ref<ConstantExpr> >::const_iterator
+         i = array->constantValues.begin(), e = array->constantValues.end();
+       i != e; ++i)
+    write(*i);
+}
+
+/***/
+
+uint64_t ExprReader::readInt() {
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    int byte = is.get();
+    if (byte == EOF) {
+      fail();
+      return 0;
+    }
+    value |= (uint64_t) (byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+  fail();
+  return 0;
+}
+
+std::string ExprReader::readString() {
+  uint64_t size = readInt();
+  if (!good())
+    return std::string();
+
+  std::string s(size, 0);
+  readBytes(&s[0], size);
+  return s;
+}
+
+void ExprReader::readBytes(void *data, size_t size) {
+  is.read((char *) data, size);
+  if ((size_t) is.gcount() != size)
+    fail();
+}
+
+ref<Expr> ExprReader::read() {
+  uint64_t record = readInt();
+  if (!good() || record == RecordNull)
+    return 0;
+
+  if (record == RecordRef) {
+    uint64_t id = readInt();
+    if (id >= exprs.size()) {
+      fail();
+      return 0;
+    }
+    return exprs[id];
+  }
+
+  if (record == RecordShared) {
+    ref<Expr> e = readSharedExpr();
+    if (e.isNull()) {
+      fail();
+      return 0;
+    }
+    exprs.push_back(e);
+    return e;
+  }
+
+  if (record != RecordNew) {
+    fail();
+    return 0;
+  }
+
+  ref<Expr> e;
+  switch ((Expr::Kind) readInt()) {
+  case Expr::Constant: {
+    unsigned width = readInt();
+    std::vector<uint64_t> words(readInt());
+    for (unsigned i = 0; i < words.size(); i++)
+      words[i] = readInt();
+    if (!good() || !width || words.size() != (width + 63) / 64) {
+      fail();
+      return 0;
+    }
+    e = ConstantExpr::alloc(llvm::APInt(width, words));
+    break;
+  }
+
+  case Expr::NotOptimized: {
+    ref<Expr> src = read();
+    if (src.isNull())
+      break;
+    e = NotOptimizedExpr::alloc(src);
+    break;
+  }
+
+  case Expr::Read: {
+    UpdateList updates = readUpdates();
+    ref<Expr> index = read();
+    if (!updates.root || index.isNull())
+      break;
+    e = ReadExpr::alloc(updates, index);
+    break;
+  }
+
+  case Expr::Select: {
+    ref<Expr> c = read();
+    ref<Expr> t = read();
+    ref<Expr> f = read();
+    if (c.isNull() || t.isNull() || f.isNull())
+      break;
+    e = SelectExpr::alloc(c, t, f);
+    break;
+  }
+
+  case Expr::Concat: {
+    ref<Expr> l = read();
+    ref<Expr> r = read();
+    if (l.isNull() || r.isNull())
+      break;
+    e = ConcatExpr::alloc(l, r);
+    break;
+  }
+
+  case Expr::Extract: {
+    unsigned offset = readInt();
+    Expr::Width width = readInt();
+    ref<Expr> src = read();
+    if (src.isNull())
+      break;
+    e = ExtractExpr::alloc(src, offset, width);
+    break;
+  }
+
+#define CAST_EXPR_CASE(T)                                                      \
+  case Expr::T: {                                                              \
+    Expr::Width width = readInt();                                             \
+    ref<Expr> src = read();                                                    \
+    if (src.isNull())                                                          \
+      break;                                                                   \
+    e = T##Expr::alloc(src, width);                                            \
+    break;                                                                     \
+  }
+
+#define BINARY_EXPR_CASE(T)                                                    \
+  case Expr::T: {                                                              \
+    ref<Expr> l = read();                                                      \
+    ref<Expr> r = read();                                                      \
+    if (l.isNull() || r.isNull())                                              \
+      break;                                                                   \
+    e = T##Expr::alloc(l, r);                                                  \
+    break;                                                                     \
+  }
+
+  CAST_EXPR_CASE(ZExt)
+  CAST_EXPR_CASE(SExt)
+
+  case Expr::Not: {
+    ref<Expr> src = read();
+    if (src.isNull())
+      break;
+    e = NotExpr::alloc(src);
+    break;
+  }
+
+  BINARY_EXPR_CASE(Add)
+  BINARY_EXPR_CASE(Sub)
+  BINARY_EXPR_CASE(Mul)
+  BINARY_EXPR_CASE(UDiv)
+  BINARY_EXPR_CASE(SDiv)
+  BINARY_EXPR_CASE(URem)
+  BINARY_EXPR_CASE(SRem)
+  BINARY_EXPR_CASE(And)
+  BINARY_EXPR_CASE(Or)
+  BINARY_EXPR_CASE(Xor)
+  BINARY_EXPR_CASE(Shl)
+  BINARY_EXPR_CASE(LShr)
+  BINARY_EXPR_CASE(AShr)
+
+  BINARY_EXPR_CASE(Eq)
+  BINARY_EXPR_CASE(Ne)
+  BINARY_EXPR_CASE(Ult)
+  BINARY_EXPR_CASE(Ule)
+  BINARY_EXPR_CASE(Ugt)
+  BINARY_EXPR_CASE(Uge)
+  BINARY_EXPR_CASE(Slt)
+  BINARY_EXPR_CASE(Sle)
+  BINARY_EXPR_CASE(Sgt)
+  BINARY_EXPR_CASE(Sge)
+
+#undef CAST_EXPR_CASE
+#undef BINARY_EXPR_CASE
+
+  default:
+    break;
+  }
+
+  if (e.isNull()) {
+    fail();
+    return 0;
+  }
+
+  exprs.push_back(e);
+  return e;
+}
+
+UpdateList ExprReader::readUpdates() {
+  const Array *root = readArray();
+  const UpdateNode *head = readNode();
+  return UpdateList(root, head);
+}
+
+const UpdateNode *ExprReader::readNode() {
+  uint64_t record = readInt();
+  if (!good() || record == RecordNull)
+    return 0;
+
+  if (record == RecordRef) {
+    uint64_t id = readInt();
+    if (id >= nodes.size()) {
+      fail();
+      return 0;
+    }
+    return nodes[id];
+  }
+
+  if (record == RecordShared) {
+    const UpdateNode *un = readSharedNode();
+    if (!un) {
+      fail();
+      return 0;
+    }
+    nodes.push_back(un);
+    return un;
+  }
+
+  if (record != RecordNew) {
+    fail();
+    return 0;
+  }
+
+  uint64_t count = readInt();
+  const UpdateNode *un = readNode();
+  for (uint64_t i = 0; i < count && good(); i++) {
+    ref<Expr> index = read();
+    ref<Expr> value = read();
+    if (index.isNull() || value.isNull()) {
+      fail();
+      return 0;
+    }
+    un = new UpdateNode(un, index, value);
+    nodes.push_back(un);
+  }
+  if (!good())
+    return 0;
+
+  // the nodes are owned by update lists, so the chain is held until the
+  // reader is done
+  heads.push_back(UpdateList(0, un));
+  return un;
+}
+
+const Array *ExprReader::readArray() {
+  uint64_t record = readInt();
+  if (!good() || record == RecordNull)
+    return 0;
+
+  if (record == RecordRef) {
+    uint64_t id = readInt();
+    if (id >= arrays.size()) {
+      fail();
+      return 0;
+    }
+    return arrays[id];
+  }
+
+  if (record != RecordNew) {
+    fail();
+    return 0;
+  }
+
+  const Array *array = readArrayDecl();
+  if (!array) {
+    fail();
+    return 0;
+  }
+  arrays.push_back(array);
+  return array;
+}
+
+const Array *ExprReader::readArrayDecl() {
+  std::string name = readString();
+  uint64_t size = readInt();
+  Expr::Width domain = readInt();
+  Expr::Width range = readInt();
+  uint64_t numValues = readInt();
+
+  std::vector< ref<ConstantExpr> > values;
+  for (uint64_t i = 0; i < numValues && good(); i++) {
+    ref<Expr> value = read();
+    if (value.isNull() || !isa<ConstantExpr>(value)) {
+      fail();
+      return 0;
+    }
+    values.push_back(cast<ConstantExpr>(value));
+  }
+  if (!good())
+    return 0;
+
+  if (values.empty())
+    return arrayCache->CreateArray(name, size, 0, 0, domain, range);
+  return arrayCache->CreateArray(name, size, &values[0],
+                                 &values[0] + values.size(), domain, range);
+}
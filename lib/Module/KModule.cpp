@@ -63,6 +63,7 @@
 #include "klee/Internal/Analysis/ModRefAnalysis.h"
 #include "klee/Internal/Analysis/Cloner.h"
 #include "klee/Internal/Analysis/SliceGenerator.h"
+#include "klee/Internal/Analysis/AnalysisCache.h"
 
 #include <sstream>
 
@@ -112,6 +113,11 @@ namespace {
   UseSVFPTA("use-svf-analysis",
             cl::desc("Use SVF pointer analysis for reachability analysis (default=on)"),
             cl::init(true));
+
+  cl::opt<std::string>
+  AnalysisCacheDir("analysis-cache-dir",
+                   cl::desc("Directory for caching the static analysis results across runs (default=off)"),
+                   cl::init(""));
 }
 
 KModule::KModule(Module *_module) 
@@ -461,20 +467,37 @@ void KModule::prepare(const Interpreter::ModuleOptions &opts,
     /* first, we need to do the inlining... */
     inliner->run();
 
-    /* run pointer analysis */
-    klee_message("Runnining pointer analysis...");
-    PassManager passManager;
-    passManager.add(aa);
-    passManager.run(*module);
+    /* the key depends on the module after inlining */
+    AnalysisCache *cache = NULL;
+    if (!AnalysisCacheDir.empty()) {
+      cache = new AnalysisCache(module, AnalysisCacheDir, opts.EntryPoint,
+                                keeper->getSkippedTargets(), UseSVFPTA);
+      cache->computeKey();
+    }
 
-    /* run reachability analysis */
-    klee_message("Runnining reachability analysis...");
+    /* the pass holds the points-to results once they are computed or loaded */
     ra->usePA(aa);
-    ra->run(UseSVFPTA);
+    if (cache && cache->load(aa, ra, mra)) {
+      klee_message("Loaded static analysis results from %s", cache->getPath().c_str());
+    } else {
+      /* run pointer analysis (not through a pass manager, which would delete
+         the pass: the slicer and the executor use it after preparation) */
+      klee_message("Runnining pointer analysis...");
+      aa->runOnModule(*module);
 
-    /* run mod-ref analysis */
-    klee_message("Runnining mod-ref analysis...");
-    mra->run();
+      /* run reachability analysis */
+      klee_message("Runnining reachability analysis...");
+      ra->run(UseSVFPTA);
+
+      /* run mod-ref analysis */
+      klee_message("Runnining mod-ref analysis...");
+      mra->run();
+
+      if (cache) {
+        cache->save(aa, ra, mra);
+      }
+    }
+    delete cache;
 
     if (sliceGenerator) {
       /* TODO: rename... */
@@ -570,6 +593,30 @@ void KModule::addFunction(KFunction *kf, bool isSkippingFunctions, Cloner *clone
     functionMap.insert(std::make_pair(kf->function, kf));
 }
 
+void KModule::updateModRefFlags(ModRefAnalysis *mra, const std::set<Instruction *> &affected) {
+    if (affected.empty()) {
+        return;
+    }
+
+    for (std::vector<KFunction *>::iterator i = functions.begin(); i != functions.end(); i++) {
+        KFunction *kf = *i;
+        for (unsigned j = 0; j < kf->numInstructions; ++j) {
+            KInstruction *ki = kf->instructions[j];
+            Instruction *inst = ki->getOrigInst();
+            if (!inst || affected.find(inst) == affected.end()) {
+                continue;
+            }
+
+            if (ki->inst->getOpcode() == Instruction::Load) {
+                ki->mayBlock = mra->mayBlock(inst);
+            }
+            if (ki->inst->getOpcode() == Instruction::Store) {
+                ki->mayOverride = mra->mayOverride(inst);
+            }
+        }
+    }
+}
+
 KConstant* KModule::getKConstant(Constant *c) {
   std::map<llvm::Constant*, KConstant*>::iterator it = constantMap.find(c);
   if (it != constantMap.end())
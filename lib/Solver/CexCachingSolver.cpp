@@ -13,17 +13,27 @@
 #include "klee/Expr.h"
 #include "klee/SolverImpl.h"
 #include "klee/TimerStatIncrementer.h"
+#include "klee/util/ArrayCache.h"
 #include "klee/util/Assignment.h"
+#include "klee/util/ExprHashMap.h"
+#include "klee/util/ExprSerialization.h"
 #include "klee/util/ExprUtil.h"
 #include "klee/util/ExprVisitor.h"
-#include "klee/Internal/ADT/MapOfSets.h"
+#include "klee/Internal/ADT/SetTrie.h"
 
 #include "klee/SolverStats.h"
 
 #include "klee/Internal/Support/ErrorHandling.h"
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
 
+#include <fcntl.h>
+#include <fstream>
+#include <stdio.h>
+#include <sys/file.h>
+#include <unistd.h>
+
 using namespace klee;
 using namespace llvm;
 
@@ -44,28 +54,65 @@ namespace {
   cl::opt<bool>
   CexCacheExperimental("cex-cache-exp", cl::init(false));
 
+  cl::opt<unsigned>
+  CexCacheMaxEntries("cex-cache-max-entries",
+                     cl::desc("Maximum number of cached constraint sets, the least recently used are evicted (default=0 (off))"),
+                     cl::init(0));
+
+  cl::opt<std::string>
+  CexCacheFile("cex-cache-file",
+               cl::desc("Load the counterexample cache from this file and merge it back at exit, so repeated runs (and the workers of -threads) share it (default=off)"),
+               cl::init(""));
+
 }
 
 ///
 
 typedef std::set< ref<Expr> > KeyType;
 
+/// The constraints of the cached sets are numbered, so the cache is a trie
+/// of sorted id vectors (comparing expressions is much more expensive).
+typedef SetTrie<Assignment*>::key_type IdKeyType;
+
 struct AssignmentLessThan {
-  bool operator()(const Assignment *a, const Assignment *b) {
+  bool operator()(const Assignment *a, const Assignment *b) const {
     return a->bindings < b->bindings;
   }
 };
 
 
 class CexCachingSolver : public SolverImpl {
-  typedef std::set<Assignment*, AssignmentLessThan> assignmentsTable_ty;
+  /// the distinct assignments, with the number of cache entries using them
+  typedef std::map<Assignment*, unsigned, AssignmentLessThan>
+    assignmentsTable_ty;
 
   Solver *solver;
+  ArrayCache *arrayCache;
   
-  MapOfSets<ref<Expr>, Assignment*> cache;
+  SetTrie<Assignment*> cache;
   // memo table
   assignmentsTable_ty assignmentsTable;
 
+  /// the ids of the constraints of the cached sets, with the number of cache
+  /// entries using them (the ids of unused constraints are reused)
+  ExprHashMap<unsigned> constraintIds;
+  std::vector< ref<Expr> > constraints;
+  std::vector<unsigned> constraintUses;
+  std::vector<unsigned> freeIds;
+
+  /// Sets ids to the sorted ids of the constraints of key which have one and
+  /// unknown to the others.
+  void getIds(const KeyType &key, IdKeyType &ids,
+              std::vector< ref<Expr> > &unknown);
+
+  Assignment *insert(const KeyType &key, Assignment *binding);
+  void evict();
+  Assignment *retainAssignment(Assignment *binding);
+  void releaseAssignment(Assignment *binding);
+
+  bool load(const std::string &path, bool merge = false);
+  void save(const std::string &path);
+
   bool searchForAssignment(KeyType &key, 
                            Assignment *&result);
   
@@ -79,7 +126,11 @@ class CexCachingSolver : public SolverImpl {
   bool getAssignment(const Query& query, Assignment *&result);
   
 public:
-  CexCachingSolver(Solver *_solver) : solver(_solver) {}
+  CexCachingSolver(Solver *_solver, ArrayCache *_arrayCache)
+    : solver(_solver), arrayCache(_arrayCache) {
+    if (!CexCacheFile.empty() && arrayCache)
+      load(CexCacheFile);
+  }
   ~CexCachingSolver();
   
   bool computeTruth(const Query&, bool &isValid);
@@ -97,23 +148,71 @@ public:
 ///
 
 struct NullAssignment {
-  bool operator()(Assignment *a) const { return !a; }
+  bool operator()(const IdKeyType &, Assignment *a) const { return !a; }
 };
 
 struct NonNullAssignment {
-  bool operator()(Assignment *a) const { return a!=0; }
+  bool operator()(const IdKeyType &, Assignment *a) const { return a!=0; }
 };
 
+/// Checks the assignment of a subset of the key on the constraints of the key
+/// which are not in the subset (the others are satisfied by construction).
+/// An assignment which fails is not checked again for the other subsets: it
+/// fails on a constraint which is in none of the sets it was cached for.
 struct NullOrSatisfyingAssignment {
-  KeyType &key;
-  
-  NullOrSatisfyingAssignment(KeyType &_key) : key(_key) {}
+  const std::vector< ref<Expr> > &constraints;
+  const IdKeyType &ids;
+  const std::vector< ref<Expr> > &unknown;
+  std::set<Assignment*> rejected;
+
+  NullOrSatisfyingAssignment(const std::vector< ref<Expr> > &_constraints,
+                             const IdKeyType &_ids,
+                             const std::vector< ref<Expr> > &_unknown)
+    : constraints(_constraints), ids(_ids), unknown(_unknown) {}
+
+  bool operator()(const IdKeyType &subset, Assignment *a) {
+    if (!a)
+      return true;
+    if (!rejected.insert(a).second)
+      return false;
 
-  bool operator()(Assignment *a) const { 
-    return !a || a->satisfies(key.begin(), key.end()); 
+    // the constraints which were never cached (e.g. the negated query
+    // expression) are the most likely to fail
+    AssignmentEvaluator v(*a);
+    for (std::vector< ref<Expr> >::const_iterator it = unknown.begin(),
+           ie = unknown.end(); it != ie; ++it)
+      if (!v.visit(*it)->isTrue())
+        return false;
+
+    IdKeyType::const_iterator sit = subset.begin(), sie = subset.end();
+    for (IdKeyType::const_iterator it = ids.begin(), ie = ids.end();
+         it != ie; ++it) {
+      while (sit != sie && *sit < *it)
+        ++sit;
+      if (sit != sie && *sit == *it)
+        continue;
+      if (!v.visit(constraints[*it])->isTrue())
+        return false;
+    }
+    return true;
   }
 };
 
+void CexCachingSolver::getIds(const KeyType &key, IdKeyType &ids,
+                              std::vector< ref<Expr> > &unknown) {
+  ids.clear();
+  unknown.clear();
+  for (KeyType::const_iterator it = key.begin(), ie = key.end(); it != ie;
+       ++it) {
+    ExprHashMap<unsigned>::iterator id = constraintIds.find(*it);
+    if (id == constraintIds.end())
+      unknown.push_back(*it);
+    else
+      ids.push_back(id->second);
+  }
+  std::sort(ids.begin(), ids.end());
+}
+
 /// searchForAssignment - Look for a cached solution for a query.
 ///
 /// \param key - The query to look up.
@@ -122,22 +221,33 @@ struct NullOrSatisfyingAssignment {
 /// unsatisfiable query).
 /// \return - True if a cached result was found.
 bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
-  Assignment * const *lookup = cache.lookup(key);
-  if (lookup) {
-    result = *lookup;
-    return true;
+  IdKeyType ids;
+  std::vector< ref<Expr> > unknown;
+  getIds(key, ids, unknown);
+
+  // If a constraint is not in any cached set, only subsets can be cached.
+  if (unknown.empty()) {
+    Assignment * const *lookup = cache.lookup(ids);
+    if (lookup) {
+      result = *lookup;
+      return true;
+    }
   }
 
   if (CexCacheTryAll) {
     // Look for a satisfying assignment for a superset, which is trivially an
     // assignment for any subset.
     Assignment **lookup = 0;
-    if (CexCacheSuperSet)
-      lookup = cache.findSuperset(key, NonNullAssignment());
+    if (CexCacheSuperSet && unknown.empty()) {
+      NonNullAssignment p;
+      lookup = cache.findSuperset(ids, p);
+    }
 
     // Otherwise, look for a subset which is unsatisfiable, see below.
-    if (!lookup) 
-      lookup = cache.findSubset(key, NullAssignment());
+    if (!lookup) {
+      NullAssignment p;
+      lookup = cache.findSubset(ids, p);
+    }
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
@@ -149,7 +259,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // of them satisfies the query.
     for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
            ie = assignmentsTable.end(); it != ie; ++it) {
-      Assignment *a = *it;
+      Assignment *a = it->first;
       if (a->satisfies(key.begin(), key.end())) {
         result = a;
         return true;
@@ -161,16 +271,20 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // Look for a satisfying assignment for a superset, which is trivially an
     // assignment for any subset.
     Assignment **lookup = 0;
-    if (CexCacheSuperSet)
-      lookup = cache.findSuperset(key, NonNullAssignment());
+    if (CexCacheSuperSet && unknown.empty()) {
+      NonNullAssignment p;
+      lookup = cache.findSuperset(ids, p);
+    }
 
     // Otherwise, look for a subset which is unsatisfiable -- if the subset is
     // unsatisfiable then no additional constraints can produce a valid
     // assignment. While searching subsets, we also explicitly the solutions for
     // satisfiable subsets to see if they solve the current query and return
     // them if so. This is cheap and frequently succeeds.
-    if (!lookup) 
-      lookup = cache.findSubset(key, NullOrSatisfyingAssignment(key));
+    if (!lookup) {
+      NullOrSatisfyingAssignment p(constraints, ids, unknown);
+      lookup = cache.findSubset(ids, p);
+    }
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
@@ -231,14 +345,6 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
   if (hasSolution) {
     binding = new Assignment(objects, values);
 
-    // Memoize the result.
-    std::pair<assignmentsTable_ty::iterator, bool>
-      res = assignmentsTable.insert(binding);
-    if (!res.second) {
-      delete binding;
-      binding = *res.first;
-    }
-    
     if (DebugCexCacheCheckBinding)
       if (!binding->satisfies(key.begin(), key.end())) {
         query.dump();
@@ -249,20 +355,262 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
     binding = (Assignment*) 0;
   }
   
-  result = binding;
-  cache.insert(key, binding);
+  result = insert(key, binding);
+  if (CexCacheMaxEntries)
+    while (cache.size() > CexCacheMaxEntries)
+      evict();
 
   return true;
 }
 
+/// retainAssignment - Memoize an assignment used by a new cache entry.
+///
+/// \return The memoized assignment with the same bindings, \arg binding is
+/// deleted if there is one already.
+Assignment *CexCachingSolver::retainAssignment(Assignment *binding) {
+  if (!binding)
+    return 0;
+
+  std::pair<assignmentsTable_ty::iterator, bool>
+    res = assignmentsTable.insert(std::make_pair(binding, 0u));
+  if (res.first->first != binding)
+    delete binding;
+  res.first->second++;
+  return res.first->first;
+}
+
+void CexCachingSolver::releaseAssignment(Assignment *binding) {
+  if (!binding)
+    return;
+
+  assignmentsTable_ty::iterator it = assignmentsTable.find(binding);
+  assert(it != assignmentsTable.end() && it->first == binding);
+  if (--it->second == 0) {
+    assignmentsTable.erase(it);
+    delete binding;
+  }
+}
+
+/// insert - Cache the result of a query.
+///
+/// \return The memoized assignment (see retainAssignment).
+Assignment *CexCachingSolver::insert(const KeyType &key, Assignment *binding) {
+  binding = retainAssignment(binding);
+
+  IdKeyType ids;
+  std::vector< ref<Expr> > unknown;
+  getIds(key, ids, unknown);
+  if (unknown.empty()) {
+    if (Assignment **lookup = cache.lookup(ids)) {
+      releaseAssignment(*lookup);
+      *lookup = binding;
+      return binding;
+    }
+  }
+
+  for (std::vector< ref<Expr> >::iterator it = unknown.begin(),
+         ie = unknown.end(); it != ie; ++it) {
+    unsigned id;
+    if (freeIds.empty()) {
+      id = constraints.size();
+      constraints.push_back(*it);
+      constraintUses.push_back(0);
+    } else {
+      id = freeIds.back();
+      freeIds.pop_back();
+      constraints[id] = *it;
+    }
+    constraintIds.insert(std::make_pair(*it, id));
+    ids.push_back(id);
+  }
+  std::sort(ids.begin(), ids.end());
+
+  for (IdKeyType::iterator it = ids.begin(), ie = ids.end(); it != ie; ++it)
+    constraintUses[*it]++;
+  cache.insert(ids, binding);
+  return binding;
+}
+
+/// evict - Remove the least recently used entry of the cache.
+void CexCachingSolver::evict() {
+  IdKeyType ids;
+  Assignment *binding;
+  if (!cache.evict(ids, binding))
+    return;
+
+  releaseAssignment(binding);
+  for (IdKeyType::iterator it = ids.begin(), ie = ids.end(); it != ie; ++it) {
+    if (--constraintUses[*it] == 0) {
+      constraintIds.erase(constraints[*it]);
+      constraints[*it] = ref<Expr>();
+      freeIds.push_back(*it);
+    }
+  }
+}
+
+///
+
+/// The cache files start with this string, it changes with their format.
+static const char CexCacheMagic[] = "klee-cex-cache-1";
+
+/// load - Read the entries saved by a previous run. The arrays are created by
+/// the array cache of the executor, so the symbolic arrays of the cached
+/// constraints are the arrays of the same name and size of this run.
+///
+/// \param merge - Only add the entries which are not cached yet, and leave
+/// the cache unbounded (see save).
+/// \return True if the file was read.
+bool CexCachingSolver::load(const std::string &path, bool merge) {
+  std::ifstream is(path.c_str(), std::ios::binary);
+  if (!is)
+    return false;
+
+  ExprReader reader(is, arrayCache);
+  if (reader.readString() != CexCacheMagic || !reader.good()) {
+    klee_warning("ignoring invalid counterexample cache: %s", path.c_str());
+    return false;
+  }
+
+  bool valid = true;
+  std::vector<Assignment> assignments;
+  uint64_t numAssignments = reader.readInt();
+  for (uint64_t i = 0; i < numAssignments && valid && reader.good(); i++) {
+    assignments.push_back(Assignment());
+    uint64_t numBindings = reader.readInt();
+    for (uint64_t j = 0; j < numBindings && valid && reader.good(); j++) {
+      const Array *array = reader.readArray();
+      uint64_t size = reader.readInt();
+      // the bindings are as large as their arrays
+      if (!array || !reader.good() || size != array->size) {
+        valid = false;
+        break;
+      }
+      std::vector<unsigned char> &bytes = assignments.back().bindings[array];
+      bytes.resize(size);
+      if (size)
+        reader.readBytes(&bytes[0], size);
+    }
+  }
+
+  // the entries are saved from the least to the most recently used, so
+  // inserting them in order restores the eviction order
+  uint64_t numEntries = valid && reader.good() ? reader.readInt() : 0;
+  for (uint64_t i = 0; i < numEntries && reader.good(); i++) {
+    KeyType key;
+    uint64_t keySize = reader.readInt();
+    for (uint64_t j = 0; j < keySize && reader.good(); j++)
+      key.insert(reader.read());
+    uint64_t id = reader.readInt();
+    if (!reader.good() || id > assignments.size()) {
+      valid = false;
+      break;
+    }
+
+    if (merge) {
+      IdKeyType ids;
+      std::vector< ref<Expr> > unknown;
+      getIds(key, ids, unknown);
+      if (unknown.empty() && cache.lookup(ids))
+        continue;
+    }
+    insert(key, id ? new Assignment(assignments[id - 1]) : 0);
+  }
+
+  if (!valid || !reader.good())
+    klee_warning("ignoring the rest of a corrupted counterexample cache: %s",
+                 path.c_str());
+
+  if (merge)
+    return true;
+
+  if (CexCacheMaxEntries)
+    while (cache.size() > CexCacheMaxEntries)
+      evict();
+
+  klee_message("Loaded %u cached constraint sets from %s",
+               (unsigned) cache.size(), path.c_str());
+  return true;
+}
+
+/// save - Write the cache, merged with the entries saved to the same file by
+/// the other processes since it was loaded (the workers of -threads, or
+/// concurrent runs), so none of them is lost to the last writer.
+void CexCachingSolver::save(const std::string &path) {
+  // the merge and the write are serialized with the other writers
+  std::string lockPath = path + ".lock";
+  int lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (lockFd < 0 || flock(lockFd, LOCK_EX) != 0)
+    klee_warning("unable to lock counterexample cache: %s", path.c_str());
+
+  // the merged entries are older than ours
+  std::vector< std::pair<IdKeyType, Assignment*> > own;
+  cache.getEntries(own);
+  if (load(path, true)) {
+    for (std::vector< std::pair<IdKeyType, Assignment*> >::iterator
+           it = own.begin(), ie = own.end(); it != ie; ++it)
+      cache.lookup(it->first);
+    if (CexCacheMaxEntries)
+      while (cache.size() > CexCacheMaxEntries)
+        evict();
+  }
+
+  // the file is replaced at once, so it can be read without the lock
+  std::string tmpPath = path + ".tmp" + llvm::utostr(getpid());
+  std::ofstream os(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+  ExprWriter writer(os);
+  writer.writeString(CexCacheMagic);
+
+  std::map<Assignment*, unsigned> assignmentIds;
+  writer.writeInt(assignmentsTable.size());
+  for (assignmentsTable_ty::iterator it = assignmentsTable.begin(),
+         ie = assignmentsTable.end(); it != ie; ++it) {
+    Assignment *a = it->first;
+    unsigned id = assignmentIds.size() + 1;
+    assignmentIds[a] = id;
+
+    writer.writeInt(a->bindings.size());
+    for (Assignment::bindings_ty::iterator bit = a->bindings.begin(),
+           bie = a->bindings.end(); bit != bie; ++bit) {
+      writer.write(bit->first);
+      writer.writeInt(bit->second.size());
+      if (!bit->second.empty())
+        writer.writeBytes(&bit->second[0], bit->second.size());
+    }
+  }
+
+  std::vector< std::pair<IdKeyType, Assignment*> > entries;
+  cache.getEntries(entries);
+  writer.writeInt(entries.size());
+  for (std::vector< std::pair<IdKeyType, Assignment*> >::iterator
+         it = entries.begin(), ie = entries.end(); it != ie; ++it) {
+    writer.writeInt(it->first.size());
+    for (IdKeyType::iterator id = it->first.begin(), idEnd = it->first.end();
+         id != idEnd; ++id)
+      writer.write(constraints[*id]);
+    writer.writeInt(it->second ? assignmentIds[it->second] : 0);
+  }
+
+  os.close();
+  if (!os || rename(tmpPath.c_str(), path.c_str()) != 0) {
+    klee_warning("unable to write counterexample cache: %s", path.c_str());
+    remove(tmpPath.c_str());
+  }
+
+  if (lockFd >= 0)
+    close(lockFd); // releases the lock
+}
+
 ///
 
 CexCachingSolver::~CexCachingSolver() {
+  if (!CexCacheFile.empty() && arrayCache)
+    save(CexCacheFile);
+
   cache.clear();
   delete solver;
   for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
          ie = assignmentsTable.end(); it != ie; ++it)
-    delete *it;
+    delete it->first;
 }
 
 bool CexCachingSolver::computeValidity(const Query& query,
@@ -377,6 +725,6 @@ void CexCachingSolver::setCoreSolverTimeout(double timeout) {
 
 ///
 
-Solver *klee::createCexCachingSolver(Solver *_solver) {
-  return new Solver(new CexCachingSolver(_solver));
+Solver *klee::createCexCachingSolver(Solver *_solver, ArrayCache *arrayCache) {
+  return new Solver(new CexCachingSolver(_solver, arrayCache));
 }
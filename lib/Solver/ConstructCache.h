@@ -0,0 +1,74 @@
+//===-- ConstructCache.h ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef __UTIL_CONSTRUCTCACHE_H__
+#define __UTIL_CONSTRUCTCACHE_H__
+
+#include "klee/SolverStats.h"
+#include "klee/util/ExprHashMap.h"
+
+#include <list>
+
+namespace klee {
+
+/// Cache of the solver expressions constructed by a builder, keyed by the
+/// structure of the KLEE expression (hash-consing). The cache can be kept
+/// between queries, it is then bounded by evicting the least recently used
+/// entries. A capacity of 0 means unbounded.
+template <class T> class ConstructCache {
+  typedef std::pair<ref<Expr>, T> entry_ty;
+  typedef std::list<entry_ty> entries_ty;
+
+  // most recently used first
+  entries_ty entries;
+  ExprHashMap<typename entries_ty::iterator> index;
+  unsigned capacity;
+
+  void shrink() {
+    while (capacity && index.size() > capacity) {
+      index.erase(entries.back().first);
+      entries.pop_back();
+    }
+  }
+
+public:
+  ConstructCache(unsigned _capacity = 0) : capacity(_capacity) {}
+
+  /// Returns null on a miss, the returned value is valid until the next
+  /// insertion.
+  T *lookup(const ref<Expr> &e) {
+    typename ExprHashMap<typename entries_ty::iterator>::iterator it =
+        index.find(e);
+    if (it == index.end()) {
+      ++stats::queryConstructCacheMisses;
+      return 0;
+    }
+
+    ++stats::queryConstructCacheHits;
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->second;
+  }
+
+  void insert(const ref<Expr> &e, const T &value) {
+    assert(index.find(e) == index.end() && "already constructed");
+    entries.push_front(entry_ty(e, value));
+    index.insert(std::make_pair(e, entries.begin()));
+    shrink();
+  }
+
+  void clear() {
+    index.clear();
+    entries.clear();
+  }
+
+  unsigned size() const { return index.size(); }
+};
+}
+
+#endif
@@ -75,7 +75,8 @@ STPArrayExprHash::~STPArrayExprHash() {
 /***/
 
 STPBuilder::STPBuilder(::VC _vc, bool _optimizeDivides)
-  : vc(_vc), optimizeDivides(_optimizeDivides) {
+  : vc(_vc), constructed(SolverConstructCacheSize),
+    optimizeDivides(_optimizeDivides) {
 
 }
 
@@ -497,12 +498,11 @@ ExprHandle STPBuilder::construct(ref<Expr> e, int *width_out) {
   if (!UseConstructHash || isa<ConstantExpr>(e)) {
     return constructActual(e, width_out);
   } else {
-    ExprHashMap< std::pair<ExprHandle, unsigned> >::iterator it = 
-      constructed.find(e);
-    if (it!=constructed.end()) {
+    std::pair<ExprHandle, unsigned> *cached = constructed.lookup(e);
+    if (cached) {
       if (width_out)
-        *width_out = it->second.second;
-      return it->second.first;
+        *width_out = cached->second;
+      return cached->first;
     } else {
       int width;
       if (!width_out) width_out = &width;
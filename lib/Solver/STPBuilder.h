@@ -13,6 +13,8 @@
 #include "klee/util/ExprHashMap.h"
 #include "klee/util/ArrayExprHash.h"
 #include "klee/Config/config.h"
+#include "klee/CommandLine.h"
+#include "ConstructCache.h"
 
 #include <vector>
 
@@ -64,7 +66,7 @@ namespace klee {
 
 class STPBuilder {
   ::VC vc;
-  ExprHashMap< std::pair<ExprHandle, unsigned> > constructed;
+  ConstructCache< std::pair<ExprHandle, unsigned> > constructed;
 
   /// optimizeDivides - Rewrite division and reminders by constants
   /// into multiplies and shifts. STP should probably handle this for
@@ -121,7 +123,8 @@ public:
 
   ExprHandle construct(ref<Expr> e) { 
     ExprHandle res = construct(e, 0);
-    constructed.clear();
+    if (!SolverConstructCacheSize)
+      constructed.clear();
     return res;
   }
 };
@@ -10,6 +10,7 @@
 #ifdef ENABLE_Z3
 #include "Z3Builder.h"
 
+#include "klee/CommandLine.h"
 #include "klee/Expr.h"
 #include "klee/Solver.h"
 #include "klee/util/Bits.h"
@@ -56,7 +57,8 @@ void Z3ArrayExprHash::clear() {
 }
 
 Z3Builder::Z3Builder(bool autoClearConstructCache)
-    : autoClearConstructCache(autoClearConstructCache) {
+    : constructed(SolverConstructCacheSize),
+      autoClearConstructCache(autoClearConstructCache) {
   // FIXME: Should probably let the client pass in a Z3_config instead
   Z3_config cfg = Z3_mk_config();
   // It is very important that we ask Z3 to let us manage memory so that
@@ -419,12 +421,11 @@ Z3ASTHandle Z3Builder::construct(ref<Expr> e, int *width_out) {
   if (!UseConstructHashZ3 || isa<ConstantExpr>(e)) {
     return constructActual(e, width_out);
   } else {
-    ExprHashMap<std::pair<Z3ASTHandle, unsigned> >::iterator it =
-        constructed.find(e);
-    if (it != constructed.end()) {
+    std::pair<Z3ASTHandle, unsigned> *cached = constructed.lookup(e);
+    if (cached) {
       if (width_out)
-        *width_out = it->second.second;
-      return it->second.first;
+        *width_out = cached->second;
+      return cached->first;
     } else {
       int width;
       if (!width_out)
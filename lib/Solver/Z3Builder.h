@@ -13,6 +13,7 @@
 #include "klee/util/ExprHashMap.h"
 #include "klee/util/ArrayExprHash.h"
 #include "klee/Config/config.h"
+#include "ConstructCache.h"
 #include <z3.h>
 
 namespace klee {
@@ -106,7 +107,7 @@ public:
 };
 
 class Z3Builder {
-  ExprHashMap<std::pair<Z3ASTHandle, unsigned> > constructed;
+  ConstructCache<std::pair<Z3ASTHandle, unsigned> > constructed;
   Z3ArrayExprHash _arr_hash;
 
 private:
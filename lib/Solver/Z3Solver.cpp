@@ -7,6 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 #include "klee/Config/config.h"
+#include "klee/CommandLine.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #ifdef ENABLE_Z3
 #include "Z3Builder.h"
@@ -16,10 +17,39 @@
 #include "klee/util/Assignment.h"
 #include "klee/util/ExprUtil.h"
 
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 
+namespace {
+llvm::cl::opt<bool> Z3Incremental(
+    "z3-incremental",
+    llvm::cl::desc("Keep the Z3 solver contexts between queries and reuse "
+                   "the asserted constraints of a common path prefix using "
+                   "push/pop (default=off)"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<unsigned> Z3MaxSessions(
+    "z3-max-sessions",
+    llvm::cl::desc("Maximal number of Z3 solver contexts kept by "
+                   "--z3-incremental (default=8)"),
+    llvm::cl::init(8));
+}
+
 namespace klee {
 
+// A solver context which keeps the constraints of a path prefix
+// asserted, one scope per constraint. The paths explored by the
+// executor (and the recovery states which replay the constraints of
+// their dependent states) share long prefixes, so consecutive queries
+// mostly assert only a few new constraints.
+struct Z3Session {
+  ::Z3_solver solver;
+  std::vector<ref<Expr> > asserted;
+  uint64_t lastUse;
+
+  Z3Session(::Z3_solver _solver) : solver(_solver), lastUse(0) {}
+};
+
 class Z3SolverImpl : public SolverImpl {
 private:
   Z3Builder *builder;
@@ -28,6 +58,11 @@ private:
   ::Z3_params solverParameters;
   // Parameter symbols
   ::Z3_symbol timeoutParamStrSymbol;
+  // Incremental solving (see --z3-incremental)
+  std::vector<Z3Session *> sessions;
+  uint64_t sessionClock;
+
+  Z3Session *getSession(const Query &query);
 
   bool internalRunSolver(const Query &,
                          const std::vector<const Array *> *objects,
@@ -66,7 +101,7 @@ public:
 
 Z3SolverImpl::Z3SolverImpl()
     : builder(new Z3Builder(/*autoClearConstructCache=*/false)), timeout(0.0),
-      runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE), sessionClock(0) {
   assert(builder && "unable to create Z3Builder");
   solverParameters = Z3_mk_params(builder->ctx);
   Z3_params_inc_ref(builder->ctx, solverParameters);
@@ -75,6 +110,12 @@ Z3SolverImpl::Z3SolverImpl()
 }
 
 Z3SolverImpl::~Z3SolverImpl() {
+  for (std::vector<Z3Session *>::iterator it = sessions.begin(),
+                                          ie = sessions.end();
+       it != ie; ++it) {
+    Z3_solver_dec_ref(builder->ctx, (*it)->solver);
+    delete *it;
+  }
   Z3_params_dec_ref(builder->ctx, solverParameters);
   delete builder;
 }
@@ -162,25 +203,85 @@ bool Z3SolverImpl::computeInitialValues(
   return internalRunSolver(query, &objects, &values, hasSolution);
 }
 
+Z3Session *Z3SolverImpl::getSession(const Query &query) {
+  // Select the session with the longest common prefix of constraints
+  Z3Session *session = NULL;
+  unsigned prefix = 0;
+  for (std::vector<Z3Session *>::iterator it = sessions.begin(),
+                                          ie = sessions.end();
+       it != ie; ++it) {
+    std::vector<ref<Expr> > &asserted = (*it)->asserted;
+    unsigned common = 0;
+    for (ConstraintManager::const_iterator ci = query.constraints.begin(),
+                                           ce = query.constraints.end();
+         ci != ce && common < asserted.size() && *ci == asserted[common];
+         ++ci) {
+      ++common;
+    }
+    if (!session || common > prefix ||
+        (common == prefix && (*it)->lastUse < session->lastUse)) {
+      session = *it;
+      prefix = common;
+    }
+  }
+
+  // An unrelated path, start a new session if possible. Otherwise, the
+  // least recently used session is reset (selected above).
+  if (!session || (prefix == 0 && sessions.size() < Z3MaxSessions)) {
+    ::Z3_solver theSolver = Z3_mk_simple_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    session = new Z3Session(theSolver);
+    sessions.push_back(session);
+  }
+
+  // Pop the constraints which are not shared with the query
+  unsigned numScopes = session->asserted.size();
+  if (prefix < numScopes) {
+    Z3_solver_pop(builder->ctx, session->solver, numScopes - prefix);
+    session->asserted.resize(prefix);
+  }
+
+  unsigned index = 0;
+  for (ConstraintManager::const_iterator it = query.constraints.begin(),
+                                         ie = query.constraints.end();
+       it != ie; ++it, ++index) {
+    if (index < prefix)
+      continue;
+    Z3_solver_push(builder->ctx, session->solver);
+    Z3_solver_assert(builder->ctx, session->solver, builder->construct(*it));
+    session->asserted.push_back(*it);
+  }
+
+  session->lastUse = ++sessionClock;
+  return session;
+}
+
 bool Z3SolverImpl::internalRunSolver(
     const Query &query, const std::vector<const Array *> *objects,
     std::vector<std::vector<unsigned char> > *values, bool &hasSolution) {
   TimerStatIncrementer t(stats::queryTime);
-  // TODO: Does making a new solver for each query have a performance
-  // impact vs making one global solver and using push and pop?
-  // TODO: is the "simple_solver" the right solver to use for
-  // best performance?
-  Z3_solver theSolver = Z3_mk_simple_solver(builder->ctx);
-  Z3_solver_inc_ref(builder->ctx, theSolver);
-  Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+  Z3_solver theSolver;
+  if (Z3Incremental) {
+    theSolver = getSession(query)->solver;
+    Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+    // The query expression is popped after the check
+    Z3_solver_push(builder->ctx, theSolver);
+  } else {
+    // TODO: is the "simple_solver" the right solver to use for
+    // best performance?
+    theSolver = Z3_mk_simple_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+
+    for (ConstraintManager::const_iterator it = query.constraints.begin(),
+                                           ie = query.constraints.end();
+         it != ie; ++it) {
+      Z3_solver_assert(builder->ctx, theSolver, builder->construct(*it));
+    }
+  }
 
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
-  for (ConstraintManager::const_iterator it = query.constraints.begin(),
-                                         ie = query.constraints.end();
-       it != ie; ++it) {
-    Z3_solver_assert(builder->ctx, theSolver, builder->construct(*it));
-  }
   ++stats::queries;
   if (objects)
     ++stats::queryCounterexamples;
@@ -201,13 +302,19 @@ bool Z3SolverImpl::internalRunSolver(
   runStatusCode = handleSolverResponse(theSolver, satisfiable, objects, values,
                                        hasSolution);
 
-  Z3_solver_dec_ref(builder->ctx, theSolver);
-  // Clear the builder's cache to prevent memory usage exploding.
-  // By using ``autoClearConstructCache=false`` and clearning now
+  if (Z3Incremental)
+    Z3_solver_pop(builder->ctx, theSolver, 1);
+  else
+    Z3_solver_dec_ref(builder->ctx, theSolver);
+
+  // Unless the builder's cache is kept between queries (and bounded, see
+  // --solver-construct-cache-size), clear it to prevent memory usage
+  // exploding. By using ``autoClearConstructCache=false`` and clearning now
   // we allow Z3_ast expressions to be shared from an entire
   // ``Query`` rather than only sharing within a single call to
   // ``builder->construct()``.
-  builder->clearConstructCache();
+  if (!SolverConstructCacheSize)
+    builder->clearConstructCache();
 
   if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
       runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
@@ -0,0 +1,33 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --skip-functions=foo --batch-recovery --output-dir=%t.klee-out %t1.bc > %t2.out 2> %t2.out
+// RUN: FileCheck %s -input-file=%t2.out
+// RUN: test ! -f %t.klee-out/test000001.ptr.err
+
+// Both fields of s are modified by foo, so the load through q may depend on
+// both modifiers of the snapshot, which are recovered by one union slice.
+
+// CHECK: 12 (good!)
+// CHECK-NOT: (bad!)
+
+#include <stdio.h>
+
+struct pair {
+    char x;
+    char y;
+};
+
+void foo(struct pair *p) {
+    p->x = '1';
+    p->y = '2';
+}
+
+int main(int argc, char** argv) {
+    struct pair s = { 0, 0 };
+    char *q = (char *)(&s);
+    foo(&s);
+
+    if (q[argc - 1] == '1' && s.y == '2')
+      printf("%c%c (good!)\n", s.x, s.y);
+    else printf("%d%d (bad!)\n", s.x, s.y);
+}
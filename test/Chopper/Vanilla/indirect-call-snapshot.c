@@ -0,0 +1,39 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --skip-functions=foo --collect-snapshots --output-dir=%t.klee-out %t1.bc > %t2.out 2> %t2.out
+// RUN: FileCheck %s -input-file=%t2.out
+
+// The snapshot of foo is used only by a load in reader, which is called
+// through a casted function pointer. The snapshot collector runs during the
+// loop and must not drop the snapshot.
+
+// CHECK: 1 (good!)
+// CHECK-NOT: (bad!)
+
+#include <stdio.h>
+
+int g = 0;
+
+void foo() {
+    g = 1;
+}
+
+int reader() {
+    return g;
+}
+
+int main(int argc, char** argv) {
+    int (* volatile p)(int) = (int (*)(int))(reader);
+    int i, sum = 0;
+
+    foo();
+
+    /* long enough for the snapshot collector to run */
+    for (i = 0; i < 100000; i++) {
+        sum += i;
+    }
+
+    if (p(sum) == 1)
+      printf("1 (good!)\n");
+    else printf("%d (bad!)\n", p(sum));
+}
@@ -0,0 +1,42 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --skip-functions=foo --recovery-search=cost --output-dir=%t.klee-out %t1.bc > %t2.out 2> %t2.out
+// RUN: FileCheck %s -input-file=%t2.out
+// RUN: test ! -f %t.klee-out/test000001.ptr.err
+
+// Each load of g may depend on all the snapshots of foo, so the recoveries
+// create dependent (high priority) recovery states, which are not managed by
+// the cost searcher.
+
+// CHECK-DAG: 2 (good!)
+// CHECK-DAG: 4 (good!)
+// CHECK-NOT: (bad!)
+
+#include <stdio.h>
+#include <klee/klee.h>
+
+int g[4];
+
+void foo(int i) {
+    g[i] = i + 1;
+}
+
+int main(int argc, char** argv) {
+    int k;
+    klee_make_symbolic(&k, sizeof(k), "k");
+
+    for (int i = 0; i < 4; i++)
+        foo(i);
+
+    if (k > 2) {
+        if (g[1] == 2)
+            printf("%d (good!)\n", g[1]);
+        else printf("%d (bad!)\n", g[1]);
+    } else {
+        if (g[3] == 4)
+            printf("%d (good!)\n", g[3]);
+        else printf("%d (bad!)\n", g[3]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --skip-functions=foo --share-recovered-values --simplify-sym-indices --output-dir=%t.klee-out %t1.bc > %t2.out 2> %t2.out
+// RUN: FileCheck %s -input-file=%t2.out
+
+// g is recovered only on paths where x is fixed by a guiding constraint
+// (x == 3 or x == 5), so the recovery stores a constant. That value is valid
+// only on its own path, and must not be reused by the other one.
+
+// CHECK-DAG: 3 (good!)
+// CHECK-DAG: 5 (good!)
+// CHECK-NOT: (bad!)
+
+#include <stdio.h>
+#include <klee/klee.h>
+
+int g;
+
+void foo(int x) {
+    g = x + 1;
+}
+
+int main(int argc, char** argv) {
+    int x;
+    klee_make_symbolic(&x, sizeof(x), "x");
+
+    foo(x);
+
+    if (x == 3) {
+        if (g == 4)
+            printf("3 (good!)\n");
+        else printf("3 (bad!)\n");
+    }
+
+    if (x == 5) {
+        if (g == 6)
+            printf("5 (good!)\n");
+        else printf("5 (bad!)\n");
+    }
+
+    return 0;
+}
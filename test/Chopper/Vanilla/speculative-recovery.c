@@ -0,0 +1,36 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --skip-functions=foo --speculative-recovery -speculative-recovery-ratio=0 -debug-only=basic --output-dir=%t.klee-out %t1.bc > %t2.out 2> %t2.out
+// RUN: FileCheck %s -input-file=%t2.out
+// RUN: test ! -f %t.klee-out/test000001.ptr.err
+
+// a and b are modified by different slices of foo. With a zero ratio, the
+// first recovery of foo executes the union of its slices, so the load of b
+// is served by the writes recorded while recovering a.
+
+// CHECK: speculative recovery of foo: 2 slices
+// CHECK: 12 (good!)
+// CHECK-NOT: (bad!)
+// CHECK: recovery states = 1
+
+#include <stdio.h>
+
+int a;
+int b;
+
+void foo(int x, int y) {
+    a = x;
+    b = y;
+}
+
+int main(int argc, char** argv) {
+    foo(1, 2);
+
+    if (a == 1) {
+        if (b == 2)
+            printf("%d%d (good!)\n", a, b);
+        else printf("%d%d (bad!)\n", a, b);
+    } else printf("%d%d (bad!)\n", a, b);
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --skip-functions=foo --output-dir=%t.klee-out %t1.bc > %t2.out 2> %t2.out
+// RUN: FileCheck %s -input-file=%t2.out
+// RUN: test ! -f %t.klee-out/test000001.ptr.err
+// RUN: not grep "multiple resolutions" %t2.out
+
+// The loads from arr and from p depend on foo and have symbolic addresses.
+// The load from arr must be inside one object, so the whole object is
+// recovered. p may point to arr or brr, so the state forks once per object.
+
+// CHECK-DAG: arr (good!)
+// CHECK-DAG: brr (good!)
+// CHECK-NOT: (bad!)
+
+#include <stdio.h>
+#include <klee/klee.h>
+
+int arr[4];
+int brr[4];
+
+void foo() {
+    for (int i = 0; i < 4; i++) {
+        arr[i] = i + 1;
+        brr[i] = i + 5;
+    }
+}
+
+int main(int argc, char** argv) {
+    int i, c;
+    klee_make_symbolic(&i, sizeof(i), "i");
+    klee_make_symbolic(&c, sizeof(c), "c");
+    klee_assume(i >= 0);
+    klee_assume(i < 4);
+
+    foo();
+
+    if (arr[i] == i + 1)
+        printf("arr (good!)\n");
+    else printf("arr (bad!)\n");
+
+    int *p = c ? arr : brr;
+    if (p[i] == (c ? i + 1 : i + 5))
+        printf("%s (good!)\n", c ? "arr" : "brr");
+    else printf("p (bad!)\n");
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+// Check that the states are swapped out instead of being killed when we
+// exceed our memory bounds, and that they complete after being swapped in.
+
+// RUN: %llvmgcc -emit-llvm -g -c %s -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --max-memory=20 --swap-states %t.bc > %t.log 2> %t.err
+// RUN: grep "WARNING: swapping out" %t.err
+// RUN: not grep -q "killing" %t.err
+// RUN: not grep -q "BAD" %t.log
+// RUN: test `grep -c "DONE" %t.log` -eq 16
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "klee/klee.h"
+
+int main() {
+  unsigned char k;
+  int i, j, n = 0, x = 0;
+  // 16 MBs, copied by each state when it is written
+  char *p = malloc(1 << 24);
+
+  klee_make_symbolic(&k, sizeof(k), "k");
+  for (i = 0; i < 4; i++)
+    if (k & (1 << i))
+      n |= 1 << i;
+
+  p[0] = n;
+  // Ensure we hit the periodic check
+  for (j = 0; j < 100000; j++)
+    x += p[0];
+
+  if (p[0] == n)
+    printf("DONE!\n");
+  else
+    printf("BAD!\n");
+
+  return x;
+}
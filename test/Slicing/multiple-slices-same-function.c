@@ -0,0 +1,51 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -search=dfs -skip-functions=f %t.bc > %t.out 2>&1
+// RUN: FileCheck %s -input-file=%t.out -check-prefix=CHECK-SLICES
+// RUN: FileCheck %s -input-file=%t.out -check-prefix=CHECK-A
+// RUN: not FileCheck %s -input-file=%t.out -check-prefix=CHECK-B
+
+// Each field is recovered by its own slice of f. The second slice needs the
+// instructions which the first one slices away, so the dependence graph of f
+// must not be pruned by the first slice.
+
+// CHECK-SLICES: KLEE: done: generated slices = 2
+
+// CHECK-A: x is correct
+// CHECK-A: y is correct
+// CHECK-B: incorrect
+
+#include <stdio.h>
+
+typedef struct {
+    int x;
+    int y;
+} point;
+
+void f(point *o, int k) {
+    int a = k * 2;
+    int b = k + 3;
+    o->x = a;
+    o->y = b;
+}
+
+int main(int argc, char *argv[], char *envp[]) {
+    point o;
+    o.x = 0; o.y = 0;
+
+    f(&o, 5);
+
+    if (o.x == 10) {
+        printf("x is correct\n");
+    } else {
+        printf("x is incorrect\n");
+    }
+
+    if (o.y == 8) {
+        printf("y is correct\n");
+    } else {
+        printf("y is incorrect\n");
+    }
+
+    return 0;
+}
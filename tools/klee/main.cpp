@@ -344,6 +344,7 @@ public:
   }
 
   void setInterpreter(Interpreter *i);
+  void setWorkerId(unsigned id);
   void setWarningFilter(const std::vector<unsigned>& Warning);
 
   void processTestCase(const ExecutionState  &state,
@@ -455,6 +456,33 @@ KleeHandler::~KleeHandler() {
   delete m_infoFile;
 }
 
+void KleeHandler::setWorkerId(unsigned id) {
+  // create the worker directory ("worker-<id>") inside the output directory
+  SmallString<128> d(m_outputDirectory);
+  llvm::sys::path::append(d, "worker-");
+  raw_svector_ostream ds(d); ds << id; ds.flush();
+
+  if (mkdir(d.c_str(), 0775) < 0)
+    klee_error("cannot create \"%s\": %s", d.c_str(), strerror(errno));
+
+  m_outputDirectory = d;
+  klee_message("worker %u: output directory is \"%s\"", id, m_outputDirectory.c_str());
+
+  // reopen warnings.txt, messages.txt and info (flushed before the fork)
+  fclose(klee_warning_file);
+  std::string file_path = getOutputFilename("warnings.txt");
+  if ((klee_warning_file = fopen(file_path.c_str(), "w")) == NULL)
+    klee_error("cannot open file \"%s\": %s", file_path.c_str(), strerror(errno));
+
+  fclose(klee_message_file);
+  file_path = getOutputFilename("messages.txt");
+  if ((klee_message_file = fopen(file_path.c_str(), "w")) == NULL)
+    klee_error("cannot open file \"%s\": %s", file_path.c_str(), strerror(errno));
+
+  delete m_infoFile;
+  m_infoFile = openOutputFile("info");
+}
+
 void KleeHandler::setInterpreter(Interpreter *i) {
   m_interpreter = i;
 
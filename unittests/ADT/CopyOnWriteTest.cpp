@@ -0,0 +1,115 @@
+//===-- CopyOnWriteTest.cpp -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/CopyOnWrite.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/* counts the live instances, to check that the shared values are freed */
+struct Counted {
+  static int live;
+  int value;
+
+  Counted() : value(0) { live++; }
+  Counted(int value) : value(value) { live++; }
+  Counted(const Counted &b) : value(b.value) { live++; }
+  ~Counted() { live--; }
+};
+
+int Counted::live = 0;
+
+TEST(CopyOnWriteTest, CopyShares) {
+  CopyOnWrite<std::vector<int> > a(std::vector<int>(3, 7));
+  EXPECT_FALSE(a.isShared());
+
+  CopyOnWrite<std::vector<int> > b(a);
+  EXPECT_TRUE(a.isShared());
+  EXPECT_TRUE(b.isShared());
+  EXPECT_EQ(&a.get(), &b.get());
+
+  CopyOnWrite<std::vector<int> > c;
+  EXPECT_TRUE(c->empty());
+  c = b;
+  EXPECT_EQ(&a.get(), &c.get());
+  EXPECT_EQ(3u, c->size());
+}
+
+TEST(CopyOnWriteTest, DetachOnWrite) {
+  CopyOnWrite<std::vector<int> > a(std::vector<int>(3, 7));
+  CopyOnWrite<std::vector<int> > b(a);
+
+  b.mutate().push_back(8);
+  EXPECT_FALSE(a.isShared());
+  EXPECT_FALSE(b.isShared());
+  EXPECT_NE(&a.get(), &b.get());
+  EXPECT_EQ(3u, a->size());
+  EXPECT_EQ(4u, b->size());
+
+  /* an unshared value is modified in place */
+  const std::vector<int> *before = &b.get();
+  b.mutate().push_back(9);
+  EXPECT_EQ(before, &b.get());
+  EXPECT_EQ(5u, b->size());
+  EXPECT_EQ(3u, a->size());
+}
+
+TEST(CopyOnWriteTest, AssignValue) {
+  CopyOnWrite<std::vector<int> > a(std::vector<int>(1, 1));
+  CopyOnWrite<std::vector<int> > b(a);
+
+  /* assigning a value to a shared instance does not modify the others */
+  b = std::vector<int>(2, 2);
+  EXPECT_FALSE(a.isShared());
+  EXPECT_EQ(1u, a->size());
+  EXPECT_EQ(2u, b->size());
+
+  /* an unshared instance is assigned in place */
+  const std::vector<int> *before = &b.get();
+  b = std::vector<int>(3, 3);
+  EXPECT_EQ(before, &b.get());
+  EXPECT_EQ(3u, b->size());
+}
+
+TEST(CopyOnWriteTest, Ownership) {
+  ASSERT_EQ(0, Counted::live);
+  {
+    CopyOnWrite<Counted> a(Counted(1));
+    EXPECT_EQ(1, Counted::live);
+    {
+      CopyOnWrite<Counted> b(a);
+      CopyOnWrite<Counted> c;
+      c = b;
+      /* one default value, released by the assignment */
+      EXPECT_EQ(1, Counted::live);
+
+      c.mutate().value = 2;
+      EXPECT_EQ(2, Counted::live);
+      EXPECT_EQ(1, a->value);
+      EXPECT_EQ(1, b->value);
+      EXPECT_EQ(2, c->value);
+    }
+    /* the copy of c is freed, the shared value is still owned by a */
+    EXPECT_EQ(1, Counted::live);
+    EXPECT_FALSE(a.isShared());
+
+    /* self assignment */
+    a = a;
+    EXPECT_EQ(1, Counted::live);
+    EXPECT_EQ(1, a->value);
+  }
+  EXPECT_EQ(0, Counted::live);
+}
+
+}
@@ -0,0 +1,55 @@
+//===-- FlatSetTest.cpp -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/FlatSet.h"
+
+using namespace klee;
+
+namespace {
+
+TEST(FlatSetTest, InsertAndFind) {
+  FlatSet<int> s;
+  EXPECT_TRUE(s.insert(2));
+  EXPECT_TRUE(s.insert(1));
+  EXPECT_FALSE(s.insert(2));
+  EXPECT_EQ(2u, s.size());
+
+  EXPECT_NE(s.end(), s.find(1));
+  EXPECT_EQ(s.end(), s.find(3));
+
+  FlatSet<int>::const_iterator i = s.begin();
+  EXPECT_EQ(1, *i++);
+  EXPECT_EQ(2, *i++);
+  EXPECT_EQ(s.end(), i);
+
+  s.clear();
+  EXPECT_TRUE(s.empty());
+}
+
+/* a copy doesn't share the elements */
+TEST(FlatSetTest, Copy) {
+  FlatSet<int> s;
+  s.insert(3);
+  s.insert(1);
+
+  FlatSet<int> copy = s;
+  EXPECT_TRUE(copy.insert(2));
+  EXPECT_EQ(3u, copy.size());
+  EXPECT_EQ(2u, s.size());
+  EXPECT_EQ(s.end(), s.find(2));
+
+  FlatSet<int>::const_iterator i = copy.begin();
+  EXPECT_EQ(1, *i++);
+  EXPECT_EQ(2, *i++);
+  EXPECT_EQ(3, *i++);
+}
+
+}
@@ -0,0 +1,162 @@
+//===-- SetTrieTest.cpp -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/SetTrie.h"
+
+#include <cstdarg>
+#include <utility>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+typedef SetTrie<int>::key_type Key;
+typedef std::vector< std::pair<Key, int> > Entries;
+
+Key makeKey(unsigned n, ...) {
+  Key key;
+  va_list ap;
+  va_start(ap, n);
+  for (unsigned i = 0; i < n; i++)
+    key.push_back(va_arg(ap, unsigned));
+  va_end(ap);
+  return key;
+}
+
+/* accepts the entries whose value is not rejected */
+struct AcceptValue {
+  int rejected;
+  Key accepted;
+  AcceptValue(int _rejected = -1) : rejected(_rejected) {}
+  bool operator()(const Key &key, int value) {
+    if (value == rejected)
+      return false;
+    accepted = key;
+    return true;
+  }
+};
+
+/* records the candidates, and accepts none of them */
+struct Collect {
+  Entries seen;
+  bool operator()(const Key &key, int value) {
+    seen.push_back(std::make_pair(key, value));
+    return false;
+  }
+};
+
+TEST(SetTrieTest, InsertAndLookup) {
+  SetTrie<int> t;
+  EXPECT_EQ(0u, t.size());
+  EXPECT_EQ(0, t.lookup(makeKey(1, 1)));
+
+  EXPECT_TRUE(t.insert(makeKey(2, 1, 3), 13));
+  EXPECT_TRUE(t.insert(makeKey(1, 1), 1));
+  EXPECT_TRUE(t.insert(Key(), 0));
+  EXPECT_EQ(3u, t.size());
+
+  ASSERT_NE((int *) 0, t.lookup(makeKey(2, 1, 3)));
+  EXPECT_EQ(13, *t.lookup(makeKey(2, 1, 3)));
+  EXPECT_EQ(1, *t.lookup(makeKey(1, 1)));
+  EXPECT_EQ(0, *t.lookup(Key()));
+  /* the subsets and supersets of a key are not keys */
+  EXPECT_EQ(0, t.lookup(makeKey(1, 3)));
+  EXPECT_EQ(0, t.lookup(makeKey(3, 1, 3, 4)));
+
+  /* an existing key is replaced */
+  EXPECT_FALSE(t.insert(makeKey(2, 1, 3), 14));
+  EXPECT_EQ(3u, t.size());
+  EXPECT_EQ(14, *t.lookup(makeKey(2, 1, 3)));
+
+  t.clear();
+  EXPECT_EQ(0u, t.size());
+  EXPECT_EQ(0, t.lookup(makeKey(1, 1)));
+}
+
+TEST(SetTrieTest, Subset) {
+  SetTrie<int> t;
+  t.insert(makeKey(2, 1, 3), 13);
+  t.insert(makeKey(2, 2, 5), 25);
+  t.insert(makeKey(1, 4), 4);
+
+  AcceptValue any;
+  int *v = t.findSubset(makeKey(4, 1, 2, 3, 4), any);
+  ASSERT_NE((int *) 0, v);
+  EXPECT_TRUE(*v == 13 || *v == 4);
+  EXPECT_EQ(0, t.findSubset(makeKey(2, 2, 3), any));
+
+  /* the predicate may reject a candidate */
+  AcceptValue not13(13);
+  v = t.findSubset(makeKey(4, 1, 2, 3, 4), not13);
+  ASSERT_NE((int *) 0, v);
+  EXPECT_EQ(4, *v);
+  AcceptValue not4(4);
+  EXPECT_EQ(0, t.findSubset(makeKey(1, 4), not4));
+}
+
+TEST(SetTrieTest, Superset) {
+  SetTrie<int> t;
+  t.insert(makeKey(3, 1, 3, 5), 135);
+  t.insert(makeKey(2, 2, 3), 23);
+  t.insert(makeKey(1, 7), 7);
+
+  AcceptValue any;
+  int *v = t.findSuperset(makeKey(1, 3), any);
+  ASSERT_NE((int *) 0, v);
+  EXPECT_TRUE(*v == 135 || *v == 23);
+  v = t.findSuperset(makeKey(2, 1, 5), any);
+  ASSERT_NE((int *) 0, v);
+  EXPECT_EQ(135, *v);
+  EXPECT_EQ(0, t.findSuperset(makeKey(2, 3, 7), any));
+
+  /* every entry is a superset of the empty key */
+  Collect all;
+  EXPECT_EQ(0, t.findSuperset(Key(), all));
+  EXPECT_EQ(3u, all.seen.size());
+}
+
+TEST(SetTrieTest, EvictLeastRecentlyUsed) {
+  SetTrie<int> t;
+  t.insert(makeKey(1, 1), 1);
+  t.insert(makeKey(2, 1, 2), 12);
+  t.insert(makeKey(1, 3), 3);
+
+  /* a lookup (or a search) refreshes an entry */
+  t.lookup(makeKey(1, 1));
+  Entries entries;
+  t.getEntries(entries);
+  ASSERT_EQ(3u, entries.size());
+  EXPECT_EQ(12, entries[0].second);
+  EXPECT_EQ(makeKey(2, 1, 2), entries[0].first);
+  EXPECT_EQ(3, entries[1].second);
+  EXPECT_EQ(1, entries[2].second);
+
+  Key key;
+  int value;
+  ASSERT_TRUE(t.evict(key, value));
+  EXPECT_EQ(makeKey(2, 1, 2), key);
+  EXPECT_EQ(12, value);
+  EXPECT_EQ(0, t.lookup(makeKey(2, 1, 2)));
+  /* the prefix of the evicted key is still there */
+  EXPECT_EQ(1, *t.lookup(makeKey(1, 1)));
+
+  /* the signatures no longer lead to the evicted ids */
+  AcceptValue any;
+  EXPECT_EQ(0, t.findSuperset(makeKey(1, 2), any));
+
+  ASSERT_TRUE(t.evict(key, value));
+  ASSERT_TRUE(t.evict(key, value));
+  EXPECT_FALSE(t.evict(key, value));
+  EXPECT_EQ(0u, t.size());
+}
+
+}
@@ -0,0 +1,373 @@
+//===-- ConstraintsTest.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprVisitor.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+
+using namespace klee;
+
+namespace {
+
+typedef IndependenceIndex::Element Element;
+
+ref<Expr> readByte(const Array *array, unsigned index) {
+  return ReadExpr::create(UpdateList(array, 0),
+                          ConstantExpr::alloc(index, Expr::Int32));
+}
+
+ref<Expr> readAt(const Array *array, ref<Expr> index) {
+  return ReadExpr::create(UpdateList(array, 0), index);
+}
+
+std::vector<Element> getElements(ref<Expr> e) {
+  std::vector<Element> result;
+  IndependenceIndex::getElements(e, result);
+  return result;
+}
+
+std::vector<unsigned> getClusters(const IndependenceIndex &index,
+                                  ref<Expr> e) {
+  std::vector<unsigned> result;
+  index.getClusters(getElements(e), result);
+  return result;
+}
+
+std::vector<unsigned> ids(unsigned a) {
+  return std::vector<unsigned>(1, a);
+}
+
+std::vector<unsigned> ids(unsigned a, unsigned b) {
+  std::vector<unsigned> result(1, a);
+  result.push_back(b);
+  return result;
+}
+
+TEST(IndependenceIndexTest, Elements) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+
+  // sorted and without duplicates
+  std::vector<Element> elements =
+    getElements(UltExpr::create(AddExpr::create(readByte(a, 2),
+                                                readByte(a, 1)),
+                                readByte(a, 2)));
+  ASSERT_EQ(2u, elements.size());
+  EXPECT_EQ(Element(a, 1), elements[0]);
+  EXPECT_EQ(Element(a, 2), elements[1]);
+
+  // a symbolic index reads the whole array, and the bytes of the index
+  elements = getElements(readAt(a, ZExtExpr::create(readByte(b, 0),
+                                                     Expr::Int32)));
+  ASSERT_EQ(2u, elements.size());
+  EXPECT_TRUE(std::find(elements.begin(), elements.end(),
+                        Element(a, IndependenceIndex::WholeArray)) !=
+              elements.end());
+  EXPECT_TRUE(std::find(elements.begin(), elements.end(), Element(b, 0)) !=
+              elements.end());
+}
+
+TEST(IndependenceIndexTest, ConstantArrays) {
+  ArrayCache ac;
+  std::vector< ref<ConstantExpr> > values;
+  for (unsigned i = 0; i < 4; i++)
+    values.push_back(ConstantExpr::alloc(i, Expr::Int8));
+  const Array *c = ac.CreateArray("c", 4, &values[0], &values[0] + 4);
+  const Array *a = ac.CreateArray("a", 4);
+
+  EXPECT_TRUE(getElements(readByte(c, 1)).empty());
+  std::vector<Element> elements =
+    getElements(readAt(c, ZExtExpr::create(readByte(a, 3), Expr::Int32)));
+  ASSERT_EQ(1u, elements.size());
+  EXPECT_EQ(Element(a, 3), elements[0]);
+}
+
+TEST(IndependenceIndexTest, Clusters) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+  IndependenceIndex index;
+
+  index.add(getElements(readByte(a, 0)));                         // 0
+  index.add(getElements(readByte(a, 1)));                         // 1
+  index.add(getElements(readByte(b, 0)));                         // 2
+  ASSERT_EQ(3u, index.size());
+  EXPECT_EQ(ids(0), getClusters(index, readByte(a, 0)));
+  EXPECT_EQ(ids(1), getClusters(index, readByte(a, 1)));
+  EXPECT_TRUE(getClusters(index, readByte(a, 2)).empty());
+  EXPECT_EQ(ids(0, 1), getClusters(index, UltExpr::create(readByte(a, 0),
+                                                          readByte(a, 1))));
+
+  // a constraint on two bytes joins their clusters
+  index.add(getElements(UltExpr::create(readByte(a, 1), readByte(b, 0)))); // 3
+  EXPECT_EQ(ids(0), getClusters(index, readByte(a, 0)));
+  std::vector<unsigned> joined = ids(1, 2);
+  joined.push_back(3);
+  EXPECT_EQ(joined, getClusters(index, readByte(b, 0)));
+  EXPECT_EQ(joined, getClusters(index, readByte(a, 1)));
+}
+
+TEST(IndependenceIndexTest, SymbolicIndex) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+  const Array *c = ac.CreateArray("c", 4);
+  IndependenceIndex index;
+
+  index.add(getElements(readByte(a, 0)));                         // 0
+  index.add(getElements(readByte(a, 3)));                         // 1
+  index.add(getElements(readByte(c, 0)));                         // 2
+  // reads some byte of a: depends on all of them
+  index.add(getElements(readAt(a, ZExtExpr::create(readByte(b, 0),
+                                                   Expr::Int32))));  // 3
+  std::vector<unsigned> joined = ids(0, 1);
+  joined.push_back(3);
+  EXPECT_EQ(joined, getClusters(index, readByte(a, 2)));
+  EXPECT_EQ(joined, getClusters(index, readByte(b, 0)));
+  EXPECT_EQ(ids(2), getClusters(index, readByte(c, 0)));
+
+  // a later byte read of a joins the whole array cluster
+  index.add(getElements(readByte(a, 1)));                         // 4
+  joined.push_back(4);
+  EXPECT_EQ(joined, getClusters(index, readByte(a, 1)));
+
+  // a symbolic read of c finds the clusters of each of its bytes
+  index.add(getElements(readByte(c, 2)));                         // 5
+  EXPECT_EQ(ids(2, 5),
+            getClusters(index, readAt(c, ZExtExpr::create(readByte(c, 0),
+                                                          Expr::Int32))));
+}
+
+TEST(IndependenceIndexTest, MemoryUsage) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 64);
+  IndependenceIndex index;
+  size_t usage = index.getMemoryUsage();
+  for (unsigned i = 0; i < 64; i++) {
+    index.add(getElements(readByte(a, i)));
+    EXPECT_LT(usage, index.getMemoryUsage());
+    usage = index.getMemoryUsage();
+  }
+}
+
+// random reads of three 8-byte arrays, some of them at a symbolic index
+class RandomReads {
+  ArrayCache ac;
+  const Array *arrays[3];
+
+public:
+  RandomReads() {
+    arrays[0] = ac.CreateArray("a", 8);
+    arrays[1] = ac.CreateArray("b", 8);
+    arrays[2] = ac.CreateArray("c", 8);
+  }
+
+  ref<Expr> read() {
+    const Array *array = arrays[rand() % 3];
+    if (rand() % 6 == 0)
+      return readAt(array, ZExtExpr::create(readByte(arrays[rand() % 3],
+                                                     rand() % 8),
+                                            Expr::Int32));
+    return readByte(array, rand() % 8);
+  }
+};
+
+// intersect: the elements are read by both sets
+bool dependent(const std::vector<Element> &a, const std::vector<Element> &b) {
+  for (unsigned i = 0; i < a.size(); i++) {
+    for (unsigned j = 0; j < b.size(); j++) {
+      if (a[i].first != b[j].first)
+        continue;
+      if (a[i] == b[j] || a[i].second == IndependenceIndex::WholeArray ||
+          b[j].second == IndependenceIndex::WholeArray)
+        return true;
+    }
+  }
+  return false;
+}
+
+// the constraints (in order) of the transitive closure of the elements of e
+std::vector< ref<Expr> > getClosure(const std::vector< ref<Expr> > &cs,
+                                    ref<Expr> e) {
+  std::vector<Element> closure = getElements(e);
+  std::vector<bool> in(cs.size(), false);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (unsigned i = 0; i < cs.size(); i++) {
+      if (in[i])
+        continue;
+      std::vector<Element> elements = getElements(cs[i]);
+      if (dependent(elements, closure)) {
+        in[i] = true;
+        closure.insert(closure.end(), elements.begin(), elements.end());
+        changed = true;
+      }
+    }
+  }
+
+  std::vector< ref<Expr> > result;
+  for (unsigned i = 0; i < cs.size(); i++)
+    if (in[i])
+      result.push_back(cs[i]);
+  return result;
+}
+
+TEST(IndependenceIndexTest, RandomAgainstClosure) {
+  RandomReads random;
+  srand(1);
+
+  for (unsigned iteration = 0; iteration < 1000; iteration++) {
+    ConstraintManager cm, copy;
+    unsigned n = rand() % 12;
+    for (unsigned i = 0; i < n; i++) {
+      ref<Expr> e = UleExpr::create(random.read(), random.read());
+      if (rand() % 4 == 0)
+        e = EqExpr::create(ConstantExpr::alloc(0, Expr::Int8), random.read());
+      if (isa<ConstantExpr>(cm.simplifyExpr(e)))
+        continue;
+      cm.addConstraint(e);
+      // the copy shares the index until one of them adds a constraint
+      if (i == n / 2)
+        copy = cm;
+    }
+
+    std::vector< ref<Expr> > cs(cm.begin(), cm.end());
+    std::vector< ref<Expr> > copied(copy.begin(), copy.end());
+    ConstraintManager unindexed(cs);
+    for (unsigned q = 0; q < 3; q++) {
+      ref<Expr> e = UleExpr::create(random.read(), random.read());
+
+      std::vector< ref<Expr> > result;
+      cm.getIndependentConstraints(e, result);
+      EXPECT_EQ(getClosure(cs, e), result);
+
+      // caught up on demand
+      result.clear();
+      unindexed.getIndependentConstraints(e, result);
+      EXPECT_EQ(getClosure(cs, e), result);
+
+      result.clear();
+      copy.getIndependentConstraints(e, result);
+      EXPECT_EQ(getClosure(copied, e), result);
+    }
+  }
+}
+
+TEST(EqualityIndexTest, Substitutions) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  ref<Expr> zero = ConstantExpr::alloc(0, Expr::Int8);
+  ref<Expr> one = ConstantExpr::alloc(1, Expr::Int8);
+  EqualityIndex index;
+
+  // an equality with a constant substitutes the constant
+  EXPECT_TRUE(index.add(EqExpr::create(zero, readByte(a, 0))));
+  // the first substitution is kept
+  EXPECT_FALSE(index.add(EqExpr::create(one, readByte(a, 0))));
+  // any other constraint is substituted by true
+  ref<Expr> ult = UltExpr::create(readByte(a, 1), readByte(a, 2));
+  EXPECT_TRUE(index.add(ult));
+  EXPECT_FALSE(index.add(ult));
+  EXPECT_EQ(4u, index.size());
+
+  const EqualityIndex::substitutions_ty &substitutions =
+    index.getSubstitutions();
+  ASSERT_EQ(2u, substitutions.size());
+  EXPECT_EQ(zero, substitutions.find(readByte(a, 0))->second);
+  EXPECT_EQ(ref<Expr>(ConstantExpr::alloc(1, Expr::Bool)),
+            substitutions.find(ult)->second);
+}
+
+// simplifyExpr() as it was before the substitutions were indexed: the
+// substitutions are collected from all the constraints on each call
+class ReferenceSimplifier : public ExprVisitor {
+  std::map< ref<Expr>, ref<Expr> > replacements;
+
+public:
+  ReferenceSimplifier(const ConstraintManager &cm) : ExprVisitor(true) {
+    for (ConstraintManager::constraint_iterator it = cm.begin(),
+           ie = cm.end(); it != ie; ++it) {
+      const EqExpr *ee = dyn_cast<EqExpr>(*it);
+      if (ee && isa<ConstantExpr>(ee->left))
+        replacements.insert(std::make_pair(ee->right, ee->left));
+      else
+        replacements.insert(std::make_pair(*it,
+                                           ConstantExpr::alloc(1, Expr::Bool)));
+    }
+  }
+
+  Action visitExprPost(const Expr &e) {
+    std::map< ref<Expr>, ref<Expr> >::const_iterator it =
+      replacements.find(ref<Expr>(const_cast<Expr *>(&e)));
+    if (it != replacements.end())
+      return Action::changeTo(it->second);
+    return Action::doChildren();
+  }
+};
+
+ref<Expr> simplifyReference(const ConstraintManager &cm, ref<Expr> e) {
+  if (isa<ConstantExpr>(e))
+    return e;
+  return ReferenceSimplifier(cm).visit(e);
+}
+
+TEST(EqualityIndexTest, RandomAgainstReference) {
+  RandomReads random;
+  srand(7);
+
+  for (unsigned iteration = 0; iteration < 500; iteration++) {
+    ConstraintManager cm, copy;
+    unsigned n = rand() % 14;
+    for (unsigned i = 0; i < n; i++) {
+      ref<Expr> e = UleExpr::create(random.read(), random.read());
+      if (rand() % 3 == 0)
+        e = EqExpr::create(ConstantExpr::alloc(0, Expr::Int8), random.read());
+      if (rand() % 5 == 0)
+        e = UleExpr::create(AddExpr::create(random.read(), random.read()),
+                            random.read());
+      if (isa<ConstantExpr>(cm.simplifyExpr(e)))
+        continue;
+      cm.addConstraint(e);
+      if (i == n / 2)
+        copy = cm;
+
+      // the second call is answered by the memoized result
+      ref<Expr> q = AddExpr::create(random.read(), random.read());
+      EXPECT_EQ(simplifyReference(cm, q), cm.simplifyExpr(q));
+      EXPECT_EQ(simplifyReference(cm, q), cm.simplifyExpr(q));
+      q = UleExpr::create(random.read(), random.read());
+      EXPECT_EQ(simplifyReference(cm, q), cm.simplifyExpr(q));
+    }
+
+    // the copy diverges after the fork
+    ref<Expr> e = EqExpr::create(ConstantExpr::alloc(1, Expr::Int8),
+                                 random.read());
+    if (!isa<ConstantExpr>(copy.simplifyExpr(e)))
+      copy.addConstraint(e);
+    ref<Expr> q = AddExpr::create(random.read(), random.read());
+    EXPECT_EQ(simplifyReference(copy, q), copy.simplifyExpr(q));
+    EXPECT_EQ(simplifyReference(cm, q), cm.simplifyExpr(q));
+
+    // caught up on demand
+    std::vector< ref<Expr> > cs(cm.begin(), cm.end());
+    ConstraintManager unindexed(cs);
+    EXPECT_EQ(simplifyReference(cm, q), unindexed.simplifyExpr(q));
+  }
+}
+
+}
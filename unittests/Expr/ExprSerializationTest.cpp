@@ -0,0 +1,194 @@
+//===-- ExprSerializationTest.cpp -----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprSerialization.h"
+
+#include <sstream>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+ref<Expr> getRead(const UpdateList &ul, unsigned index) {
+  return ReadExpr::create(ul, ConstantExpr::alloc(index, Expr::Int32));
+}
+
+/* writes the expressions of the shared set as indices into a table */
+class TableWriter : public ExprWriter {
+  const std::vector< ref<Expr> > &table;
+
+protected:
+  bool isShared(const Expr *e) {
+    for (unsigned i = 0; i < table.size(); i++)
+      if (table[i].get() == e)
+        return true;
+    return false;
+  }
+
+  void writeShared(const ref<Expr> &e) {
+    for (unsigned i = 0; i < table.size(); i++)
+      if (table[i] == e)
+        writeInt(i);
+  }
+
+public:
+  TableWriter(std::ostream &os, const std::vector< ref<Expr> > &_table)
+    : ExprWriter(os), table(_table) {}
+};
+
+class TableReader : public ExprReader {
+  const std::vector< ref<Expr> > &table;
+
+protected:
+  ref<Expr> readSharedExpr() {
+    uint64_t id = readInt();
+    if (!good() || id >= table.size())
+      return 0;
+    return table[id];
+  }
+
+public:
+  TableReader(std::istream &is, ArrayCache *ac,
+              const std::vector< ref<Expr> > &_table)
+    : ExprReader(is, ac), table(_table) {}
+};
+
+TEST(ExprSerializationTest, RoundTrip) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 16);
+  UpdateList ul(array, 0);
+  ref<Expr> a = getRead(ul, 0);
+  ref<Expr> b = getRead(ul, 1);
+
+  const uint64_t words[] = { 0x0123456789abcdefULL, 0xfedcba9876543210ULL };
+
+  std::vector< ref<Expr> > exprs;
+  exprs.push_back(ConstantExpr::alloc(llvm::APInt(128, 2, words)));
+  exprs.push_back(AddExpr::create(a, MulExpr::create(b, a)));
+  exprs.push_back(SelectExpr::create(UltExpr::create(a, b), a, b));
+  exprs.push_back(ConcatExpr::create(a, b));
+  exprs.push_back(ExtractExpr::create(ConcatExpr::create(a, b), 3, 9));
+  exprs.push_back(ZExtExpr::create(a, Expr::Int64));
+  exprs.push_back(SExtExpr::create(b, Expr::Int32));
+  exprs.push_back(NotExpr::create(EqExpr::create(a, b)));
+
+  std::stringstream ss;
+  ExprWriter writer(ss);
+  for (unsigned i = 0; i < exprs.size(); i++)
+    writer.write(exprs[i]);
+  writer.write(ref<Expr>());
+  ASSERT_TRUE(writer.good());
+
+  ExprReader reader(ss, &ac);
+  for (unsigned i = 0; i < exprs.size(); i++) {
+    ref<Expr> e = reader.read();
+    ASSERT_FALSE(e.isNull());
+    EXPECT_EQ(0, e->compare(*exprs[i]));
+  }
+  EXPECT_TRUE(reader.read().isNull());
+  EXPECT_TRUE(reader.good());
+}
+
+TEST(ExprSerializationTest, SharedSubexpressions) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 16);
+  UpdateList ul(array, 0);
+  ref<Expr> common = AddExpr::create(getRead(ul, 0), getRead(ul, 1));
+  ref<Expr> e1 = MulExpr::create(common, getRead(ul, 2));
+  ref<Expr> e2 = SubExpr::create(common, getRead(ul, 3));
+
+  std::stringstream ss;
+  ExprWriter writer(ss);
+  writer.write(e1);
+  writer.write(e2);
+
+  ExprReader reader(ss, &ac);
+  ref<Expr> r1 = reader.read();
+  ref<Expr> r2 = reader.read();
+  ASSERT_FALSE(r1.isNull());
+  ASSERT_FALSE(r2.isNull());
+  EXPECT_EQ(0, r1->compare(*e1));
+  EXPECT_EQ(0, r2->compare(*e2));
+  /* the common subexpression is read back once */
+  EXPECT_EQ(r1->getKid(0).get(), r2->getKid(0).get());
+}
+
+TEST(ExprSerializationTest, UpdateLists) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 16);
+  UpdateList ul(array, 0);
+  for (unsigned i = 0; i < 1000; i++)
+    ul.extend(ConstantExpr::alloc(i % 16, Expr::Int32),
+              ConstantExpr::alloc(i % 256, Expr::Int8));
+
+  /* a second list which extends the first one */
+  UpdateList ul2 = ul;
+  ul2.extend(ConstantExpr::alloc(0, Expr::Int32), getRead(ul, 1));
+
+  std::stringstream ss;
+  ExprWriter writer(ss);
+  writer.write(ul);
+  writer.write(ul2);
+
+  ExprReader reader(ss, &ac);
+  UpdateList r1 = reader.readUpdates();
+  UpdateList r2 = reader.readUpdates();
+  ASSERT_TRUE(reader.good());
+  EXPECT_EQ(array, r1.root);
+  EXPECT_EQ(1000u, r1.getSize());
+  EXPECT_EQ(0, r1.compare(ul));
+  EXPECT_EQ(0, r2.compare(ul2));
+  /* the common prefix of the lists is shared */
+  EXPECT_EQ(r1.head, r2.head->next);
+}
+
+TEST(ExprSerializationTest, SharedTable) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 16);
+  UpdateList ul(array, 0);
+  ref<Expr> held = AddExpr::create(getRead(ul, 0), getRead(ul, 1));
+  std::vector< ref<Expr> > table(1, held);
+
+  std::stringstream ss;
+  TableWriter writer(ss, table);
+  writer.write(MulExpr::create(held, getRead(ul, 2)));
+  writer.write(held);
+
+  TableReader reader(ss, &ac, table);
+  ref<Expr> r1 = reader.read();
+  ref<Expr> r2 = reader.read();
+  ASSERT_FALSE(r1.isNull());
+  /* the expressions of the table are read back as the same expressions */
+  EXPECT_EQ(held.get(), r1->getKid(0).get());
+  EXPECT_EQ(held.get(), r2.get());
+}
+
+TEST(ExprSerializationTest, Truncated) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 16);
+  UpdateList ul(array, 0);
+  ref<Expr> e = AddExpr::create(getRead(ul, 0), getRead(ul, 1));
+
+  std::stringstream ss;
+  ExprWriter writer(ss);
+  writer.write(e);
+  std::string data = ss.str();
+
+  std::stringstream truncated(data.substr(0, data.size() - 1));
+  ExprReader reader(truncated, &ac);
+  EXPECT_TRUE(reader.read().isNull());
+  EXPECT_FALSE(reader.good());
+}
+
+}
@@ -0,0 +1,206 @@
+//===-- CexCachingSolverTest.cpp ------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/Solver.h"
+#include "klee/SolverImpl.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/Assignment.h"
+#include "klee/util/ExprUtil.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+/* solves the queries by enumerating the low 2 bits of each 1-byte array
+   (the other bits are 0), the queries only use these bits */
+class BruteSolver : public SolverImpl {
+public:
+  unsigned calls;
+
+  BruteSolver() : calls(0) {}
+
+  bool computeTruth(const Query &query, bool &isValid) {
+    std::vector<const Array *> objects;
+    std::vector< std::vector<unsigned char> > values;
+    bool hasSolution;
+    computeInitialValues(query, objects, values, hasSolution);
+    isValid = !hasSolution;
+    return true;
+  }
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    bool isTrue, isFalse;
+    computeTruth(query, isTrue);
+    computeTruth(query.negateExpr(), isFalse);
+    result = isTrue ? Solver::True : isFalse ? Solver::False : Solver::Unknown;
+    return true;
+  }
+
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    std::vector<const Array *> objects;
+    findSymbolicObjects(query.expr, objects);
+    std::vector< std::vector<unsigned char> > values;
+    bool hasSolution;
+    computeInitialValues(query.withFalse(), objects, values, hasSolution);
+    assert(hasSolution && "state has invalid constraint set");
+    Assignment a(objects, values);
+    result = a.evaluate(query.expr);
+    return true;
+  }
+
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector< std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    calls++;
+    std::vector< ref<Expr> > cs(query.constraints.begin(),
+                                query.constraints.end());
+    cs.push_back(Expr::createIsZero(query.expr));
+    std::vector<const Array *> arrays;
+    findSymbolicObjects(cs.begin(), cs.end(), arrays);
+
+    unsigned total = 1;
+    for (unsigned i = 0; i < arrays.size(); i++)
+      total *= 4;
+    for (unsigned c = 0; c < total; c++) {
+      std::vector< std::vector<unsigned char> > bytes(arrays.size());
+      for (unsigned i = 0, x = c; i < arrays.size(); i++, x /= 4)
+        bytes[i].push_back(x % 4);
+      Assignment a(arrays, bytes);
+      if (!a.satisfies(cs.begin(), cs.end()))
+        continue;
+
+      hasSolution = true;
+      values.clear();
+      for (unsigned i = 0; i < objects.size(); i++) {
+        Assignment::bindings_ty::iterator it = a.bindings.find(objects[i]);
+        if (it == a.bindings.end())
+          values.push_back(std::vector<unsigned char>(objects[i]->size, 0));
+        else
+          values.push_back(it->second);
+      }
+      return true;
+    }
+
+    hasSolution = false;
+    return true;
+  }
+
+  SolverRunStatus getOperationStatusCode() {
+    return SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  }
+};
+
+ArrayCache ac;
+
+/* the low 2 bits of a 1-byte array */
+ref<Expr> var(const Array *array) {
+  ref<Expr> read = ReadExpr::create(UpdateList(array, 0),
+                                    ConstantExpr::alloc(0, Expr::Int32));
+  return AndExpr::create(read, ConstantExpr::alloc(3, Expr::Int8));
+}
+
+ref<Expr> constant(uint64_t value) {
+  return ConstantExpr::alloc(value, Expr::Int8);
+}
+
+TEST(CexCachingSolverTest, CachedQueries) {
+  BruteSolver *core = new BruteSolver();
+  Solver *solver = createCexCachingSolver(new Solver(core));
+  const Array *arrays[] = { ac.CreateArray("x", 1), ac.CreateArray("y", 1) };
+  ref<Expr> x = var(arrays[0]), y = var(arrays[1]);
+  bool result;
+
+  ConstraintManager cm;
+  cm.addConstraint(UleExpr::create(x, constant(1)));
+  ASSERT_TRUE(solver->mustBeTrue(Query(cm, EqExpr::create(x, constant(0))),
+                                 result));
+  EXPECT_FALSE(result);
+  unsigned calls = core->calls;
+  EXPECT_LT(0u, calls);
+
+  /* the same query is answered by the cache */
+  ASSERT_TRUE(solver->mustBeTrue(Query(cm, EqExpr::create(x, constant(0))),
+                                 result));
+  EXPECT_FALSE(result);
+  EXPECT_EQ(calls, core->calls);
+
+  /* x <= 1 and x > 2 is unsatisfiable */
+  ASSERT_TRUE(solver->mustBeTrue(Query(cm, UleExpr::create(x, constant(2))),
+                                 result));
+  EXPECT_TRUE(result);
+  calls = core->calls;
+
+  /* so is any superset of it */
+  cm.addConstraint(UleExpr::create(y, constant(1)));
+  ASSERT_TRUE(solver->mustBeTrue(Query(cm, UleExpr::create(x, constant(2))),
+                                 result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(calls, core->calls);
+
+  /* the initial values satisfy the constraints */
+  std::vector<const Array *> objects(arrays, arrays + 2);
+  std::vector< std::vector<unsigned char> > values;
+  ASSERT_TRUE(solver->getInitialValues(Query(cm, constant(0)), objects,
+                                       values));
+  Assignment a(objects, values);
+  EXPECT_TRUE(a.satisfies(cm.begin(), cm.end()));
+  delete solver;
+}
+
+/* the workers of -threads save the caches to the same file */
+TEST(CexCachingSolverTest, MergedCacheFile) {
+  std::string path = "CexCachingSolverTest.cache." + llvm::utostr(getpid());
+  std::string option = "-cex-cache-file=" + path;
+  const char *argv[] = { "SolverTest", option.c_str() };
+  llvm::cl::ParseCommandLineOptions(2, argv);
+  remove(path.c_str());
+
+  ref<Expr> x = var(ac.CreateArray("x", 1)), y = var(ac.CreateArray("y", 1));
+  ConstraintManager first, second;
+  first.addConstraint(UleExpr::create(x, constant(1)));
+  second.addConstraint(UleExpr::create(constant(2), y));
+  ref<Expr> firstQuery = EqExpr::create(x, constant(0));
+  ref<Expr> secondQuery = EqExpr::create(y, constant(3));
+  bool result;
+
+  Solver *firstSolver =
+    createCexCachingSolver(new Solver(new BruteSolver()), &ac);
+  Solver *secondSolver =
+    createCexCachingSolver(new Solver(new BruteSolver()), &ac);
+  ASSERT_TRUE(firstSolver->mustBeTrue(Query(first, firstQuery), result));
+  ASSERT_TRUE(secondSolver->mustBeTrue(Query(second, secondQuery), result));
+  delete firstSolver;
+  delete secondSolver;
+
+  /* the entries of both solvers are reloaded */
+  BruteSolver *core = new BruteSolver();
+  Solver *solver = createCexCachingSolver(new Solver(core), &ac);
+  ASSERT_TRUE(solver->mustBeTrue(Query(first, firstQuery), result));
+  EXPECT_FALSE(result);
+  ASSERT_TRUE(solver->mustBeTrue(Query(second, secondQuery), result));
+  EXPECT_FALSE(result);
+  EXPECT_EQ(0u, core->calls);
+  delete solver;
+
+  remove(path.c_str());
+  remove((path + ".lock").c_str());
+}
+
+}
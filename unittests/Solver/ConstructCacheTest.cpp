@@ -0,0 +1,110 @@
+//===-- ConstructCacheTest.cpp ----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr.h"
+#include "klee/SolverStats.h"
+#include "klee/util/ArrayCache.h"
+
+#include "../../lib/Solver/ConstructCache.h"
+
+using namespace klee;
+
+namespace {
+
+ref<Expr> getRead(const Array *array, unsigned index) {
+  UpdateList ul(array, 0);
+  return ReadExpr::create(ul, ConstantExpr::alloc(index, Expr::Int32));
+}
+
+TEST(ConstructCacheTest, HitAndMiss) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4);
+  ConstructCache<int> cache;
+
+  uint64_t hits = stats::queryConstructCacheHits.getValue();
+  uint64_t misses = stats::queryConstructCacheMisses.getValue();
+
+  ref<Expr> e = AddExpr::create(getRead(array, 0), getRead(array, 1));
+  EXPECT_EQ(0, cache.lookup(e));
+  EXPECT_EQ(misses + 1, stats::queryConstructCacheMisses.getValue());
+
+  cache.insert(e, 42);
+  EXPECT_EQ(1u, cache.size());
+
+  /* the cache is keyed by the structure of the expression */
+  ref<Expr> same = AddExpr::create(getRead(array, 0), getRead(array, 1));
+  int *value = cache.lookup(same);
+  ASSERT_NE((int *) 0, value);
+  EXPECT_EQ(42, *value);
+  EXPECT_EQ(hits + 1, stats::queryConstructCacheHits.getValue());
+
+  ref<Expr> other = AddExpr::create(getRead(array, 0), getRead(array, 2));
+  EXPECT_EQ(0, cache.lookup(other));
+  EXPECT_EQ(misses + 2, stats::queryConstructCacheMisses.getValue());
+}
+
+TEST(ConstructCacheTest, EvictsLeastRecentlyUsed) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4);
+  ConstructCache<int> cache(2);
+
+  ref<Expr> a = getRead(array, 0);
+  ref<Expr> b = getRead(array, 1);
+  ref<Expr> c = getRead(array, 2);
+
+  cache.insert(a, 0);
+  cache.insert(b, 1);
+  /* a is used again, so b is the least recently used */
+  ASSERT_NE((int *) 0, cache.lookup(a));
+
+  cache.insert(c, 2);
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ(0, cache.lookup(b));
+  ASSERT_NE((int *) 0, cache.lookup(a));
+  EXPECT_EQ(0, *cache.lookup(a));
+  ASSERT_NE((int *) 0, cache.lookup(c));
+  EXPECT_EQ(2, *cache.lookup(c));
+}
+
+TEST(ConstructCacheTest, Unbounded) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 64);
+  ConstructCache<unsigned> cache;
+
+  for (unsigned i = 0; i < 64; i++)
+    cache.insert(getRead(array, i), i);
+  EXPECT_EQ(64u, cache.size());
+
+  for (unsigned i = 0; i < 64; i++) {
+    unsigned *value = cache.lookup(getRead(array, i));
+    ASSERT_NE((unsigned *) 0, value);
+    EXPECT_EQ(i, *value);
+  }
+}
+
+TEST(ConstructCacheTest, Clear) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4);
+  ConstructCache<int> cache(8);
+
+  ref<Expr> a = getRead(array, 0);
+  cache.insert(a, 1);
+  cache.clear();
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(0, cache.lookup(a));
+
+  /* the entry can be constructed again */
+  cache.insert(a, 2);
+  ASSERT_NE((int *) 0, cache.lookup(a));
+  EXPECT_EQ(2, *cache.lookup(a));
+}
+
+}